@@ -123,6 +123,8 @@ set(SGAMELIST
     ${GAMELOGIC_DIR}/sgame/sg_momentum.cpp
     ${GAMELOGIC_DIR}/sgame/sg_namelog.cpp
     ${GAMELOGIC_DIR}/sgame/sg_physics.cpp
+    ${GAMELOGIC_DIR}/sgame/sg_profiler.cpp
+    ${GAMELOGIC_DIR}/sgame/sg_profiler.h
     ${GAMELOGIC_DIR}/sgame/sg_public.h
     ${GAMELOGIC_DIR}/sgame/sg_session.cpp
     ${GAMELOGIC_DIR}/sgame/sg_spawn.cpp
@@ -137,6 +139,7 @@ set(SGAMELIST
     ${GAMELOGIC_DIR}/sgame/sg_spawn_position.cpp
     ${GAMELOGIC_DIR}/sgame/sg_spawn_sensor.cpp
     ${GAMELOGIC_DIR}/sgame/sg_spawn_shared.cpp
+    ${GAMELOGIC_DIR}/sgame/sg_spatial.cpp
     ${GAMELOGIC_DIR}/sgame/sg_struct.h
     ${GAMELOGIC_DIR}/sgame/sg_svcmds.cpp
     ${GAMELOGIC_DIR}/sgame/sg_team.cpp
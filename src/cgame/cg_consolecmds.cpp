@@ -481,6 +481,7 @@ static const struct
 	{ "nextskin",         CG_TestModelNextSkin_f,  0                },
 	{ "noclip",           0,                       0                },
 	{ "notarget",         0,                       0                },
+	{ "particleBenchmark", CG_ParticleBenchmark_f, 0                },
 	{ "prevframe",        CG_TestModelPrevFrame_f, 0                },
 	{ "prevskin",         CG_TestModelPrevSkin_f,  0                },
 	{ "reload",           0,                       0                },
@@ -50,7 +50,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #define MAX_STEP_CHANGE                32
 
 #define MAX_VERTS_ON_POLY              10
-#define MAX_MARK_POLYS                 256
+#define MAX_MARK_POLYS                 2048 // cg_maxMarks can use up to this many
 
 #define STAT_MINUS                     10 // num frame for '-' stats digit
 
@@ -196,10 +196,6 @@ typedef struct attachment_s
 #define MAX_BASEPARTICLE_EJECTORS MAX_BASEPARTICLE_SYSTEMS * MAX_EJECTORS_PER_SYSTEM
 #define MAX_BASEPARTICLES         MAX_BASEPARTICLE_EJECTORS * MAX_PARTICLES_PER_EJECTOR
 
-#define MAX_PARTICLE_SYSTEMS      48
-#define MAX_PARTICLE_EJECTORS     MAX_PARTICLE_SYSTEMS * MAX_EJECTORS_PER_SYSTEM
-#define MAX_PARTICLES             MAX_PARTICLE_EJECTORS * 5
-
 #define PARTICLES_INFINITE        -1
 #define PARTICLES_SAME_AS_INITIAL -2
 
@@ -368,6 +364,11 @@ typedef struct particleSystem_s
 	vec3_t   lastNormal;
 
 	int      charge;
+
+	struct particleEjector_s *ejectors[ MAX_EJECTORS_PER_SYSTEM ];
+	int      numEjectors;
+
+	int      liveIndex; //position in the pool's live list
 } particleSystem_t;
 
 typedef struct particleEjector_s
@@ -382,7 +383,10 @@ typedef struct particleEjector_s
 
 	int              nextEjectionTime;
 
+	int              numParticles; //live particles from this ejector
+
 	bool         valid;
+	int              liveIndex; //position in the pool's live list
 } particleEjector_t;
 
 //used for actual particle evaluation
@@ -425,8 +429,10 @@ typedef struct particle_s
 
 	bool          valid;
 	int               frameWhenInvalidated;
+	int               liveIndex; //position in the pool's live list
 
 	int               sortKey;
+	int               sortStamp; //last sort that kept this particle
 } particle_t;
 
 //======================================================================
@@ -441,7 +447,7 @@ typedef struct particle_s
 
 #define MAX_TRAIL_SYSTEMS      32
 #define MAX_TRAIL_BEAMS        MAX_TRAIL_SYSTEMS * MAX_BEAMS_PER_SYSTEM
-#define MAX_TRAIL_BEAM_NODES   128
+#define MAX_TRAIL_BEAM_NODES   128 // must be a power of two, nodes are kept in a ring
 
 #define MAX_TRAIL_BEAM_JITTERS 4
 
@@ -520,6 +526,11 @@ typedef struct trailSystem_s
 	int          birthTime;
 	int          destroyTime;
 	bool     valid;
+
+	struct trailBeam_s *beams[ MAX_BEAMS_PER_SYSTEM ];
+	int          numBeams;
+
+	int          liveIndex; //position in the live list
 } trailSystem_t;
 
 typedef struct trailBeamNode_s
@@ -535,12 +546,6 @@ typedef struct trailBeamNode_s
 	byte                   color[ 3 ];
 
 	vec2_t                 jitters[ MAX_TRAIL_BEAM_JITTERS ];
-
-	struct trailBeamNode_s *prev;
-
-	struct trailBeamNode_s *next;
-
-	bool               used;
 } trailBeamNode_t;
 
 typedef struct trailBeam_s
@@ -548,12 +553,15 @@ typedef struct trailBeam_s
 	baseTrailBeam_t   *class_;
 	trailSystem_t   *parent;
 
-	trailBeamNode_t nodePool[ MAX_TRAIL_BEAM_NODES ];
-	trailBeamNode_t *nodes;
+	//ring buffer, front to back from firstNode
+	trailBeamNode_t nodes[ MAX_TRAIL_BEAM_NODES ];
+	int             firstNode;
+	int             numNodes;
 
 	int             lastEvalTime;
 
 	bool        valid;
+	int             liveIndex; //position in the live list
 
 	int             nextJitterTimes[ MAX_TRAIL_BEAM_JITTERS ];
 } trailBeam_t;
@@ -820,12 +828,19 @@ typedef struct centity_s
 
 typedef struct markPoly_s
 {
-	struct markPoly_s *prevMark, *nextMark;
+	struct markPoly_s *prevMark, *nextMark; // newest first
 
 	int               time;
+	int               impact; // shared by the fragments of one impact
 	qhandle_t         markShader;
 	bool          alphaFade; // fade alpha instead of rgb
 	float             color[ 4 ];
+	int               fade; // last fade written into verts
+	vec3_t            origin;
+	vec3_t            normal;
+	float             radius;
+	int               cluster;
+	int               clusterIndex;
 	poly_t            poly;
 	polyVert_t        verts[ MAX_VERTS_ON_POLY ];
 } markPoly_t;
@@ -1848,6 +1863,7 @@ extern  vmCvar_t            cg_noPlayerAnims;
 extern  vmCvar_t            cg_showmiss;
 extern  vmCvar_t            cg_footsteps;
 extern  vmCvar_t            cg_addMarks;
+extern  vmCvar_t            cg_maxMarks;
 extern  vmCvar_t            cg_viewsize;
 extern  vmCvar_t            cg_drawGun;
 extern  vmCvar_t            cg_gun_frame;
@@ -1891,6 +1907,9 @@ extern  vmCvar_t            cg_bounceParticles;
 extern  vmCvar_t            cg_consoleLatency;
 extern  vmCvar_t            cg_lightFlare;
 extern  vmCvar_t            cg_debugParticles;
+extern  vmCvar_t            cg_maxParticleSystems;
+extern  vmCvar_t            cg_maxParticleEjectors;
+extern  vmCvar_t            cg_maxParticles;
 extern  vmCvar_t            cg_debugTrails;
 extern  vmCvar_t            cg_debugPVS;
 extern  vmCvar_t            cg_disableWarningDialogs;
@@ -2271,6 +2290,7 @@ void             CG_ParticleSystemEntity( centity_t *cent );
 
 void             CG_TestPS_f();
 void             CG_DestroyTestPS_f();
+void             CG_ParticleBenchmark_f();
 
 //
 // cg_trails.c
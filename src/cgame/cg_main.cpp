@@ -68,6 +68,7 @@ vmCvar_t        cg_noPlayerAnims;
 vmCvar_t        cg_showmiss;
 vmCvar_t        cg_footsteps;
 vmCvar_t        cg_addMarks;
+vmCvar_t        cg_maxMarks;
 vmCvar_t        cg_viewsize;
 vmCvar_t        cg_drawGun;
 vmCvar_t        cg_gun_frame;
@@ -115,6 +116,9 @@ vmCvar_t        cg_bounceParticles;
 vmCvar_t        cg_consoleLatency;
 vmCvar_t        cg_lightFlare;
 vmCvar_t        cg_debugParticles;
+vmCvar_t        cg_maxParticleSystems;
+vmCvar_t        cg_maxParticleEjectors;
+vmCvar_t        cg_maxParticles;
 vmCvar_t        cg_debugTrails;
 vmCvar_t        cg_debugPVS;
 vmCvar_t        cg_disableWarningDialogs;
@@ -226,6 +230,7 @@ static const cvarTable_t cvarTable[] =
 	{ &cg_crosshairSize,               "cg_crosshairSize",               "1",            0                            },
 	{ &cg_crosshairFile,               "cg_crosshairFile",               "",             0                            },
 	{ &cg_addMarks,                    "cg_marks",                       "1",            0                            },
+	{ &cg_maxMarks,                    "cg_maxMarks",                    "1024",         0                            },
 	{ &cg_lagometer,                   "cg_lagometer",                   "0",            0                            },
 	{ &cg_drawSpeed,                   "cg_drawSpeed",                   "0",            0                            },
 	{ &cg_maxSpeedTimeWindow,          "cg_maxSpeedTimeWindow",          "2000",         0                            },
@@ -281,6 +286,9 @@ static const cvarTable_t cvarTable[] =
 	{ &cg_consoleLatency,              "cg_consoleLatency",              "3000",         0                            },
 	{ &cg_lightFlare,                  "cg_lightFlare",                  "3",            0                            },
 	{ &cg_debugParticles,              "cg_debugParticles",              "0",            CVAR_CHEAT                   },
+	{ &cg_maxParticleSystems,          "cg_maxParticleSystems",          "128",          0                            },
+	{ &cg_maxParticleEjectors,         "cg_maxParticleEjectors",         "512",          0                            },
+	{ &cg_maxParticles,                "cg_maxParticles",                "4096",         0                            },
 	{ &cg_debugTrails,                 "cg_debugTrails",                 "0",            CVAR_CHEAT                   },
 	{ &cg_debugPVS,                    "cg_debugPVS",                    "0",            CVAR_CHEAT                   },
 	{ &cg_disableWarningDialogs,       "cg_disableWarningDialogs",       "0",            0                            },
@@ -25,6 +25,8 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "cg_local.h"
 
+#include <vector>
+
 /*
 ===================================================================
 
@@ -33,10 +35,182 @@ MARK POLYS
 ===================================================================
 */
 
-markPoly_t cg_activeMarkPolys; // double linked list
+markPoly_t cg_activeMarkPolys; // double linked list, newest first
 markPoly_t *cg_freeMarkPolys; // single linked list
 markPoly_t cg_markPolys[ MAX_MARK_POLYS ];
 static int markTotal;
+static int markImpacts;
+
+/*
+===================================================================
+
+MARK CLUSTERS
+
+Persistent marks are bucketed by the grid cell of their impact point, so
+whole regions can be frustum culled before anything is submitted and a
+new impact only has to look at the marks around it.
+
+===================================================================
+*/
+
+#define MARK_CELL_SIZE        256
+#define MARK_CLUSTERS         256 // must be a power of two
+#define MARK_PVS_LIFT         2.0f // impact points sit on the surface
+#define MARK_MERGE_FRACTION   0.25f // of the radius, refreshes the old mark
+#define MARK_REPLACE_FRACTION 0.5f // of the radius, replaces the old mark
+#define MARK_MERGE_DOT        0.9f
+
+static_assert( ( MARK_CLUSTERS & ( MARK_CLUSTERS - 1 ) ) == 0, "MARK_CLUSTERS must be a power of two" );
+
+typedef struct
+{
+	std::vector<markPoly_t *> marks;
+	vec3_t                    mins, maxs;
+	bool                      boundsDirty;
+} markCluster_t;
+
+static markCluster_t markClusters[ MARK_CLUSTERS ];
+
+/*
+===================
+CG_MarkCell
+===================
+*/
+static int CG_MarkCell( float v )
+{
+	return ( int ) floorf( v / MARK_CELL_SIZE );
+}
+
+/*
+===================
+CG_MarkCluster
+
+Cells share clusters when they hash together, which only loosens the
+cluster bounds
+===================
+*/
+static int CG_MarkCluster( int x, int y, int z )
+{
+	unsigned hash = ( unsigned ) x * 73856093u ^ ( unsigned ) y * 19349663u ^ ( unsigned ) z * 83492791u;
+
+	return hash & ( MARK_CLUSTERS - 1 );
+}
+
+/*
+===================
+CG_AddMarkToBounds
+===================
+*/
+static void CG_AddMarkToBounds( const markPoly_t *mp, vec3_t mins, vec3_t maxs )
+{
+	int j;
+
+	// fragments can be clipped well off the impact plane, so use the
+	// vertices rather than the mark's radius
+	for ( j = 0; j < mp->poly.numVerts; j++ )
+	{
+		AddPointToBounds( mp->verts[ j ].xyz, mins, maxs );
+	}
+}
+
+/*
+===================
+CG_UpdateClusterBounds
+===================
+*/
+static void CG_UpdateClusterBounds( markCluster_t *mc )
+{
+	ClearBounds( mc->mins, mc->maxs );
+
+	for ( markPoly_t *mp : mc->marks )
+	{
+		CG_AddMarkToBounds( mp, mc->mins, mc->maxs );
+	}
+
+	mc->boundsDirty = false;
+}
+
+/*
+===================
+CG_LinkMark
+===================
+*/
+static void CG_LinkMark( markPoly_t *mp )
+{
+	markCluster_t *mc;
+
+	mp->cluster = CG_MarkCluster( CG_MarkCell( mp->origin[ 0 ] ),
+	                              CG_MarkCell( mp->origin[ 1 ] ),
+	                              CG_MarkCell( mp->origin[ 2 ] ) );
+	mc = &markClusters[ mp->cluster ];
+
+	if ( mc->marks.empty() )
+	{
+		ClearBounds( mc->mins, mc->maxs );
+		mc->boundsDirty = false;
+	}
+
+	mp->clusterIndex = mc->marks.size();
+	mc->marks.push_back( mp );
+	CG_AddMarkToBounds( mp, mc->mins, mc->maxs );
+}
+
+/*
+===================
+CG_UnlinkMark
+===================
+*/
+static void CG_UnlinkMark( markPoly_t *mp )
+{
+	markCluster_t *mc = &markClusters[ mp->cluster ];
+	markPoly_t    *last = mc->marks.back();
+
+	mc->marks[ mp->clusterIndex ] = last;
+	last->clusterIndex = mp->clusterIndex;
+	mc->marks.pop_back();
+	mc->boundsDirty = true;
+}
+
+/*
+===================
+CG_SetMarkFade
+
+Scales the stored colour into the vertices, only when it changes
+===================
+*/
+static void CG_SetMarkFade( markPoly_t *mp, int fade )
+{
+	int j;
+
+	if ( mp->fade == fade )
+	{
+		return;
+	}
+
+	mp->fade = fade;
+
+	for ( j = 0; j < mp->poly.numVerts; j++ )
+	{
+		if ( mp->alphaFade )
+		{
+			mp->verts[ j ].modulate[ 3 ] = mp->color[ 3 ] * fade;
+		}
+		else
+		{
+			mp->verts[ j ].modulate[ 0 ] = mp->color[ 0 ] * fade;
+			mp->verts[ j ].modulate[ 1 ] = mp->color[ 1 ] * fade;
+			mp->verts[ j ].modulate[ 2 ] = mp->color[ 2 ] * fade;
+		}
+	}
+}
+
+/*
+===================================================================
+
+MARK POLYS
+
+===================================================================
+*/
 
 /*
 ===================
@@ -59,6 +233,13 @@ void CG_InitMarkPolys()
 	{
 		cg_markPolys[ i ].nextMark = &cg_markPolys[ i + 1 ];
 	}
+
+	for ( i = 0; i < MARK_CLUSTERS; i++ )
+	{
+		markClusters[ i ].marks.clear();
+	}
+
+	markTotal = 0;
 }
 
 /*
@@ -73,13 +254,32 @@ void CG_FreeMarkPoly( markPoly_t *le )
 		Com_Error(errorParm_t::ERR_DROP,  "CG_FreeLocalEntity: not active" );
 	}
 
+	CG_UnlinkMark( le );
+
 	// remove from the doubly linked active list
 	le->prevMark->nextMark = le->nextMark;
 	le->nextMark->prevMark = le->prevMark;
 
 	// the free list is only singly linked
 	le->nextMark = cg_freeMarkPolys;
+	le->prevMark = nullptr;
 	cg_freeMarkPolys = le;
+	markTotal--;
+}
+
+/*
+===================
+CG_LinkMarkNewest
+
+Puts an active mark at the head of the age ordered list
+===================
+*/
+static void CG_LinkMarkNewest( markPoly_t *le )
+{
+	le->nextMark = cg_activeMarkPolys.nextMark;
+	le->prevMark = &cg_activeMarkPolys;
+	cg_activeMarkPolys.nextMark->prevMark = le;
+	cg_activeMarkPolys.nextMark = le;
 }
 
 /*
@@ -93,14 +293,15 @@ markPoly_t *CG_AllocMark()
 {
 	markPoly_t *le;
 	int        time;
+	int        maxMarks = Math::Clamp( cg_maxMarks.integer, 1, MAX_MARK_POLYS );
 
-	if ( !cg_freeMarkPolys )
+	while ( !cg_freeMarkPolys || markTotal >= maxMarks )
 	{
 		// no free entities, so free the one at the end of the chain
 		// remove the oldest active entity
 		time = cg_activeMarkPolys.prevMark->time;
 
-		while ( cg_activeMarkPolys.prevMark && time == cg_activeMarkPolys.prevMark->time )
+		while ( cg_activeMarkPolys.prevMark != &cg_activeMarkPolys && time == cg_activeMarkPolys.prevMark->time )
 		{
 			CG_FreeMarkPoly( cg_activeMarkPolys.prevMark );
 		}
@@ -112,13 +313,101 @@ markPoly_t *CG_AllocMark()
 	memset( le, 0, sizeof( *le ) );
 
 	// link into the active list
-	le->nextMark = cg_activeMarkPolys.nextMark;
-	le->prevMark = &cg_activeMarkPolys;
-	cg_activeMarkPolys.nextMark->prevMark = le;
-	cg_activeMarkPolys.nextMark = le;
+	CG_LinkMarkNewest( le );
+	markTotal++;
 	return le;
 }
 
+/*
+===================
+CG_MergeMark
+
+Looks for persistent marks a new impact lands on. A near copy of an
+existing mark just renews it, and returns true so nothing new is made;
+smaller marks the new one mostly covers are removed.
+===================
+*/
+static bool CG_MergeMark( qhandle_t markShader, const vec3_t origin, const vec3_t normal,
+                          float radius, bool alphaFade, const vec4_t color )
+{
+	static std::vector<markPoly_t *> replaced;
+	bool  visited[ MARK_CLUSTERS ] = {};
+	bool  merged = false;
+	float reach = MARK_REPLACE_FRACTION * radius;
+	int   mins[ 3 ], maxs[ 3 ];
+	int   x, y, z;
+	int   i;
+
+	for ( i = 0; i < 3; i++ )
+	{
+		mins[ i ] = CG_MarkCell( origin[ i ] - reach );
+		maxs[ i ] = CG_MarkCell( origin[ i ] + reach );
+	}
+
+	replaced.clear();
+
+	for ( x = mins[ 0 ]; x <= maxs[ 0 ]; x++ )
+	{
+		for ( y = mins[ 1 ]; y <= maxs[ 1 ]; y++ )
+		{
+			for ( z = mins[ 2 ]; z <= maxs[ 2 ]; z++ )
+			{
+				int cluster = CG_MarkCluster( x, y, z );
+
+				if ( visited[ cluster ] )
+				{
+					continue;
+				}
+
+				visited[ cluster ] = true;
+
+				for ( markPoly_t *mp : markClusters[ cluster ].marks )
+				{
+					float dist;
+
+					if ( mp->markShader != markShader || mp->alphaFade != alphaFade ||
+					     DotProduct( mp->normal, normal ) < MARK_MERGE_DOT )
+					{
+						continue;
+					}
+
+					dist = Distance( mp->origin, origin );
+
+					if ( dist < MARK_MERGE_FRACTION * radius &&
+					     fabsf( mp->radius - radius ) < MARK_MERGE_FRACTION * radius &&
+					     VectorCompare( mp->color, color ) && mp->color[ 3 ] == color[ 3 ] )
+					{
+						// every fragment of the old impact shares its origin,
+						// so they are all renewed together
+						mp->time = cg.time;
+						CG_SetMarkFade( mp, 255 );
+						mp->prevMark->nextMark = mp->nextMark;
+						mp->nextMark->prevMark = mp->prevMark;
+						CG_LinkMarkNewest( mp );
+						merged = true;
+					}
+					else if ( dist < reach && mp->radius <= radius )
+					{
+						replaced.push_back( mp );
+					}
+				}
+			}
+		}
+	}
+
+	if ( merged )
+	{
+		return true;
+	}
+
+	for ( markPoly_t *mp : replaced )
+	{
+		CG_FreeMarkPoly( mp );
+	}
+
+	return false;
+}
+
 /*
 =================
 CG_ImpactMark
@@ -165,16 +454,24 @@ void CG_ImpactMark( qhandle_t markShader, const vec3_t origin, const vec3_t dir,
 		Com_Error(errorParm_t::ERR_DROP,  "CG_ImpactMark called with <= 0 radius" );
 	}
 
-	//if ( markTotal >= MAX_MARK_POLYS ) {
-	//  return;
-	//}
-
 	// create the texture axis
 	VectorNormalize2( dir, axis[ 0 ] );
 	PerpendicularVector( axis[ 1 ], axis[ 0 ] );
 	RotatePointAroundVector( axis[ 2 ], axis[ 0 ], axis[ 1 ], orientation );
 	CrossProduct( axis[ 0 ], axis[ 2 ], axis[ 1 ] );
 
+	if ( !temporary )
+	{
+		vec4_t color = { red, green, blue, alpha };
+
+		if ( CG_MergeMark( markShader, origin, axis[ 0 ], radius, alphaFade, color ) )
+		{
+			return;
+		}
+	}
+
+	markImpacts++;
+
 	texCoordScale = 0.5 * 1.0 / radius;
 
 	// create the full polygon
@@ -232,6 +529,7 @@ void CG_ImpactMark( qhandle_t markShader, const vec3_t origin, const vec3_t dir,
 		// otherwise save it persistently
 		mark = CG_AllocMark();
 		mark->time = cg.time;
+		mark->impact = markImpacts;
 		mark->alphaFade = alphaFade;
 		mark->markShader = markShader;
 		mark->poly.numVerts = mf->numPoints;
@@ -239,14 +537,23 @@ void CG_ImpactMark( qhandle_t markShader, const vec3_t origin, const vec3_t dir,
 		mark->color[ 1 ] = green;
 		mark->color[ 2 ] = blue;
 		mark->color[ 3 ] = alpha;
+		mark->fade = 255;
+		VectorCopy( origin, mark->origin );
+		VectorCopy( axis[ 0 ], mark->normal );
+		mark->radius = radius;
 		memcpy( mark->verts, verts, mf->numPoints * sizeof( verts[ 0 ] ) );
-		markTotal++;
+		CG_LinkMark( mark );
 	}
 }
 
 /*
 ===============
 CG_AddMarks
+
+Expired and fading marks are found from the old end of the age ordered
+list, so only they are touched. Everything else is submitted a cluster at
+a time, skipping clusters outside the view frustum and impacts outside
+the PVS.
 ===============
 */
 #define MARK_TOTAL_TIME 10000
@@ -254,55 +561,72 @@ CG_AddMarks
 
 void CG_AddMarks()
 {
-	int        j;
-	markPoly_t *mp, *next;
+	markPoly_t *mp;
+	int        i;
 	int        t;
-	int        fade;
+	int        lastImpact = 0;
+	bool       lastVisible = false;
 
 	if ( !cg_addMarks.integer )
 	{
 		return;
 	}
 
-	mp = cg_activeMarkPolys.nextMark;
+	// see if it is time to completely remove any
+	while ( ( mp = cg_activeMarkPolys.prevMark ) != &cg_activeMarkPolys &&
+	        cg.time > mp->time + MARK_TOTAL_TIME )
+	{
+		CG_FreeMarkPoly( mp );
+	}
+
+	// fade the oldest marks out with time
+	for ( mp = cg_activeMarkPolys.prevMark; mp != &cg_activeMarkPolys; mp = mp->prevMark )
+	{
+		t = mp->time + MARK_TOTAL_TIME - cg.time;
+
+		if ( t >= MARK_FADE_TIME )
+		{
+			break;
+		}
+
+		CG_SetMarkFade( mp, 255 * t / MARK_FADE_TIME );
+	}
 
-	for ( ; mp != &cg_activeMarkPolys; mp = next )
+	for ( i = 0; i < MARK_CLUSTERS; i++ )
 	{
-		// grab next now, so if the local entity is freed we
-		// still have it
-		next = mp->nextMark;
+		markCluster_t *mc = &markClusters[ i ];
 
-		// see if it is time to completely remove it
-		if ( cg.time > mp->time + MARK_TOTAL_TIME )
+		if ( mc->marks.empty() )
 		{
-			CG_FreeMarkPoly( mp );
 			continue;
 		}
 
-		// fade all marks out with time
-		t = mp->time + MARK_TOTAL_TIME - cg.time;
+		if ( mc->boundsDirty )
+		{
+			CG_UpdateClusterBounds( mc );
+		}
 
-		if ( t < MARK_FADE_TIME )
+		if ( CG_CullBox( mc->mins, mc->maxs ) )
 		{
-			fade = 255 * t / MARK_FADE_TIME;
+			continue;
+		}
 
-			if ( mp->alphaFade )
+		for ( markPoly_t *mark : mc->marks )
+		{
+			// fragments of one impact are usually stored together
+			if ( mark->impact != lastImpact )
 			{
-				for ( j = 0; j < mp->poly.numVerts; j++ )
-				{
-					mp->verts[ j ].modulate[ 3 ] = fade;
-				}
+				vec3_t point;
+
+				VectorMA( mark->origin, MARK_PVS_LIFT, mark->normal, point );
+				lastImpact = mark->impact;
+				lastVisible = trap_R_inPVS( cg.refdef.vieworg, point );
 			}
-			else
+
+			if ( lastVisible )
 			{
-				for ( j = 0; j < mp->poly.numVerts; j++ )
-				{
-					mp->verts[ j ].modulate[ 0 ] = mp->color[ 0 ] * fade;
-					mp->verts[ j ].modulate[ 1 ] = mp->color[ 1 ] * fade;
-					mp->verts[ j ].modulate[ 2 ] = mp->color[ 2 ] * fade;
-				}
+				trap_R_AddPolyToScene( mark->markShader, mark->poly.numVerts, mark->verts );
 			}
 		}
-		trap_R_AddPolyToScene( mp->markShader, mp->poly.numVerts, mp->verts );
 	}
 }
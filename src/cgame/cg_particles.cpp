@@ -24,6 +24,16 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "cg_local.h"
 
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#if defined( __SSE__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 1 )
+#define PARTICLE_SSE
+#include <xmmintrin.h>
+#endif
+
 static baseParticleSystem_t  baseParticleSystems[ MAX_BASEPARTICLE_SYSTEMS ];
 static baseParticleEjector_t baseParticleEjectors[ MAX_BASEPARTICLE_EJECTORS ];
 static baseParticle_t        baseParticles[ MAX_BASEPARTICLES ];
@@ -31,11 +41,213 @@ static int                   numBaseParticleSystems = 0;
 static int                   numBaseParticleEjectors = 0;
 static int                   numBaseParticles = 0;
 
-static particleSystem_t      particleSystems[ MAX_PARTICLE_SYSTEMS ];
-static particleEjector_t     particleEjectors[ MAX_PARTICLE_EJECTORS ];
-static particle_t            particles[ MAX_PARTICLES ];
-static particle_t            *sortedParticles[ MAX_PARTICLES ];
-static particle_t            *radixBuffer[ MAX_PARTICLES ];
+/*
+===============
+Particle pools
+
+Systems, ejectors and particles live in slabs that are allocated on
+demand up to a cvar controlled capacity and never move, so pointers to
+them stay valid. Each pool keeps a dense list of its live entries so
+per frame work is proportional to what is alive, and records the most
+entries it ever had live at once.
+===============
+*/
+
+#define PARTICLE_POOL_SLAB 256
+
+template<typename T>
+struct particlePool_t
+{
+	const char                        *name;
+	const char                        *capacityName;
+	vmCvar_t                          *capacity;
+	std::vector<std::unique_ptr<T[]>> slabs;
+	std::vector<T *>                  live;
+	std::vector<T *>                  free;
+	int                               size;
+	int                               highWater;
+	bool                              warned;
+};
+
+static particlePool_t<particleSystem_t>  particleSystems =
+{ "particle system", "cg_maxParticleSystems", &cg_maxParticleSystems };
+static particlePool_t<particleEjector_t> particleEjectors =
+{ "particle ejector", "cg_maxParticleEjectors", &cg_maxParticleEjectors };
+static particlePool_t<particle_t>        particles =
+{ "particle", "cg_maxParticles", &cg_maxParticles };
+
+//particles wait here for a couple of frames before they are reused
+static std::deque<particle_t *>          retiredParticles;
+
+//back to front order, kept between frames
+static std::vector<particle_t *>         sortedParticles;
+//spawned since the last sort
+static std::vector<particle_t *>         unsortedParticles;
+static std::vector<particle_t *>         radixBuffer;
+static int                               particleSortStamp = 0;
+static bool                              particleSortValid = false;
+
+#define PARTICLE_SORT_RANGE  2000000000
+#define PARTICLE_SORT_BUDGET 4 //insertion sort moves per particle before falling back to radix
+
+/*
+===============
+CG_PeekPoolEntry
+
+Find a free entry, growing the pool if needed. The entry is only taken
+from the free list by CG_CommitPoolEntry, so a caller may give up on it
+===============
+*/
+template<typename T>
+static T *CG_PeekPoolEntry( particlePool_t<T> *pool )
+{
+	if ( pool->free.empty() )
+	{
+		int count = std::min( PARTICLE_POOL_SLAB, pool->capacity->integer - pool->size );
+
+		if ( count <= 0 )
+		{
+			if ( !pool->warned )
+			{
+				Log::Warn( "%s pool is full (%d), raise %s", pool->name, pool->size, pool->capacityName );
+				pool->warned = true;
+			}
+
+			return nullptr;
+		}
+
+		T *slab = new T[ count ]();
+
+		pool->slabs.emplace_back( slab );
+		pool->size += count;
+
+		for ( int i = count - 1; i >= 0; i-- )
+		{
+			pool->free.push_back( &slab[ i ] );
+		}
+	}
+
+	return pool->free.back();
+}
+
+/*
+===============
+CG_CommitPoolEntry
+
+Move the entry returned by CG_PeekPoolEntry to the live list
+===============
+*/
+template<typename T>
+static void CG_CommitPoolEntry( particlePool_t<T> *pool, T *entry )
+{
+	pool->free.pop_back();
+
+	entry->liveIndex = pool->live.size();
+	pool->live.push_back( entry );
+
+	pool->highWater = std::max( pool->highWater, ( int ) pool->live.size() );
+}
+
+/*
+===============
+CG_RemovePoolEntry
+
+Take an entry off the live list, the caller decides when it is free
+===============
+*/
+template<typename T>
+static void CG_RemovePoolEntry( particlePool_t<T> *pool, T *entry )
+{
+	T *last = pool->live.back();
+
+	pool->live[ entry->liveIndex ] = last;
+	last->liveIndex = entry->liveIndex;
+	pool->live.pop_back();
+
+	entry->liveIndex = -1;
+}
+
+/*
+===============
+CG_FreePoolEntry
+===============
+*/
+template<typename T>
+static void CG_FreePoolEntry( particlePool_t<T> *pool, T *entry )
+{
+	CG_RemovePoolEntry( pool, entry );
+	pool->free.push_back( entry );
+}
+
+/*
+===============
+CG_ReclaimParticles
+
+Return the particles that were invalidated long enough ago to the pool
+===============
+*/
+static void CG_ReclaimParticles()
+{
+	//FIXME: the + 1 may be unnecessary
+	while ( !retiredParticles.empty() &&
+	        cg.clientFrame > retiredParticles.front()->frameWhenInvalidated + 1 )
+	{
+		particles.free.push_back( retiredParticles.front() );
+		retiredParticles.pop_front();
+	}
+}
+
+//structure of arrays working set of the moving particles, grouped by class
+typedef struct
+{
+	std::vector<particle_t *> particle;
+	std::vector<byte>         skip;
+	std::vector<float>        dt;
+	std::vector<float>        ox, oy, oz;
+	std::vector<float>        vx, vy, vz;
+	std::vector<float>        ax, ay, az;
+	std::vector<float>        nx, ny, nz;
+	int                       count;
+} particleBatch_t;
+
+typedef struct
+{
+	baseParticle_t *class_;
+	int            start;
+	int            count;
+} particleGroup_t;
+
+static particleBatch_t       particleBatch;
+static particleGroup_t       particleGroups[ MAX_BASEPARTICLES ];
+static int                   particleGroupIndex[ MAX_BASEPARTICLES ]; //group number + 1, by class
+static int                   numParticleGroups = 0;
+static std::vector<particle_t *> gatheredParticles;
+
+typedef struct
+{
+	particleSystem_t *ps; //only while waiting for the spawn origin
+	int              time;
+	char             name[ MAX_QPATH ];
+	vec3_t           origin;
+	vec3_t           normal;
+	bool             normalValid;
+} particleBenchmarkSpawn_t;
+
+static struct
+{
+	bool                                  recording;
+	bool                                  running;
+	char                                  fileName[ MAX_QPATH ];
+	int                                   startTime;
+	int                                   updates;
+	std::vector<particleBenchmarkSpawn_t> pending;
+	std::vector<particleBenchmarkSpawn_t> spawns;
+} particleBenchmark;
+
+//set while a particle spawns its child or death systems
+static bool                  particleSpawningChild = false;
+
+static void CG_RecordParticleSpawns();
 
 /*
 ===============
@@ -110,7 +322,9 @@ static void CG_DestroyParticle( particle_t *p, vec3_t impactNormal )
 	{
 		particleSystem_t *ps;
 
+		particleSpawningChild = true;
 		ps = CG_SpawnNewParticleSystem( p->class_->onDeathSystemHandle );
+		particleSpawningChild = false;
 
 		if ( CG_IsParticleSystemValid( &ps ) )
 		{
@@ -125,10 +339,14 @@ static void CG_DestroyParticle( particle_t *p, vec3_t impactNormal )
 	}
 
 	p->valid = false;
+	p->parent->numParticles--;
 
 	//this gives other systems a couple of
 	//frames to realise the particle is gone
 	p->frameWhenInvalidated = cg.clientFrame;
+
+	CG_RemovePoolEntry( &particles, p );
+	retiredParticles.push_back( p );
 }
 
 /*
@@ -140,222 +358,228 @@ Introduce a new particle into the world
 */
 static particle_t *CG_SpawnNewParticle( baseParticle_t *bp, particleEjector_t *parent )
 {
-	int               i, j;
-	particle_t        *p = nullptr;
+	int               j;
+	particle_t        *p;
 	particleEjector_t *pe = parent;
 	particleSystem_t  *ps = parent->parent;
 	vec3_t            attachmentPoint, attachmentVelocity;
 	vec3_t            transform[ 3 ];
 
-	for ( i = 0; i < MAX_PARTICLES; i++ )
+	CG_ReclaimParticles();
+
+	p = CG_PeekPoolEntry( &particles );
+
+	if ( !p )
 	{
-		p = &particles[ i ];
+		return nullptr;
+	}
 
-		//FIXME: the + 1 may be unnecessary
-		if ( !p->valid && cg.clientFrame > p->frameWhenInvalidated + 1 )
-		{
-			memset( p, 0, sizeof( particle_t ) );
+	memset( p, 0, sizeof( particle_t ) );
 
-			//found a free slot
-			p->class_ = bp;
-			p->parent = pe;
+	//found a free slot
+	p->class_ = bp;
+	p->parent = pe;
 
-			p->birthTime = cg.time;
-			p->lifeTime = ( int ) CG_RandomiseValue( ( float ) bp->lifeTime, bp->lifeTimeRandFrac );
+	p->birthTime = cg.time;
+	p->lifeTime = ( int ) CG_RandomiseValue( ( float ) bp->lifeTime, bp->lifeTimeRandFrac );
 
-			p->radius.delay = ( int ) CG_RandomiseValue( ( float ) bp->radius.delay, bp->radius.delayRandFrac );
-			p->radius.initial = CG_RandomiseValue( bp->radius.initial, bp->radius.initialRandFrac );
-			p->radius.final = CG_RandomiseValue( bp->radius.final, bp->radius.finalRandFrac );
+	p->radius.delay = ( int ) CG_RandomiseValue( ( float ) bp->radius.delay, bp->radius.delayRandFrac );
+	p->radius.initial = CG_RandomiseValue( bp->radius.initial, bp->radius.initialRandFrac );
+	p->radius.final = CG_RandomiseValue( bp->radius.final, bp->radius.finalRandFrac );
 
-			p->radius.initial += bp->scaleWithCharge * pe->parent->charge;
+	p->radius.initial += bp->scaleWithCharge * pe->parent->charge;
 
-			p->alpha.delay = ( int ) CG_RandomiseValue( ( float ) bp->alpha.delay, bp->alpha.delayRandFrac );
-			p->alpha.initial = CG_RandomiseValue( bp->alpha.initial, bp->alpha.initialRandFrac );
-			p->alpha.final = CG_RandomiseValue( bp->alpha.final, bp->alpha.finalRandFrac );
+	p->alpha.delay = ( int ) CG_RandomiseValue( ( float ) bp->alpha.delay, bp->alpha.delayRandFrac );
+	p->alpha.initial = CG_RandomiseValue( bp->alpha.initial, bp->alpha.initialRandFrac );
+	p->alpha.final = CG_RandomiseValue( bp->alpha.final, bp->alpha.finalRandFrac );
 
-			p->rotation.delay = ( int ) CG_RandomiseValue( ( float ) bp->rotation.delay, bp->rotation.delayRandFrac );
-			p->rotation.initial = CG_RandomiseValue( bp->rotation.initial, bp->rotation.initialRandFrac );
-			p->rotation.final = CG_RandomiseValue( bp->rotation.final, bp->rotation.finalRandFrac );
+	p->rotation.delay = ( int ) CG_RandomiseValue( ( float ) bp->rotation.delay, bp->rotation.delayRandFrac );
+	p->rotation.initial = CG_RandomiseValue( bp->rotation.initial, bp->rotation.initialRandFrac );
+	p->rotation.final = CG_RandomiseValue( bp->rotation.final, bp->rotation.finalRandFrac );
 
-			p->dLightRadius.delay =
-			  ( int ) CG_RandomiseValue( ( float ) bp->dLightRadius.delay, bp->dLightRadius.delayRandFrac );
-			p->dLightRadius.initial =
-			  CG_RandomiseValue( bp->dLightRadius.initial, bp->dLightRadius.initialRandFrac );
-			p->dLightRadius.final =
-			  CG_RandomiseValue( bp->dLightRadius.final, bp->dLightRadius.finalRandFrac );
+	p->dLightRadius.delay =
+	  ( int ) CG_RandomiseValue( ( float ) bp->dLightRadius.delay, bp->dLightRadius.delayRandFrac );
+	p->dLightRadius.initial =
+	  CG_RandomiseValue( bp->dLightRadius.initial, bp->dLightRadius.initialRandFrac );
+	p->dLightRadius.final =
+	  CG_RandomiseValue( bp->dLightRadius.final, bp->dLightRadius.finalRandFrac );
 
-			p->colorDelay = CG_RandomiseValue( bp->colorDelay, bp->colorDelayRandFrac );
+	p->colorDelay = CG_RandomiseValue( bp->colorDelay, bp->colorDelayRandFrac );
 
-			p->bounceMarkRadius = CG_RandomiseValue( bp->bounceMarkRadius, bp->bounceMarkRadiusRandFrac );
-			p->bounceMarkCount =
-			  rint( CG_RandomiseValue( ( float ) bp->bounceMarkCount, bp->bounceMarkCountRandFrac ) );
-			p->bounceSoundCount =
-			  rint( CG_RandomiseValue( ( float ) bp->bounceSoundCount, bp->bounceSoundCountRandFrac ) );
+	p->bounceMarkRadius = CG_RandomiseValue( bp->bounceMarkRadius, bp->bounceMarkRadiusRandFrac );
+	p->bounceMarkCount =
+	  rint( CG_RandomiseValue( ( float ) bp->bounceMarkCount, bp->bounceMarkCountRandFrac ) );
+	p->bounceSoundCount =
+	  rint( CG_RandomiseValue( ( float ) bp->bounceSoundCount, bp->bounceSoundCountRandFrac ) );
 
-			if ( bp->numModels )
-			{
-				p->model = bp->models[ rand() % bp->numModels ];
+	if ( bp->numModels )
+	{
+		p->model = bp->models[ rand() % bp->numModels ];
 
-				if ( bp->modelAnimation.frameLerp < 0 )
-				{
-					bp->modelAnimation.frameLerp = p->lifeTime / bp->modelAnimation.numFrames;
-					bp->modelAnimation.initialLerp = p->lifeTime / bp->modelAnimation.numFrames;
-				}
-			}
+		if ( bp->modelAnimation.frameLerp < 0 )
+		{
+			bp->modelAnimation.frameLerp = p->lifeTime / bp->modelAnimation.numFrames;
+			bp->modelAnimation.initialLerp = p->lifeTime / bp->modelAnimation.numFrames;
+		}
+	}
 
-			if ( !CG_AttachmentPoint( &ps->attachment, attachmentPoint ) )
-			{
-				return nullptr;
-			}
+	if ( !CG_AttachmentPoint( &ps->attachment, attachmentPoint ) )
+	{
+		return nullptr;
+	}
 
-			VectorCopy( attachmentPoint, p->origin );
+	VectorCopy( attachmentPoint, p->origin );
 
-			if ( CG_AttachmentAxis( &ps->attachment, transform ) )
-			{
-				vec3_t transDisplacement;
+	if ( CG_AttachmentAxis( &ps->attachment, transform ) )
+	{
+		vec3_t transDisplacement;
+
+		VectorMatrixMultiply( bp->displacement, transform, transDisplacement );
+		VectorAdd( p->origin, transDisplacement, p->origin );
+	}
+	else
+	{
+		VectorAdd( p->origin, bp->displacement, p->origin );
+	}
+
+	for ( j = 0; j <= 2; j++ )
+	{
+		p->origin[ j ] += ( crandom() * bp->randDisplacement[ j ] );
+	}
 
-				VectorMatrixMultiply( bp->displacement, transform, transDisplacement );
-				VectorAdd( p->origin, transDisplacement, p->origin );
+	switch ( bp->velMoveType )
+	{
+		case PMT_STATIC:
+			if ( bp->velMoveValues.dirType == PMD_POINT )
+			{
+				VectorSubtract( bp->velMoveValues.point, p->origin, p->velocity );
 			}
-			else
+			else if ( bp->velMoveValues.dirType == PMD_LINEAR )
 			{
-				VectorAdd( p->origin, bp->displacement, p->origin );
+				VectorCopy( bp->velMoveValues.dir, p->velocity );
 			}
 
-			for ( j = 0; j <= 2; j++ )
+			break;
+
+		case PMT_STATIC_TRANSFORM:
+			if ( !CG_AttachmentAxis( &ps->attachment, transform ) )
 			{
-				p->origin[ j ] += ( crandom() * bp->randDisplacement[ j ] );
+				return nullptr;
 			}
 
-			switch ( bp->velMoveType )
+			if ( bp->velMoveValues.dirType == PMD_POINT )
 			{
-				case PMT_STATIC:
-					if ( bp->velMoveValues.dirType == PMD_POINT )
-					{
-						VectorSubtract( bp->velMoveValues.point, p->origin, p->velocity );
-					}
-					else if ( bp->velMoveValues.dirType == PMD_LINEAR )
-					{
-						VectorCopy( bp->velMoveValues.dir, p->velocity );
-					}
-
-					break;
-
-				case PMT_STATIC_TRANSFORM:
-					if ( !CG_AttachmentAxis( &ps->attachment, transform ) )
-					{
-						return nullptr;
-					}
-
-					if ( bp->velMoveValues.dirType == PMD_POINT )
-					{
-						vec3_t transPoint;
-
-						VectorMatrixMultiply( bp->velMoveValues.point, transform, transPoint );
-						VectorSubtract( transPoint, p->origin, p->velocity );
-					}
-					else if ( bp->velMoveValues.dirType == PMD_LINEAR )
-					{
-						VectorMatrixMultiply( bp->velMoveValues.dir, transform, p->velocity );
-					}
-
-					break;
+				vec3_t transPoint;
 
-				case PMT_TAG:
-				case PMT_CENT_ANGLES:
-					if ( bp->velMoveValues.dirType == PMD_POINT )
-					{
-						VectorSubtract( attachmentPoint, p->origin, p->velocity );
-					}
-					else if ( bp->velMoveValues.dirType == PMD_LINEAR )
-					{
-						if ( !CG_AttachmentDir( &ps->attachment, p->velocity ) )
-						{
-							return nullptr;
-						}
-					}
+				VectorMatrixMultiply( bp->velMoveValues.point, transform, transPoint );
+				VectorSubtract( transPoint, p->origin, p->velocity );
+			}
+			else if ( bp->velMoveValues.dirType == PMD_LINEAR )
+			{
+				VectorMatrixMultiply( bp->velMoveValues.dir, transform, p->velocity );
+			}
 
-					break;
+			break;
 
-				case PMT_NORMAL:
-					if ( !ps->normalValid )
-					{
-						Log::Warn("a particle with velocityType "
-						           "normal has no normal" );
-						return nullptr;
-					}
+		case PMT_TAG:
+		case PMT_CENT_ANGLES:
+			if ( bp->velMoveValues.dirType == PMD_POINT )
+			{
+				VectorSubtract( attachmentPoint, p->origin, p->velocity );
+			}
+			else if ( bp->velMoveValues.dirType == PMD_LINEAR )
+			{
+				if ( !CG_AttachmentDir( &ps->attachment, p->velocity ) )
+				{
+					return nullptr;
+				}
+			}
 
-					VectorCopy( ps->normal, p->velocity );
+			break;
 
-					//normal displacement
-					VectorNormalize( p->velocity );
-					VectorMA( p->origin, bp->normalDisplacement, p->velocity, p->origin );
-					break;
+		case PMT_NORMAL:
+			if ( !ps->normalValid )
+			{
+				Log::Warn("a particle with velocityType "
+				           "normal has no normal" );
+				return nullptr;
+			}
 
-				case PMT_LAST_NORMAL:
-					VectorCopy( ps->lastNormal, p->velocity );
-					VectorNormalize( p->velocity );
-					VectorMA( p->origin, bp->normalDisplacement, p->velocity, p->origin );
-					break;
+			VectorCopy( ps->normal, p->velocity );
 
-				case PMT_OPPORTUNISTIC_NORMAL:
-					if ( ps->lastNormalIsCurrent )
-					{
-						VectorCopy( ps->lastNormal, p->velocity );
-						VectorNormalize( p->velocity );
-						VectorMA( p->origin, bp->normalDisplacement, p->velocity, p->origin );
-					}
-					break;
-			}
+			//normal displacement
+			VectorNormalize( p->velocity );
+			VectorMA( p->origin, bp->normalDisplacement, p->velocity, p->origin );
+			break;
 
+		case PMT_LAST_NORMAL:
+			VectorCopy( ps->lastNormal, p->velocity );
 			VectorNormalize( p->velocity );
-			CG_SpreadVector( p->velocity, bp->velMoveValues.dirRandAngle );
-			VectorScale( p->velocity,
-			             CG_RandomiseValue( bp->velMoveValues.mag, bp->velMoveValues.magRandFrac ),
-			             p->velocity );
+			VectorMA( p->origin, bp->normalDisplacement, p->velocity, p->origin );
+			break;
 
-			if ( CG_AttachmentVelocity( &ps->attachment, attachmentVelocity ) )
+		case PMT_OPPORTUNISTIC_NORMAL:
+			if ( ps->lastNormalIsCurrent )
 			{
-				VectorMA( p->velocity,
-				          CG_RandomiseValue( bp->velMoveValues.parentVelFrac,
-				                             bp->velMoveValues.parentVelFracRandFrac ), attachmentVelocity, p->velocity );
+				VectorCopy( ps->lastNormal, p->velocity );
+				VectorNormalize( p->velocity );
+				VectorMA( p->origin, bp->normalDisplacement, p->velocity, p->origin );
 			}
+			break;
+	}
 
-			p->lastEvalTime = cg.time;
+	VectorNormalize( p->velocity );
+	CG_SpreadVector( p->velocity, bp->velMoveValues.dirRandAngle );
+	VectorScale( p->velocity,
+	             CG_RandomiseValue( bp->velMoveValues.mag, bp->velMoveValues.magRandFrac ),
+	             p->velocity );
 
-			p->valid = true;
+	if ( CG_AttachmentVelocity( &ps->attachment, attachmentVelocity ) )
+	{
+		VectorMA( p->velocity,
+		          CG_RandomiseValue( bp->velMoveValues.parentVelFrac,
+		                             bp->velMoveValues.parentVelFracRandFrac ), attachmentVelocity, p->velocity );
+	}
 
-			//this particle has a child particle system attached
-			if ( bp->childSystemName[ 0 ] != '\0' )
-			{
-				particleSystem_t *chps = CG_SpawnNewParticleSystem( bp->childSystemHandle );
+	p->lastEvalTime = cg.time;
 
-				if ( CG_IsParticleSystemValid( &chps ) )
-				{
-					CG_SetAttachmentParticle( &chps->attachment, p );
-					CG_AttachToParticle( &chps->attachment );
-					p->childParticleSystem = chps;
-
-					if ( ps->lastNormalIsCurrent )
-						CG_SetParticleSystemLastNormal( chps, ps->lastNormal );
-					else
-						VectorCopy( ps->lastNormal, chps->lastNormal );
-				}
-			}
+	p->valid = true;
+	pe->numParticles++;
+	CG_CommitPoolEntry( &particles, p );
+	unsortedParticles.push_back( p );
 
-			//this particle has a child trail system attached
-			if ( bp->childTrailSystemName[ 0 ] != '\0' )
-			{
-				trailSystem_t *ts = CG_SpawnNewTrailSystem( bp->childTrailSystemHandle );
+	//this particle has a child particle system attached
+	if ( bp->childSystemName[ 0 ] != '\0' )
+	{
+		particleSystem_t *chps;
 
-				if ( CG_IsTrailSystemValid( &ts ) )
-				{
-					CG_SetAttachmentParticle( &ts->frontAttachment, p );
-					CG_AttachToParticle( &ts->frontAttachment );
-				}
-			}
+		particleSpawningChild = true;
+		chps = CG_SpawnNewParticleSystem( bp->childSystemHandle );
+		particleSpawningChild = false;
 
-			break;
+		if ( CG_IsParticleSystemValid( &chps ) )
+		{
+			CG_SetAttachmentParticle( &chps->attachment, p );
+			CG_AttachToParticle( &chps->attachment );
+			p->childParticleSystem = chps;
+
+			if ( ps->lastNormalIsCurrent )
+				CG_SetParticleSystemLastNormal( chps, ps->lastNormal );
+			else
+				VectorCopy( ps->lastNormal, chps->lastNormal );
+		}
+	}
+
+	//this particle has a child trail system attached
+	//trails would outlive the benchmark's particles, so don't make them there
+	if ( bp->childTrailSystemName[ 0 ] != '\0' && !particleBenchmark.running )
+	{
+		trailSystem_t *ts = CG_SpawnNewTrailSystem( bp->childTrailSystemHandle );
+
+		if ( CG_IsTrailSystemValid( &ts ) )
+		{
+			CG_SetAttachmentParticle( &ts->frontAttachment, p );
+			CG_AttachToParticle( &ts->frontAttachment );
 		}
 	}
 
@@ -373,75 +597,58 @@ introducing new particles
 static void CG_SpawnNewParticles()
 {
 	int                   i, j;
-	particle_t            *p;
 	particleSystem_t      *ps;
 	particleEjector_t     *pe;
 	baseParticleEjector_t *bpe;
 	float                 lerpFrac;
-	int                   count;
 
-	for ( i = 0; i < MAX_PARTICLE_EJECTORS; i++ )
+	//walk backwards so that ejectors removed from the live list, or
+	//added to it by child systems, are not visited twice
+	for ( i = particleEjectors.live.size() - 1; i >= 0; i-- )
 	{
-		pe = &particleEjectors[ i ];
+		pe = particleEjectors.live[ i ];
 		ps = pe->parent;
 
-		if ( pe->valid )
+		//a non attached particle system can't make particles
+		if ( !CG_Attached( &ps->attachment ) )
 		{
-			//a non attached particle system can't make particles
-			if ( !CG_Attached( &ps->attachment ) )
-			{
-				continue;
-			}
+			continue;
+		}
 
-			bpe = particleEjectors[ i ].class_;
+		bpe = pe->class_;
 
-			//if this system is scheduled for removal don't make any new particles
-			if ( !ps->lazyRemove )
+		//if this system is scheduled for removal don't make any new particles
+		if ( !ps->lazyRemove )
+		{
+			while ( pe->nextEjectionTime <= cg.time &&
+			        ( pe->count > 0 || pe->totalParticles == PARTICLES_INFINITE ) )
 			{
-				while ( pe->nextEjectionTime <= cg.time &&
-				        ( pe->count > 0 || pe->totalParticles == PARTICLES_INFINITE ) )
+				for ( j = 0; j < bpe->numParticles; j++ )
 				{
-					for ( j = 0; j < bpe->numParticles; j++ )
-					{
-						CG_SpawnNewParticle( bpe->particles[ j ], pe );
-					}
-
-					if ( pe->count > 0 )
-					{
-						pe->count--;
-					}
-
-					//calculate next ejection time
-					lerpFrac = 1.0 - ( ( float ) pe->count / ( float ) pe->totalParticles );
-					pe->nextEjectionTime = cg.time + ( int ) CG_RandomiseValue(
-					                         CG_LerpValues( pe->ejectPeriod.initial,
-					                                        pe->ejectPeriod.final,
-					                                        lerpFrac ),
-					                         pe->ejectPeriod.randFrac );
+					CG_SpawnNewParticle( bpe->particles[ j ], pe );
 				}
-			}
 
-			if ( pe->count == 0 || ps->lazyRemove )
-			{
-				count = 0;
-
-				//wait for child particles to die before declaring this pe invalid
-				for ( j = 0; j < MAX_PARTICLES; j++ )
+				if ( pe->count > 0 )
 				{
-					p = &particles[ j ];
-
-					if ( p->valid && p->parent == pe )
-					{
-						count++;
-					}
+					pe->count--;
 				}
 
-				if ( !count )
-				{
-					pe->valid = false;
-				}
+				//calculate next ejection time
+				lerpFrac = 1.0 - ( ( float ) pe->count / ( float ) pe->totalParticles );
+				pe->nextEjectionTime = cg.time + ( int ) CG_RandomiseValue(
+				                         CG_LerpValues( pe->ejectPeriod.initial,
+				                                        pe->ejectPeriod.final,
+				                                        lerpFrac ),
+				                         pe->ejectPeriod.randFrac );
 			}
 		}
+
+		//wait for child particles to die before declaring this pe invalid
+		if ( ( pe->count == 0 || ps->lazyRemove ) && !pe->numParticles )
+		{
+			pe->valid = false;
+			CG_FreePoolEntry( &particleEjectors, pe );
+		}
 	}
 }
 
@@ -455,40 +662,37 @@ Allocate a new particle ejector
 static particleEjector_t *CG_SpawnNewParticleEjector( baseParticleEjector_t *bpe,
     particleSystem_t *parent )
 {
-	int               i;
-	particleEjector_t *pe = nullptr;
+	particleEjector_t *pe;
 	particleSystem_t  *ps = parent;
 
-	for ( i = 0; i < MAX_PARTICLE_EJECTORS; i++ )
-	{
-		pe = &particleEjectors[ i ];
+	pe = CG_PeekPoolEntry( &particleEjectors );
 
-		if ( !pe->valid )
-		{
-			memset( pe, 0, sizeof( particleEjector_t ) );
+	if ( !pe )
+	{
+		return nullptr;
+	}
 
-			//found a free slot
-			pe->class_ = bpe;
-			pe->parent = ps;
+	memset( pe, 0, sizeof( particleEjector_t ) );
 
-			pe->ejectPeriod.initial = bpe->eject.initial;
-			pe->ejectPeriod.final = bpe->eject.final;
-			pe->ejectPeriod.randFrac = bpe->eject.randFrac;
+	//found a free slot
+	pe->class_ = bpe;
+	pe->parent = ps;
 
-			pe->nextEjectionTime = cg.time +
-			                       ( int ) CG_RandomiseValue( ( float ) bpe->eject.delay, bpe->eject.delayRandFrac );
-			pe->count = pe->totalParticles =
-			              ( int ) rint( CG_RandomiseValue( ( float ) bpe->totalParticles, bpe->totalParticlesRandFrac ) );
+	pe->ejectPeriod.initial = bpe->eject.initial;
+	pe->ejectPeriod.final = bpe->eject.final;
+	pe->ejectPeriod.randFrac = bpe->eject.randFrac;
 
-			pe->valid = true;
+	pe->nextEjectionTime = cg.time +
+	                       ( int ) CG_RandomiseValue( ( float ) bpe->eject.delay, bpe->eject.delayRandFrac );
+	pe->count = pe->totalParticles =
+	              ( int ) rint( CG_RandomiseValue( ( float ) bpe->totalParticles, bpe->totalParticlesRandFrac ) );
 
-			if ( cg_debugParticles.integer >= 1 )
-			{
-				Log::Debug( "PE %s created", ps->class_->name );
-			}
+	pe->valid = true;
+	CG_CommitPoolEntry( &particleEjectors, pe );
 
-			break;
-		}
+	if ( cg_debugParticles.integer >= 1 )
+	{
+		Log::Debug( "PE %s created", ps->class_->name );
 	}
 
 	return pe;
@@ -503,8 +707,9 @@ Allocate a new particle system
 */
 particleSystem_t *CG_SpawnNewParticleSystem( qhandle_t psHandle )
 {
-	int                  i, j;
-	particleSystem_t     *ps = nullptr;
+	int                  j;
+	particleSystem_t     *ps;
+	particleEjector_t    *pe;
 	baseParticleSystem_t *bps = &baseParticleSystems[ psHandle - 1 ];
 
 	if ( !bps->registered )
@@ -513,35 +718,45 @@ particleSystem_t *CG_SpawnNewParticleSystem( qhandle_t psHandle )
 		return nullptr;
 	}
 
-	for ( i = 0; i < MAX_PARTICLE_SYSTEMS; i++ )
+	ps = CG_PeekPoolEntry( &particleSystems );
+
+	if ( !ps )
 	{
-		ps = &particleSystems[ i ];
+		return nullptr;
+	}
 
-		if ( !ps->valid )
-		{
-			memset( ps, 0, sizeof( particleSystem_t ) );
+	memset( ps, 0, sizeof( particleSystem_t ) );
 
-			//found a free slot
-			ps->class_ = bps;
+	//found a free slot
+	ps->class_ = bps;
 
-			ps->valid = true;
-			ps->lazyRemove = false;
+	ps->valid = true;
+	ps->lazyRemove = false;
+	CG_CommitPoolEntry( &particleSystems, ps );
 
-			// use "up" as an arbitrary (non-null) "last" normal
-			VectorSet( ps->lastNormal, 0, 0, 1 );
+	// use "up" as an arbitrary (non-null) "last" normal
+	VectorSet( ps->lastNormal, 0, 0, 1 );
 
-			for ( j = 0; j < bps->numEjectors; j++ )
-			{
-				CG_SpawnNewParticleEjector( bps->ejectors[ j ], ps );
-			}
+	for ( j = 0; j < bps->numEjectors; j++ )
+	{
+		if ( ( pe = CG_SpawnNewParticleEjector( bps->ejectors[ j ], ps ) ) != nullptr )
+		{
+			ps->ejectors[ ps->numEjectors++ ] = pe;
+		}
+	}
 
-			if ( cg_debugParticles.integer >= 1 )
-			{
-				Log::Debug( "PS %s created", bps->name );
-			}
+	if ( cg_debugParticles.integer >= 1 )
+	{
+		Log::Debug( "PS %s created", bps->name );
+	}
 
-			break;
-		}
+	if ( particleBenchmark.recording && !particleBenchmark.running && !particleSpawningChild )
+	{
+		particleBenchmarkSpawn_t spawn;
+
+		spawn.ps = ps;
+		spawn.time = cg.time - particleBenchmark.startTime;
+		particleBenchmark.pending.push_back( spawn );
 	}
 
 	return ps;
@@ -2004,9 +2219,9 @@ void CG_DestroyParticleSystem( particleSystem_t **ps )
 		Log::Debug( "PS destroyed" );
 	}
 
-	for ( i = 0; i < MAX_PARTICLE_EJECTORS; i++ )
+	for ( i = 0; i < ( *ps )->numEjectors; i++ )
 	{
-		pe = &particleEjectors[ i ];
+		pe = ( *ps )->ejectors[ i ];
 
 		if ( pe->valid && pe->parent == *ps )
 		{
@@ -2047,9 +2262,9 @@ bool CG_IsParticleSystemInfinite( particleSystem_t *ps )
 		return false;
 	}
 
-	for ( i = 0; i < MAX_PARTICLE_EJECTORS; i++ )
+	for ( i = 0; i < ps->numEjectors; i++ )
 	{
-		pe = &particleEjectors[ i ];
+		pe = ps->ejectors[ i ];
 
 		if ( pe->valid && pe->parent == ps )
 		{
@@ -2099,20 +2314,16 @@ static void CG_GarbageCollectParticleSystems()
 	particleEjector_t *pe;
 	int               centNum;
 
-	for ( i = 0; i < MAX_PARTICLE_SYSTEMS; i++ )
+	//walk backwards so that removing systems doesn't skip any
+	for ( i = particleSystems.live.size() - 1; i >= 0; i-- )
 	{
-		ps = &particleSystems[ i ];
+		ps = particleSystems.live[ i ];
 		count = 0;
 
-		//don't bother checking already invalid systems
-		if ( !ps->valid )
+		//ejector slots are reused once they die, so check the parent too
+		for ( j = 0; j < ps->numEjectors; j++ )
 		{
-			continue;
-		}
-
-		for ( j = 0; j < MAX_PARTICLE_EJECTORS; j++ )
-		{
-			pe = &particleEjectors[ j ];
+			pe = ps->ejectors[ j ];
 
 			if ( pe->valid && pe->parent == ps )
 			{
@@ -2123,6 +2334,7 @@ static void CG_GarbageCollectParticleSystems()
 		if ( !count )
 		{
 			ps->valid = false;
+			CG_FreePoolEntry( &particleSystems, ps );
 		}
 
 		//check systems where the parent cent has left the PVS
@@ -2170,27 +2382,18 @@ static float CG_CalculateTimeFrac( int birth, int life, int delay )
 
 /*
 ===============
-CG_EvaluateParticlePhysics
+CG_ParticleAcceleration
 
-Compute the physics on a specific particle
+Compute the acceleration of a specific particle, returns false if the
+particle can't be evaluated this frame
 ===============
 */
-static void CG_EvaluateParticlePhysics( particle_t *p )
+static bool CG_ParticleAcceleration( particle_t *p, vec3_t acceleration )
 {
 	particleSystem_t *ps = p->parent->parent;
 	baseParticle_t   *bp = p->class_;
-	vec3_t           acceleration, newOrigin;
-	vec3_t           mins, maxs;
-	float            deltaTime, bounce, radius, dot;
-	trace_t          trace;
 	vec3_t           transform[ 3 ];
 
-	if ( p->atRest )
-	{
-		VectorClear( p->velocity );
-		return;
-	}
-
 	switch ( bp->accMoveType )
 	{
 		case PMT_STATIC:
@@ -2208,7 +2411,7 @@ static void CG_EvaluateParticlePhysics( particle_t *p )
 		case PMT_STATIC_TRANSFORM:
 			if ( !CG_AttachmentAxis( &ps->attachment, transform ) )
 			{
-				return;
+				return false;
 			}
 
 			if ( bp->accMoveValues.dirType == PMD_POINT )
@@ -2233,7 +2436,7 @@ static void CG_EvaluateParticlePhysics( particle_t *p )
 
 				if ( !CG_AttachmentPoint( &ps->attachment, point ) )
 				{
-					return;
+					return false;
 				}
 
 				VectorSubtract( point, p->origin, acceleration );
@@ -2242,7 +2445,7 @@ static void CG_EvaluateParticlePhysics( particle_t *p )
 			{
 				if ( !CG_AttachmentDir( &ps->attachment, acceleration ) )
 				{
-					return;
+					return false;
 				}
 			}
 
@@ -2251,7 +2454,7 @@ static void CG_EvaluateParticlePhysics( particle_t *p )
 		case PMT_NORMAL:
 			if ( !ps->normalValid )
 			{
-				return;
+				return false;
 			}
 
 			VectorCopy( ps->normal, acceleration );
@@ -2305,6 +2508,24 @@ static void CG_EvaluateParticlePhysics( particle_t *p )
 		             acceleration );
 	}
 
+	return true;
+}
+
+/*
+===============
+CG_CollideParticle
+
+Trace a particle that may bounce from its origin to newOrigin
+===============
+*/
+static void CG_CollideParticle( particle_t *p, const vec3_t newOrigin )
+{
+	particleSystem_t *ps = p->parent->parent;
+	baseParticle_t   *bp = p->class_;
+	vec3_t           mins, maxs;
+	float            bounce, radius, dot;
+	trace_t          trace;
+
 	// Some particles have a visual radius that differs from their collision radius
 	if ( bp->physicsRadius )
 	{
@@ -2322,28 +2543,6 @@ static void CG_EvaluateParticlePhysics( particle_t *p )
 
 	bounce = CG_RandomiseValue( bp->bounceFrac, bp->bounceFracRandFrac );
 
-	deltaTime = ( float )( cg.time - p->lastEvalTime ) * 0.001;
-	VectorMA( p->velocity, deltaTime, acceleration, p->velocity );
-	VectorMA( p->origin, deltaTime, p->velocity, newOrigin );
-	p->lastEvalTime = cg.time;
-
-	// we're not doing particle physics, but at least cull them in solids
-	if ( !cg_bounceParticles.integer )
-	{
-		int contents = trap_CM_PointContents( newOrigin, 0 );
-
-		if ( ( contents & CONTENTS_SOLID ) || ( contents & CONTENTS_NODROP ) )
-		{
-			CG_DestroyParticle( p, nullptr );
-		}
-		else
-		{
-			VectorCopy( newOrigin, p->origin );
-		}
-
-		return;
-	}
-
 	CG_Trace( &trace, p->origin, mins, maxs, newOrigin, CG_AttachmentCentNum( &ps->attachment ),
 	          CONTENTS_SOLID, 0 );
 
@@ -2382,14 +2581,14 @@ static void CG_EvaluateParticlePhysics( particle_t *p )
 		p->atRest = true;
 	}
 
-	if ( bp->bounceMarkName[ 0 ] && p->bounceMarkCount > 0 )
+	if ( bp->bounceMarkName[ 0 ] && p->bounceMarkCount > 0 && !particleBenchmark.running )
 	{
 		CG_ImpactMark( bp->bounceMark, trace.endpos, trace.plane.normal,
 		               random() * 360, 1, 1, 1, 1, true, bp->bounceMarkRadius, false );
 		p->bounceMarkCount--;
 	}
 
-	if ( bp->bounceSoundName[ 0 ] && p->bounceSoundCount > 0 )
+	if ( bp->bounceSoundName[ 0 ] && p->bounceSoundCount > 0 && !particleBenchmark.running )
 	{
 		trap_S_StartSound( trace.endpos, ENTITYNUM_WORLD, soundChannel_t::CHAN_AUTO, bp->bounceSound );
 		p->bounceSoundCount--;
@@ -2404,6 +2603,286 @@ static void CG_EvaluateParticlePhysics( particle_t *p )
 	}
 }
 
+/*
+===============
+CG_ReserveParticleBatch
+
+Make room in the batch for every live particle
+===============
+*/
+static void CG_ReserveParticleBatch( size_t size )
+{
+	particleBatch_t *b = &particleBatch;
+
+	if ( b->particle.size() >= size )
+	{
+		return;
+	}
+
+	b->particle.resize( size );
+	b->skip.resize( size );
+	b->dt.resize( size );
+
+	for ( std::vector<float> *v : { &b->ox, &b->oy, &b->oz, &b->vx, &b->vy, &b->vz,
+	                                &b->ax, &b->ay, &b->az, &b->nx, &b->ny, &b->nz } )
+	{
+		v->resize( size );
+	}
+
+	gatheredParticles.resize( size );
+}
+
+/*
+===============
+CG_GatherParticles
+
+Destroy expired particles and gather the moving ones into the batch,
+grouped by particle class
+===============
+*/
+static void CG_GatherParticles()
+{
+	particleBatch_t *b = &particleBatch;
+	particleGroup_t *g;
+	particle_t      *p;
+	int             i, n = 0, total = 0;
+	int             c;
+
+	numParticleGroups = 0;
+
+	CG_ReserveParticleBatch( particles.live.size() );
+
+	//walk backwards so that destroying particles doesn't skip any
+	for ( i = particles.live.size() - 1; i >= 0; i-- )
+	{
+		p = particles.live[ i ];
+
+		if ( p->birthTime + p->lifeTime <= cg.time )
+		{
+			CG_DestroyParticle( p, nullptr );
+			continue;
+		}
+
+		if ( p->atRest )
+		{
+			VectorClear( p->velocity );
+			continue;
+		}
+
+		c = p->class_ - baseParticles;
+
+		if ( !particleGroupIndex[ c ] )
+		{
+			g = &particleGroups[ numParticleGroups ];
+			g->class_ = p->class_;
+			g->start = 0;
+			g->count = 0;
+			particleGroupIndex[ c ] = ++numParticleGroups;
+		}
+
+		particleGroups[ particleGroupIndex[ c ] - 1 ].count++;
+		gatheredParticles[ n++ ] = p;
+	}
+
+	for ( i = 0; i < numParticleGroups; i++ )
+	{
+		particleGroups[ i ].start = total;
+		total += particleGroups[ i ].count;
+		particleGroups[ i ].count = 0;
+	}
+
+	for ( i = 0; i < n; i++ )
+	{
+		p = gatheredParticles[ i ];
+		g = &particleGroups[ particleGroupIndex[ p->class_ - baseParticles ] - 1 ];
+		b->particle[ g->start + g->count++ ] = p;
+	}
+
+	for ( i = 0; i < numParticleGroups; i++ )
+	{
+		particleGroupIndex[ particleGroups[ i ].class_ - baseParticles ] = 0;
+	}
+
+	b->count = n;
+}
+
+/*
+===============
+CG_LoadParticleGroup
+
+Evaluate the accelerations of a group and load its state into the batch
+===============
+*/
+static void CG_LoadParticleGroup( const particleGroup_t *g )
+{
+	particleBatch_t *b = &particleBatch;
+	particle_t      *p;
+	vec3_t          acceleration;
+
+	for ( int i = g->start; i < g->start + g->count; i++ )
+	{
+		p = b->particle[ i ];
+
+		if ( CG_ParticleAcceleration( p, acceleration ) )
+		{
+			b->skip[ i ] = false;
+			b->dt[ i ] = ( float )( cg.time - p->lastEvalTime ) * 0.001f;
+		}
+		else
+		{
+			VectorClear( acceleration );
+			b->skip[ i ] = true;
+			b->dt[ i ] = 0.0f;
+		}
+
+		b->ox[ i ] = p->origin[ 0 ];
+		b->oy[ i ] = p->origin[ 1 ];
+		b->oz[ i ] = p->origin[ 2 ];
+		b->vx[ i ] = p->velocity[ 0 ];
+		b->vy[ i ] = p->velocity[ 1 ];
+		b->vz[ i ] = p->velocity[ 2 ];
+		b->ax[ i ] = acceleration[ 0 ];
+		b->ay[ i ] = acceleration[ 1 ];
+		b->az[ i ] = acceleration[ 2 ];
+	}
+}
+
+/*
+===============
+CG_IntegrateParticles
+
+Advance velocities and compute the new origins of the whole batch
+===============
+*/
+static void CG_IntegrateParticles()
+{
+	particleBatch_t *b = &particleBatch;
+	int             i = 0;
+
+#ifdef PARTICLE_SSE
+	for ( ; i + 4 <= b->count; i += 4 )
+	{
+		__m128 dt = _mm_loadu_ps( &b->dt[ i ] );
+		__m128 vx = _mm_add_ps( _mm_loadu_ps( &b->vx[ i ] ), _mm_mul_ps( dt, _mm_loadu_ps( &b->ax[ i ] ) ) );
+		__m128 vy = _mm_add_ps( _mm_loadu_ps( &b->vy[ i ] ), _mm_mul_ps( dt, _mm_loadu_ps( &b->ay[ i ] ) ) );
+		__m128 vz = _mm_add_ps( _mm_loadu_ps( &b->vz[ i ] ), _mm_mul_ps( dt, _mm_loadu_ps( &b->az[ i ] ) ) );
+
+		_mm_storeu_ps( &b->vx[ i ], vx );
+		_mm_storeu_ps( &b->vy[ i ], vy );
+		_mm_storeu_ps( &b->vz[ i ], vz );
+
+		_mm_storeu_ps( &b->nx[ i ], _mm_add_ps( _mm_loadu_ps( &b->ox[ i ] ), _mm_mul_ps( dt, vx ) ) );
+		_mm_storeu_ps( &b->ny[ i ], _mm_add_ps( _mm_loadu_ps( &b->oy[ i ] ), _mm_mul_ps( dt, vy ) ) );
+		_mm_storeu_ps( &b->nz[ i ], _mm_add_ps( _mm_loadu_ps( &b->oz[ i ] ), _mm_mul_ps( dt, vz ) ) );
+	}
+#endif
+
+	for ( ; i < b->count; i++ )
+	{
+		b->vx[ i ] += b->dt[ i ] * b->ax[ i ];
+		b->vy[ i ] += b->dt[ i ] * b->ay[ i ];
+		b->vz[ i ] += b->dt[ i ] * b->az[ i ];
+
+		b->nx[ i ] = b->ox[ i ] + b->dt[ i ] * b->vx[ i ];
+		b->ny[ i ] = b->oy[ i ] + b->dt[ i ] * b->vy[ i ];
+		b->nz[ i ] = b->oz[ i ] + b->dt[ i ] * b->vz[ i ];
+	}
+}
+
+/*
+===============
+CG_ResolveParticleGroup
+
+Write the integrated state of a group back to its particles, tracing
+only the ones whose class can bounce
+===============
+*/
+static void CG_ResolveParticleGroup( const particleGroup_t *g )
+{
+	particleBatch_t *b = &particleBatch;
+	baseParticle_t  *bp = g->class_;
+	particle_t      *p;
+	vec3_t          newOrigin;
+	bool            collides;
+
+	collides = bp->bounceFrac != 0.0f || bp->bounceFracRandFrac != 0.0f;
+
+	for ( int i = g->start; i < g->start + g->count; i++ )
+	{
+		if ( b->skip[ i ] )
+		{
+			continue;
+		}
+
+		p = b->particle[ i ];
+
+		VectorSet( p->velocity, b->vx[ i ], b->vy[ i ], b->vz[ i ] );
+		VectorSet( newOrigin, b->nx[ i ], b->ny[ i ], b->nz[ i ] );
+		p->lastEvalTime = cg.time;
+
+		// we're not doing particle physics, but at least cull them in solids
+		if ( !cg_bounceParticles.integer )
+		{
+			int contents = trap_CM_PointContents( newOrigin, 0 );
+
+			if ( ( contents & CONTENTS_SOLID ) || ( contents & CONTENTS_NODROP ) )
+			{
+				CG_DestroyParticle( p, nullptr );
+			}
+			else
+			{
+				VectorCopy( newOrigin, p->origin );
+			}
+
+			continue;
+		}
+
+		// a class without bounce never reacts to the trace
+		if ( !collides )
+		{
+			VectorCopy( newOrigin, p->origin );
+
+			if ( CG_IsParticleSystemValid( &p->childParticleSystem ) )
+				CG_SetParticleSystemLastNormal( p->childParticleSystem, nullptr );
+
+			continue;
+		}
+
+		CG_CollideParticle( p, newOrigin );
+	}
+}
+
+/*
+===============
+CG_SimulateParticles
+
+Compute the physics on all particles
+===============
+*/
+static void CG_SimulateParticles()
+{
+	int i;
+
+	CG_GatherParticles();
+
+	for ( i = 0; i < numParticleGroups; i++ )
+	{
+		CG_LoadParticleGroup( &particleGroups[ i ] );
+	}
+
+	CG_IntegrateParticles();
+
+	for ( i = 0; i < numParticleGroups; i++ )
+	{
+		CG_ResolveParticleGroup( &particleGroups[ i ] );
+	}
+
+	if ( particleBenchmark.running )
+	{
+		particleBenchmark.updates += particleBatch.count;
+	}
+}
+
 #define GETKEY(x,y) ((( x ) >> y ) & 0xFF )
 
 /*
@@ -2454,69 +2933,140 @@ static void CG_RadixSort( particle_t **source, particle_t **temp, int size )
 
 /*
 ===============
-CG_CompactAndSortParticles
+CG_SetParticleSortKeys
 
-Depth sort the particles
+Farther particles get smaller keys, so sorting the keys in ascending
+order gives back to front order directly
 ===============
 */
-static void CG_CompactAndSortParticles()
+static void CG_SetParticleSortKeys( particle_t **list, int count )
 {
-	int    i, j = 0;
-	int    numParticles;
 	vec3_t delta;
+	float  dist;
 
-	for ( i = 0; i < MAX_PARTICLES; i++ )
+	for ( int i = 0; i < count; i++ )
 	{
-		sortedParticles[ i ] = &particles[ i ];
-	}
+		VectorSubtract( list[ i ]->origin, cg.refdef.vieworg, delta );
+		dist = std::min( DotProduct( delta, delta ), ( float ) PARTICLE_SORT_RANGE );
 
-	if ( !cg_depthSortParticles.integer )
-	{
-		return;
+		list[ i ]->sortKey = PARTICLE_SORT_RANGE - ( int ) dist;
 	}
+}
+
+/*
+===============
+CG_InsertionSortParticles
 
-	for ( i = MAX_PARTICLES - 1; i >= 0; i-- )
+Repair an almost sorted list, giving up once more than budget moves
+were needed. The list is always left a permutation of its input
+===============
+*/
+static bool CG_InsertionSortParticles( particle_t **list, int count, int budget )
+{
+	for ( int i = 1; i < count; i++ )
 	{
-		if ( sortedParticles[ i ]->valid )
+		particle_t *p = list[ i ];
+		int        j = i;
+
+		while ( j > 0 && list[ j - 1 ]->sortKey > p->sortKey )
 		{
-			//find the first hole
-			while ( j < MAX_PARTICLES && sortedParticles[ j ]->valid )
-			{
-				j++;
-			}
+			list[ j ] = list[ j - 1 ];
+			j--;
 
-			//no more holes
-			if ( j >= i )
+			if ( --budget < 0 )
 			{
-				break;
+				list[ j ] = p;
+				return false;
 			}
-
-			sortedParticles[ j ] = sortedParticles[ i ];
 		}
+
+		list[ j ] = p;
 	}
 
-	numParticles = i;
+	return true;
+}
+
+/*
+===============
+CG_SortParticleList
+
+Sort a list of particles back to front, repairing the order of the
+previous frame when it is close enough and radix sorting otherwise
+===============
+*/
+static void CG_SortParticleList( std::vector<particle_t *> &list, std::vector<particle_t *> &temp )
+{
+	int count = list.size();
+
+	CG_SetParticleSortKeys( list.data(), count );
 
-	//set sort keys
-	for ( i = 0; i < numParticles; i++ )
+	if ( !CG_InsertionSortParticles( list.data(), count, PARTICLE_SORT_BUDGET * count ) )
 	{
-		VectorSubtract( sortedParticles[ i ]->origin, cg.refdef.vieworg, delta );
-		sortedParticles[ i ]->sortKey = ( int ) DotProduct( delta, delta );
+		temp.resize( count );
+		CG_RadixSort( list.data(), temp.data(), count );
 	}
+}
 
-	CG_RadixSort( sortedParticles, radixBuffer, numParticles );
+/*
+===============
+CG_SortParticles
+
+Depth sort the particles. The order is kept from frame to frame: dead
+particles are dropped from it and new ones appended before it is sorted
+again, which is usually only a few swaps
+===============
+*/
+static void CG_SortParticles()
+{
+	size_t     i, n = 0;
+	particle_t *p;
 
-	//FIXME: wtf?
-	//reverse order of particles array
-	for ( i = 0; i < numParticles; i++ )
+	if ( !cg_depthSortParticles.integer || !particleSortValid )
 	{
-		radixBuffer[ i ] = sortedParticles[ numParticles - i - 1 ];
-	}
+		sortedParticles.assign( particles.live.begin(), particles.live.end() );
+		unsortedParticles.clear();
+
+		particleSortValid = cg_depthSortParticles.integer != 0;
 
-	for ( i = 0; i < numParticles; i++ )
+		if ( !particleSortValid )
+		{
+			return;
+		}
+	}
+	else
 	{
-		sortedParticles[ i ] = radixBuffer[ i ];
+		//the stamp also catches a slot that was reused while it was
+		//still in the list
+		particleSortStamp++;
+
+		for ( i = 0; i < sortedParticles.size(); i++ )
+		{
+			p = sortedParticles[ i ];
+
+			if ( p->valid && p->sortStamp != particleSortStamp )
+			{
+				p->sortStamp = particleSortStamp;
+				sortedParticles[ n++ ] = p;
+			}
+		}
+
+		sortedParticles.resize( n );
+
+		for ( i = 0; i < unsortedParticles.size(); i++ )
+		{
+			p = unsortedParticles[ i ];
+
+			if ( p->valid && p->sortStamp != particleSortStamp )
+			{
+				p->sortStamp = particleSortStamp;
+				sortedParticles.push_back( p );
+			}
+		}
+
+		unsortedParticles.clear();
 	}
+
+	CG_SortParticleList( sortedParticles, radixBuffer );
 }
 
 /*
@@ -2700,9 +3250,12 @@ Add particles to the scene
 */
 void CG_AddParticles()
 {
-	int        i;
 	particle_t *p;
-	int        numPS = 0, numPE = 0, numP = 0;
+
+	if ( particleBenchmark.recording && !particleBenchmark.running )
+	{
+		CG_RecordParticleSpawns();
+	}
 
 	//remove expired particle systems
 	CG_GarbageCollectParticleSystems();
@@ -2711,54 +3264,31 @@ void CG_AddParticles()
 	CG_SpawnNewParticles();
 
 	//sorting
-	CG_CompactAndSortParticles();
+	CG_SortParticles();
 
-	for ( i = 0; i < MAX_PARTICLES; i++ )
-	{
-		p = sortedParticles[ i ];
+	//destroy expired particles and move the others
+	CG_SimulateParticles();
 
-		if ( p->valid )
+	if ( !particleBenchmark.running )
+	{
+		for ( size_t i = 0; i < sortedParticles.size(); i++ )
 		{
-			if ( p->birthTime + p->lifeTime > cg.time )
+			p = sortedParticles[ i ];
+
+			//particles destroyed by the simulation are still in the list
+			if ( p->valid )
 			{
-				//particle is active
-				CG_EvaluateParticlePhysics( p );
 				CG_RenderParticle( p );
 			}
-			else
-			{
-				CG_DestroyParticle( p, nullptr );
-			}
 		}
 	}
 
 	if ( cg_debugParticles.integer >= 2 )
 	{
-		for ( i = 0; i < MAX_PARTICLE_SYSTEMS; i++ )
-		{
-			if ( particleSystems[ i ].valid )
-			{
-				numPS++;
-			}
-		}
-
-		for ( i = 0; i < MAX_PARTICLE_EJECTORS; i++ )
-		{
-			if ( particleEjectors[ i ].valid )
-			{
-				numPE++;
-			}
-		}
-
-		for ( i = 0; i < MAX_PARTICLES; i++ )
-		{
-			if ( particles[ i ].valid )
-			{
-				numP++;
-			}
-		}
-
-		Log::Debug( "PS: %d  PE: %d  P: %d", numPS, numPE, numP );
+		Log::Debug( "PS: %d/%d (peak %d)  PE: %d/%d (peak %d)  P: %d/%d (peak %d)",
+		            ( int ) particleSystems.live.size(), particleSystems.size, particleSystems.highWater,
+		            ( int ) particleEjectors.live.size(), particleEjectors.size, particleEjectors.highWater,
+		            ( int ) particles.live.size(), particles.size, particles.highWater );
 	}
 }
 
@@ -2856,3 +3386,366 @@ void CG_TestPS_f()
 		}
 	}
 }
+
+/*
+===============
+Particle benchmark
+
+Emitter spawns can be recorded during play and replayed later without
+rendering, to measure the cost of the particle simulation alone. Every
+recorded system is replayed attached to the point where it was spawned.
+===============
+*/
+
+#define PARTICLE_BENCHMARK_FRAMETIME 16
+#define PARTICLE_BENCHMARK_FRAMES    1000
+
+/*
+===============
+CG_RecordParticleSpawns
+
+Resolve the origins of the systems spawned since the last frame
+===============
+*/
+static void CG_RecordParticleSpawns()
+{
+	for ( particleBenchmarkSpawn_t &spawn : particleBenchmark.pending )
+	{
+		particleSystem_t *ps = spawn.ps;
+
+		if ( !CG_IsParticleSystemValid( &ps ) || !CG_AttachmentPoint( &ps->attachment, spawn.origin ) )
+		{
+			continue;
+		}
+
+		Q_strncpyz( spawn.name, ps->class_->name, sizeof( spawn.name ) );
+		spawn.normalValid = ps->normalValid;
+		VectorCopy( ps->normal, spawn.normal );
+		spawn.ps = nullptr;
+
+		particleBenchmark.spawns.push_back( spawn );
+	}
+
+	particleBenchmark.pending.clear();
+}
+
+/*
+===============
+CG_WriteParticleBenchmark
+===============
+*/
+static void CG_WriteParticleBenchmark()
+{
+	fileHandle_t f;
+
+	if ( trap_FS_FOpenFile( particleBenchmark.fileName, &f, fsMode_t::FS_WRITE ) < 0 )
+	{
+		Log::Warn( "could not write %s", particleBenchmark.fileName );
+		return;
+	}
+
+	for ( const particleBenchmarkSpawn_t &spawn : particleBenchmark.spawns )
+	{
+		const char *line = va( "%d \"%s\" %f %f %f %f %f %f %d\n", spawn.time, spawn.name,
+		                       spawn.origin[ 0 ], spawn.origin[ 1 ], spawn.origin[ 2 ],
+		                       spawn.normal[ 0 ], spawn.normal[ 1 ], spawn.normal[ 2 ],
+		                       spawn.normalValid );
+
+		trap_FS_Write( line, strlen( line ), f );
+	}
+
+	trap_FS_FCloseFile( f );
+
+	Log::Notice( "recorded %d particle system spawns to %s",
+	             ( int ) particleBenchmark.spawns.size(), particleBenchmark.fileName );
+}
+
+/*
+===============
+CG_ReadParticleBenchmark
+===============
+*/
+static bool CG_ReadParticleBenchmark( const char *fileName, std::vector<particleBenchmarkSpawn_t> &spawns )
+{
+	fileHandle_t      f;
+	int               len;
+	std::vector<char> buffer;
+	const char        *text;
+	const char        *token;
+
+	len = trap_FS_FOpenFile( fileName, &f, fsMode_t::FS_READ );
+
+	if ( len <= 0 )
+	{
+		if ( len == 0 )
+		{
+			trap_FS_FCloseFile( f );
+		}
+
+		Log::Warn( "particle benchmark %s is missing or empty", fileName );
+		return false;
+	}
+
+	buffer.resize( len + 1 );
+	trap_FS_Read( buffer.data(), len, f );
+	trap_FS_FCloseFile( f );
+	buffer[ len ] = '\0';
+
+	text = buffer.data();
+
+	for ( ;; )
+	{
+		particleBenchmarkSpawn_t spawn;
+
+		token = COM_Parse( &text );
+
+		if ( !*token )
+		{
+			break;
+		}
+
+		spawn.ps = nullptr;
+		spawn.time = atoi( token );
+		Q_strncpyz( spawn.name, COM_Parse( &text ), sizeof( spawn.name ) );
+
+		for ( int i = 0; i < 3; i++ )
+		{
+			spawn.origin[ i ] = atof( COM_Parse( &text ) );
+		}
+
+		for ( int i = 0; i < 3; i++ )
+		{
+			spawn.normal[ i ] = atof( COM_Parse( &text ) );
+		}
+
+		spawn.normalValid = atoi( COM_Parse( &text ) ) != 0;
+
+		spawns.push_back( spawn );
+	}
+
+	return !spawns.empty();
+}
+
+/*
+===============
+CG_RunParticleBenchmark
+
+Replay the recorded spawns on empty particle pools for a fixed number of
+frames, then put the live particles back
+===============
+*/
+static void CG_RunParticleBenchmark( const char *fileName, int frames )
+{
+	std::vector<particleBenchmarkSpawn_t> spawns;
+	std::vector<qhandle_t>                handles;
+	particlePool_t<particleSystem_t>      savedSystems = { particleSystems.name, particleSystems.capacityName, particleSystems.capacity };
+	particlePool_t<particleEjector_t>     savedEjectors = { particleEjectors.name, particleEjectors.capacityName, particleEjectors.capacity };
+	particlePool_t<particle_t>            savedParticles = { particles.name, particles.capacityName, particles.capacity };
+	std::deque<particle_t *>              savedRetired;
+	int                                   savedTime = cg.time;
+	int                                   savedFrame = cg.clientFrame;
+	int                                   savedFrametime = cg.frametime;
+	size_t                                next = 0;
+	int                                   start, msec;
+
+	if ( !CG_ReadParticleBenchmark( fileName, spawns ) )
+	{
+		return;
+	}
+
+	for ( const particleBenchmarkSpawn_t &spawn : spawns )
+	{
+		handles.push_back( CG_RegisterParticleSystem( spawn.name ) );
+	}
+
+	//the live pools are set aside untouched, so pointers into them stay valid
+	std::swap( particleSystems, savedSystems );
+	std::swap( particleEjectors, savedEjectors );
+	std::swap( particles, savedParticles );
+	std::swap( retiredParticles, savedRetired );
+	particleSortValid = false;
+
+	particleBenchmark.running = true;
+	particleBenchmark.updates = 0;
+
+	start = trap_Milliseconds();
+
+	for ( int frame = 0; frame < frames; frame++ )
+	{
+		cg.time = savedTime + frame * PARTICLE_BENCHMARK_FRAMETIME;
+		cg.frametime = PARTICLE_BENCHMARK_FRAMETIME;
+		cg.clientFrame++;
+
+		for ( ; next < spawns.size() && spawns[ next ].time <= frame * PARTICLE_BENCHMARK_FRAMETIME; next++ )
+		{
+			particleSystem_t *ps;
+
+			if ( !handles[ next ] )
+			{
+				continue;
+			}
+
+			ps = CG_SpawnNewParticleSystem( handles[ next ] );
+
+			if ( CG_IsParticleSystemValid( &ps ) )
+			{
+				if ( spawns[ next ].normalValid )
+				{
+					CG_SetParticleSystemNormal( ps, spawns[ next ].normal );
+				}
+
+				CG_SetAttachmentPoint( &ps->attachment, spawns[ next ].origin );
+				CG_AttachToPoint( &ps->attachment );
+			}
+		}
+
+		CG_AddParticles();
+	}
+
+	msec = trap_Milliseconds() - start;
+
+	particleBenchmark.running = false;
+
+	//the benchmark's own pools are freed when they go out of scope
+	std::swap( particleSystems, savedSystems );
+	std::swap( particleEjectors, savedEjectors );
+	std::swap( particles, savedParticles );
+	std::swap( retiredParticles, savedRetired );
+	particleSortValid = false;
+
+	cg.time = savedTime;
+	cg.frametime = savedFrametime;
+	cg.clientFrame = savedFrame;
+
+	Log::Notice( "particle benchmark: %d frames, %d spawns, %d particle updates in %d msec, peak %d particles",
+	             frames, ( int ) next, particleBenchmark.updates, msec, savedParticles.highWater );
+}
+
+/*
+===============
+CG_ReferenceSortParticles
+
+The previous sorter, a full radix sort and a reversal every frame, kept
+to compare against in the sort benchmark
+===============
+*/
+static void CG_ReferenceSortParticles( std::vector<particle_t *> &list, std::vector<particle_t *> &temp )
+{
+	int    count = list.size();
+	vec3_t delta;
+
+	for ( int i = 0; i < count; i++ )
+	{
+		VectorSubtract( list[ i ]->origin, cg.refdef.vieworg, delta );
+		list[ i ]->sortKey = ( int ) DotProduct( delta, delta );
+	}
+
+	temp.resize( count );
+	CG_RadixSort( list.data(), temp.data(), count );
+
+	for ( int i = 0; i < count; i++ )
+	{
+		temp[ i ] = list[ count - i - 1 ];
+	}
+
+	for ( int i = 0; i < count; i++ )
+	{
+		list[ i ] = temp[ i ];
+	}
+}
+
+/*
+===============
+CG_RunParticleSortBenchmark
+
+Sort drifting clouds of particles around the view with both sorters
+===============
+*/
+static void CG_RunParticleSortBenchmark( int frames )
+{
+	static const int counts[] = { 256, 1024, 4096, 16384 };
+
+	for ( int count : counts )
+	{
+		std::vector<particle_t>   cloud( count );
+		std::vector<particle_t *> reference( count ), coherent( count ), temp;
+		int                       referenceMsec = 0, coherentMsec = 0;
+
+		for ( int i = 0; i < count; i++ )
+		{
+			particle_t *p = &cloud[ i ];
+
+			for ( int j = 0; j < 3; j++ )
+			{
+				p->origin[ j ] = cg.refdef.vieworg[ j ] + crandom() * 1024.0f;
+				p->velocity[ j ] = crandom() * 200.0f;
+			}
+
+			reference[ i ] = coherent[ i ] = p;
+		}
+
+		for ( int frame = 0; frame < frames; frame++ )
+		{
+			int start;
+
+			for ( particle_t &p : cloud )
+			{
+				VectorMA( p.origin, PARTICLE_BENCHMARK_FRAMETIME * 0.001f, p.velocity, p.origin );
+			}
+
+			start = trap_Milliseconds();
+			CG_ReferenceSortParticles( reference, temp );
+			referenceMsec += trap_Milliseconds() - start;
+
+			start = trap_Milliseconds();
+			CG_SortParticleList( coherent, temp );
+			coherentMsec += trap_Milliseconds() - start;
+		}
+
+		Log::Notice( "particle sort benchmark: %5d particles, %d frames: radix %d msec, coherent %d msec",
+		             count, frames, referenceMsec, coherentMsec );
+	}
+}
+
+/*
+===============
+CG_ParticleBenchmark_f
+
+particleBenchmark record <file> | stop | run <file> [frames] | sort [frames]
+===============
+*/
+void CG_ParticleBenchmark_f()
+{
+	const char *cmd = CG_Argv( 1 );
+
+	if ( !Q_stricmp( cmd, "record" ) && trap_Argc() >= 3 )
+	{
+		Q_strncpyz( particleBenchmark.fileName, CG_Argv( 2 ), sizeof( particleBenchmark.fileName ) );
+		particleBenchmark.spawns.clear();
+		particleBenchmark.pending.clear();
+		particleBenchmark.startTime = cg.time;
+		particleBenchmark.recording = true;
+	}
+	else if ( !Q_stricmp( cmd, "stop" ) && particleBenchmark.recording )
+	{
+		CG_RecordParticleSpawns();
+		particleBenchmark.recording = false;
+		CG_WriteParticleBenchmark();
+	}
+	else if ( !Q_stricmp( cmd, "run" ) && trap_Argc() >= 3 )
+	{
+		int frames = trap_Argc() >= 4 ? atoi( CG_Argv( 3 ) ) : PARTICLE_BENCHMARK_FRAMES;
+
+		CG_RunParticleBenchmark( CG_Argv( 2 ), std::max( frames, 1 ) );
+	}
+	else if ( !Q_stricmp( cmd, "sort" ) )
+	{
+		int frames = trap_Argc() >= 3 ? atoi( CG_Argv( 2 ) ) : PARTICLE_BENCHMARK_FRAMES;
+
+		CG_RunParticleSortBenchmark( std::max( frames, 1 ) );
+	}
+	else
+	{
+		Log::Notice( "usage: particleBenchmark record <file> | stop | run <file> [frames] | sort [frames]" );
+	}
+}
@@ -32,6 +32,94 @@ static int               numBaseTrailBeams = 0;
 static trailSystem_t     trailSystems[ MAX_TRAIL_SYSTEMS ];
 static trailBeam_t       trailBeams[ MAX_TRAIL_BEAMS ];
 
+static_assert( ( MAX_TRAIL_BEAM_NODES & ( MAX_TRAIL_BEAM_NODES - 1 ) ) == 0,
+               "MAX_TRAIL_BEAM_NODES must be a power of two" );
+
+//free slots are popped from the back, live ones are kept dense
+static trailSystem_t     *freeTrailSystems[ MAX_TRAIL_SYSTEMS ];
+static int               numFreeTrailSystems = 0;
+static trailSystem_t     *liveTrailSystems[ MAX_TRAIL_SYSTEMS ];
+static int               numLiveTrailSystems = 0;
+
+static trailBeam_t       *freeTrailBeams[ MAX_TRAIL_BEAMS ];
+static int               numFreeTrailBeams = 0;
+static trailBeam_t       *liveTrailBeams[ MAX_TRAIL_BEAMS ];
+static int               numLiveTrailBeams = 0;
+
+/*
+===============
+CG_ClearTrailPools
+
+Put every trail system and beam on the free lists
+===============
+*/
+static void CG_ClearTrailPools()
+{
+	int i;
+
+	memset( trailSystems, 0, sizeof( trailSystems ) );
+	memset( trailBeams, 0, sizeof( trailBeams ) );
+
+	for ( i = 0; i < MAX_TRAIL_SYSTEMS; i++ )
+	{
+		freeTrailSystems[ i ] = &trailSystems[ MAX_TRAIL_SYSTEMS - 1 - i ];
+	}
+
+	for ( i = 0; i < MAX_TRAIL_BEAMS; i++ )
+	{
+		freeTrailBeams[ i ] = &trailBeams[ MAX_TRAIL_BEAMS - 1 - i ];
+	}
+
+	numFreeTrailSystems = MAX_TRAIL_SYSTEMS;
+	numLiveTrailSystems = 0;
+	numFreeTrailBeams = MAX_TRAIL_BEAMS;
+	numLiveTrailBeams = 0;
+}
+
+/*
+===============
+CG_FreeTrailSystem
+===============
+*/
+static void CG_FreeTrailSystem( trailSystem_t *ts )
+{
+	trailSystem_t *last = liveTrailSystems[ --numLiveTrailSystems ];
+
+	liveTrailSystems[ ts->liveIndex ] = last;
+	last->liveIndex = ts->liveIndex;
+
+	ts->valid = false;
+	freeTrailSystems[ numFreeTrailSystems++ ] = ts;
+}
+
+/*
+===============
+CG_FreeTrailBeam
+===============
+*/
+static void CG_FreeTrailBeam( trailBeam_t *tb )
+{
+	trailBeam_t *last = liveTrailBeams[ --numLiveTrailBeams ];
+
+	liveTrailBeams[ tb->liveIndex ] = last;
+	last->liveIndex = tb->liveIndex;
+
+	tb->valid = false;
+	freeTrailBeams[ numFreeTrailBeams++ ] = tb;
+}
+
+/*
+===============
+CG_BeamNode
+
+Returns the nth node of a beam counting from the front
+===============
+*/
+static inline trailBeamNode_t *CG_BeamNode( trailBeam_t *tb, int n )
+{
+	return &tb->nodes[ ( tb->firstNode + n ) & ( MAX_TRAIL_BEAM_NODES - 1 ) ];
+}
+
 /*
 ===============
 CG_CalculateBeamNodeProperties
@@ -46,12 +134,12 @@ static void CG_CalculateBeamNodeProperties( trailBeam_t *tb )
 	baseTrailBeam_t *btb;
 	float           nodeDistances[ MAX_TRAIL_BEAM_NODES ];
 	float           totalDistance = 0.0f, position = 0.0f;
-	int             j, numNodes = 0;
+	int             j;
 	float           TCRange, widthRange, alphaRange;
 	vec3_t          colorRange;
 	float           fadeAlpha = 1.0f;
 
-	if ( !tb || !tb->nodes )
+	if ( !tb || !tb->numNodes )
 	{
 		return;
 	}
@@ -78,19 +166,17 @@ alphaRange = tb->class_->backAlpha -
 	VectorSubtract( tb->class_->backColor,
 	                tb->class_->frontColor, colorRange );
 
-	for ( i = tb->nodes; i && i->next; i = i->next )
-{
-		nodeDistances[ numNodes++ ] =
-		  Distance( i->position, i->next->position );
-	}
-
-	for ( j = 0; j < numNodes; j++ )
+	for ( j = 0; j < tb->numNodes - 1; j++ )
 	{
+		nodeDistances[ j ] =
+		  Distance( CG_BeamNode( tb, j )->position, CG_BeamNode( tb, j + 1 )->position );
 		totalDistance += nodeDistances[ j ];
 	}
 
-	for ( j = 0, i = tb->nodes; i; i = i->next, j++ )
+	for ( j = 0; j < tb->numNodes; j++ )
 	{
+		i = CG_BeamNode( tb, j );
+
 		if ( tb->class_->textureType == TBTT_STRETCH )
 		{
 			i->textureCoord = tb->class_->frontTextureCoord +
@@ -116,7 +202,10 @@ alphaRange = tb->class_->backAlpha -
 		VectorMA( tb->class_->frontColor, ( position / totalDistance ),
 		          colorRange, i->color );
 
-		position += nodeDistances[ j ];
+		if ( j < tb->numNodes - 1 )
+		{
+			position += nodeDistances[ j ];
+		}
 	}
 }
 
@@ -157,11 +246,12 @@ static void CG_RenderBeam( trailBeam_t *tb )
 	vec3_t            up;
 	polyVert_t        verts[( MAX_TRAIL_BEAM_NODES - 1 ) * 4 ];
 	int               numVerts = 0;
+	int               j;
 	baseTrailBeam_t   *btb;
 	trailSystem_t     *ts;
 	baseTrailSystem_t *bts;
 
-	if ( !tb || !tb->nodes )
+	if ( !tb || !tb->numNodes )
 	{
 		return;
 	}
@@ -180,12 +270,11 @@ static void CG_RenderBeam( trailBeam_t *tb )
 
 	CG_CalculateBeamNodeProperties( tb );
 
-	i = tb->nodes;
-
-	do
+	for ( j = 0; j < tb->numNodes; j++ )
 	{
-		prev = i->prev;
-		next = i->next;
+		i = CG_BeamNode( tb, j );
+		prev = j > 0 ? CG_BeamNode( tb, j - 1 ) : nullptr;
+		next = j < tb->numNodes - 1 ? CG_BeamNode( tb, j + 1 ) : nullptr;
 
 		if ( prev && next )
 		{
@@ -285,90 +374,39 @@ static void CG_RenderBeam( trailBeam_t *tb )
 						( float ) btb->dLightColor[ 1 ] / ( float ) 0xFF,
 						( float ) btb->dLightColor[ 2 ] / ( float ) 0xFF, 0, 0 );
 		}
-
-		i = i->next;
 	}
-	while ( i );
 
 	trap_R_AddPolysToScene( tb->class_->shader, 4, &verts[ 0 ], numVerts / 4 );
 }
 
 /*
 ===============
-CG_AllocateBeamNode
+CG_InitialiseBeamNode
 
-Allocates a trailBeamNode_t from a trailBeam_t's nodePool
+Clears a node that has just been added to a beam
 ===============
 */
-static trailBeamNode_t *CG_AllocateBeamNode( trailBeam_t *tb )
+static trailBeamNode_t *CG_InitialiseBeamNode( trailBeam_t *tb, trailBeamNode_t *tbn )
 {
-	baseTrailBeam_t *btb = tb->class_;
-	int             i;
-	trailBeamNode_t *tbn;
-
-	for ( i = 0; i < MAX_TRAIL_BEAM_NODES; i++ )
-	{
-		tbn = &tb->nodePool[ i ];
-
-		if ( !tbn->used )
-		{
-			tbn->timeLeft = btb->segmentTime;
-			tbn->prev = nullptr;
-			tbn->next = nullptr;
-			tbn->used = true;
-			return tbn;
-		}
-	}
+	memset( tbn, 0, sizeof( trailBeamNode_t ) );
+	tbn->timeLeft = tb->class_->segmentTime;
 
-	// no space left
-	return nullptr;
+	return tbn;
 }
 
 /*
 ===============
-CG_DestroyBeamNode
+CG_DestroyLastBeamNode
 
-Removes a node from a beam
-Returns the new head
+Removes the node at the back of a beam
 ===============
 */
-static trailBeamNode_t *CG_DestroyBeamNode( trailBeamNode_t *tbn )
+static void CG_DestroyLastBeamNode( trailBeam_t *tb )
 {
-	trailBeamNode_t *newHead = nullptr;
-
-	if ( tbn->prev )
+	if ( tb->numNodes > 0 )
 	{
-		if ( tbn->next )
-		{
-			// node is in the middle
-			tbn->prev->next = tbn->next;
-			tbn->next->prev = tbn->prev;
-		}
-		else // node is at the back
-		{
-			tbn->prev->next = nullptr;
-		}
-
-		// find the new head (shouldn't have changed)
-		newHead = tbn->prev;
-
-		while ( newHead->prev )
-		{
-			newHead = newHead->prev;
-		}
+		tb->numNodes--;
 	}
-	else if ( tbn->next )
-	{
-		//node is at the front
-		tbn->next->prev = nullptr;
-		newHead = tbn->next;
-	}
-
-	tbn->prev = nullptr;
-	tbn->next = nullptr;
-	tbn->used = false;
-
-	return newHead;
 }
 
 /*
@@ -380,35 +418,12 @@ Returns the last beam node in a beam
 */
 static trailBeamNode_t *CG_FindLastBeamNode( trailBeam_t *tb )
 {
-	trailBeamNode_t *i = tb->nodes;
-
-	while ( i && i->next )
-	{
-		i = i->next;
-	}
-
-	return i;
-}
-
-/*
-===============
-CG_CountBeamNodes
-
-Returns the number of nodes in a beam
-===============
-*/
-static int CG_CountBeamNodes( trailBeam_t *tb )
-{
-	trailBeamNode_t *i = tb->nodes;
-	int             numNodes = 0;
-
-	while ( i )
+	if ( !tb->numNodes )
 	{
-		numNodes++;
-		i = i->next;
+		return nullptr;
 	}
 
-	return numNodes;
+	return CG_BeamNode( tb, tb->numNodes - 1 );
 }
 
 /*
@@ -421,31 +436,16 @@ Returns the new node
 */
 static trailBeamNode_t *CG_PrependBeamNode( trailBeam_t *tb )
 {
-	trailBeamNode_t *i;
-
-	if ( tb->nodes )
+	// no space left
+	if ( tb->numNodes == MAX_TRAIL_BEAM_NODES )
 	{
-		// prepend another node
-		i = CG_AllocateBeamNode( tb );
-
-		if ( i )
-		{
-			i->next = tb->nodes;
-			tb->nodes->prev = i;
-			tb->nodes = i;
-		}
+		return nullptr;
 	}
-	else //add first node
-	{
-		i = CG_AllocateBeamNode( tb );
 
-		if ( i )
-		{
-			tb->nodes = i;
-		}
-	}
+	tb->firstNode = ( tb->firstNode - 1 ) & ( MAX_TRAIL_BEAM_NODES - 1 );
+	tb->numNodes++;
 
-	return i;
+	return CG_InitialiseBeamNode( tb, CG_BeamNode( tb, 0 ) );
 }
 
 /*
@@ -458,32 +458,15 @@ Returns the new node
 */
 static trailBeamNode_t *CG_AppendBeamNode( trailBeam_t *tb )
 {
-	trailBeamNode_t *last, *i;
-
-	if ( tb->nodes )
+	// no space left
+	if ( tb->numNodes == MAX_TRAIL_BEAM_NODES )
 	{
-		// append another node
-		last = CG_FindLastBeamNode( tb );
-		i = CG_AllocateBeamNode( tb );
-
-		if ( i )
-		{
-			last->next = i;
-			i->prev = last;
-			i->next = nullptr;
-		}
+		return nullptr;
 	}
-	else //add first node
-	{
-		i = CG_AllocateBeamNode( tb );
 
-		if ( i )
-		{
-			tb->nodes = i;
-		}
-	}
+	tb->numNodes++;
 
-	return i;
+	return CG_InitialiseBeamNode( tb, CG_BeamNode( tb, tb->numNodes - 1 ) );
 }
 
 /*
@@ -494,13 +477,13 @@ CG_ApplyJitters
 static void CG_ApplyJitters( trailBeam_t *tb )
 {
 	trailBeamNode_t *i = nullptr;
-	int             j;
+	int             j, k;
 	baseTrailBeam_t *btb;
 	trailSystem_t   *ts;
-	trailBeamNode_t *start;
-	trailBeamNode_t *end;
+	int             start;
+	int             end;
 
-	if ( !tb || !tb->nodes )
+	if ( !tb || !tb->numNodes )
 	{
 		return;
 	}
@@ -512,8 +495,9 @@ static void CG_ApplyJitters( trailBeam_t *tb )
 	{
 		if ( tb->nextJitterTimes[ j ] <= cg.time )
 		{
-			for ( i = tb->nodes; i; i = i->next )
+			for ( k = 0; k < tb->numNodes; k++ )
 			{
+				i = CG_BeamNode( tb, k );
 				i->jitters[ j ][ 0 ] = ( crandom() * btb->jitters[ j ].magnitude );
 				i->jitters[ j ][ 1 ] = ( crandom() * btb->jitters[ j ].magnitude );
 			}
@@ -522,31 +506,32 @@ static void CG_ApplyJitters( trailBeam_t *tb )
 		}
 	}
 
-	start = tb->nodes;
-	end = CG_FindLastBeamNode( tb );
+	start = 0;
+	end = tb->numNodes - 1;
 
 	if ( !btb->jitterAttachments )
 	{
-		if ( CG_Attached( &ts->frontAttachment ) && start->next )
+		if ( CG_Attached( &ts->frontAttachment ) && start < tb->numNodes - 1 )
 		{
-			start = start->next;
+			start++;
 		}
 
-		if ( CG_Attached( &ts->backAttachment ) && end->prev )
+		if ( CG_Attached( &ts->backAttachment ) && end > 0 )
 		{
-			end = end->prev;
+			end--;
 		}
 	}
 
-	for ( i = start; i; i = i->next )
+	for ( k = start; k < tb->numNodes; k++ )
 	{
 		vec3_t          forward, right, up;
 		trailBeamNode_t *prev;
 		trailBeamNode_t *next;
 		float           upJitter = 0.0f, rightJitter = 0.0f;
 
-		prev = i->prev;
-		next = i->next;
+		i = CG_BeamNode( tb, k );
+		prev = k > 0 ? CG_BeamNode( tb, k - 1 ) : nullptr;
+		next = k < tb->numNodes - 1 ? CG_BeamNode( tb, k + 1 ) : nullptr;
 
 		if ( prev && next )
 		{
@@ -580,7 +565,7 @@ static void CG_ApplyJitters( trailBeam_t *tb )
 		VectorMA( i->position, upJitter, up, i->position );
 		VectorMA( i->position, rightJitter, right, i->position );
 
-		if ( i == end )
+		if ( k == end )
 		{
 			break;
 		}
@@ -618,13 +603,18 @@ static void CG_UpdateBeam( trailBeam_t *tb )
 	// first make sure this beam has enough nodes
 	if ( ts->destroyTime <= 0 )
 	{
-		nodesToAdd = btb->numSegments - CG_CountBeamNodes( tb ) + 1;
+		nodesToAdd = btb->numSegments - tb->numNodes + 1;
 
-		while ( nodesToAdd-- )
+		while ( nodesToAdd-- > 0 )
 		{
 			i = CG_AppendBeamNode( tb );
 
-			if ( !tb->nodes->next && CG_Attached( &ts->frontAttachment ) )
+			if ( !i )
+			{
+				break;
+			}
+
+			if ( tb->numNodes == 1 && CG_Attached( &ts->frontAttachment ) )
 			{
 				// this is the first node to be added
 				if ( !CG_AttachmentPoint( &ts->frontAttachment, i->refPosition ) )
@@ -632,17 +622,18 @@ static void CG_UpdateBeam( trailBeam_t *tb )
 					CG_DestroyTrailSystem( &ts );
 				}
 			}
-			else
+			else if ( tb->numNodes > 1 )
 			{
-				VectorCopy( i->prev->refPosition, i->refPosition );
+				VectorCopy( CG_BeamNode( tb, tb->numNodes - 2 )->refPosition, i->refPosition );
 			}
 		}
 	}
 
-	numNodes = CG_CountBeamNodes( tb );
+	numNodes = tb->numNodes;
 
-	for ( i = tb->nodes; i; i = i->next )
+	for ( j = 0; j < numNodes; j++ )
 	{
+		i = CG_BeamNode( tb, j );
 		VectorCopy( i->refPosition, i->position );
 	}
 
@@ -669,11 +660,11 @@ static void CG_UpdateBeam( trailBeam_t *tb )
 
 		VectorSubtract( back, front, dir );
 
-		for ( j = 0, i = tb->nodes; i; i = i->next, j++ )
+		for ( j = 0; j < numNodes; j++ )
 		{
 			float scale = ( float ) j / ( float )( numNodes - 1 );
 
-			VectorMA( front, scale, dir, i->position );
+			VectorMA( front, scale, dir, CG_BeamNode( tb, j )->position );
 		}
 	}
 	else if ( CG_Attached( &ts->frontAttachment ) )
@@ -689,9 +680,9 @@ static void CG_UpdateBeam( trailBeam_t *tb )
 
 			if ( i->timeLeft < 0 )
 			{
-				tb->nodes = CG_DestroyBeamNode( i );
+				CG_DestroyLastBeamNode( tb );
 
-				if ( !tb->nodes )
+				if ( !tb->numNodes )
 				{
 					tb->valid = false;
 					return;
@@ -703,27 +694,30 @@ static void CG_UpdateBeam( trailBeam_t *tb )
 					CG_PrependBeamNode( tb );
 				}
 			}
-			else if ( i->timeLeft >= 0 && i->prev )
+			else if ( i->timeLeft >= 0 && tb->numNodes > 1 )
 			{
-				vec3_t dir;
-				float  length;
+				trailBeamNode_t *prev = CG_BeamNode( tb, tb->numNodes - 2 );
+				vec3_t          dir;
+				float           length;
 
-				VectorSubtract( i->refPosition, i->prev->refPosition, dir );
+				VectorSubtract( i->refPosition, prev->refPosition, dir );
 				length = VectorNormalize( dir ) *
 				         ( ( float ) i->timeLeft / ( float ) tb->class_->segmentTime );
 
-				VectorMA( i->prev->refPosition, length, dir, i->position );
+				VectorMA( prev->refPosition, length, dir, i->position );
 			}
 		}
 
-		if ( tb->nodes )
+		if ( tb->numNodes )
 		{
-			if ( !CG_AttachmentPoint( &ts->frontAttachment, tb->nodes->refPosition ) )
+			trailBeamNode_t *front = CG_BeamNode( tb, 0 );
+
+			if ( !CG_AttachmentPoint( &ts->frontAttachment, front->refPosition ) )
 			{
 				CG_DestroyTrailSystem( &ts );
 			}
 
-			VectorCopy( tb->nodes->refPosition, tb->nodes->position );
+			VectorCopy( front->refPosition, front->position );
 		}
 	}
 
@@ -1313,6 +1307,8 @@ void CG_LoadTrailSystems()
 	numBaseTrailSystems = 0;
 	numBaseTrailBeams = 0;
 
+	CG_ClearTrailPools();
+
 	for ( i = 0; i < MAX_BASETRAIL_SYSTEMS; i++ )
 	{
 		baseTrailSystem_t *bts = &baseTrailSystems[ i ];
@@ -1399,39 +1395,37 @@ Allocate a new trail beam
 static trailBeam_t *CG_SpawnNewTrailBeam( baseTrailBeam_t *btb,
     trailSystem_t *parent )
 {
-	int           i;
-	trailBeam_t   *tb = nullptr;
+	trailBeam_t   *tb;
 	trailSystem_t *ts = parent;
 
-	for ( i = 0; i < MAX_TRAIL_BEAMS; i++ )
+	if ( !numFreeTrailBeams )
 	{
-		tb = &trailBeams[ i ];
-
-		if ( !tb->valid )
+		if ( cg_debugTrails.integer >= 1 )
 		{
-			memset( tb, 0, sizeof( trailBeam_t ) );
+			Log::Debug( "MAX_TRAIL_BEAMS" );
+		}
 
-			//found a free slot
-			tb->class_ = btb;
-			tb->parent = ts;
+		return nullptr;
+	}
 
-			tb->valid = true;
+	tb = freeTrailBeams[ --numFreeTrailBeams ];
+	memset( tb, 0, sizeof( trailBeam_t ) );
 
-			if ( cg_debugTrails.integer >= 1 )
-			{
-				Log::Debug( "TB %s created", ts->class_->name );
-			}
+	//found a free slot
+	tb->class_ = btb;
+	tb->parent = ts;
 
-			return tb;
-		}
-	}
+	tb->valid = true;
+
+	tb->liveIndex = numLiveTrailBeams;
+	liveTrailBeams[ numLiveTrailBeams++ ] = tb;
 
 	if ( cg_debugTrails.integer >= 1 )
 	{
-		Log::Debug( "MAX_TRAIL_BEAMS" );
+		Log::Debug( "TB %s created", ts->class_->name );
 	}
 
-	return nullptr;
+	return tb;
 }
 
 /*
@@ -1443,8 +1437,9 @@ Spawns a new trail system
 */
 trailSystem_t *CG_SpawnNewTrailSystem( qhandle_t psHandle )
 {
-	int               i, j;
-	trailSystem_t     *ts = nullptr;
+	int               j;
+	trailSystem_t     *ts;
+	trailBeam_t       *tb;
 	baseTrailSystem_t *bts = &baseTrailSystems[ psHandle - 1 ];
 
 	if ( !bts->registered )
@@ -1453,41 +1448,43 @@ trailSystem_t *CG_SpawnNewTrailSystem( qhandle_t psHandle )
 		return nullptr;
 	}
 
-	for ( i = 0; i < MAX_TRAIL_SYSTEMS; i++ )
+	if ( !numFreeTrailSystems )
 	{
-		ts = &trailSystems[ i ];
-
-		if ( !ts->valid )
+		if ( cg_debugTrails.integer >= 1 )
 		{
-			memset( ts, 0, sizeof( trailSystem_t ) );
+			Log::Debug( "MAX_TRAIL_SYSTEMS" );
+		}
 
-			//found a free slot
-			ts->class_ = bts;
+		return nullptr;
+	}
 
-			ts->valid = true;
-			ts->destroyTime = -1;
-			ts->birthTime = cg.time;
+	ts = freeTrailSystems[ --numFreeTrailSystems ];
+	memset( ts, 0, sizeof( trailSystem_t ) );
 
-			for ( j = 0; j < bts->numBeams; j++ )
-			{
-				CG_SpawnNewTrailBeam( bts->beams[ j ], ts );
-			}
+	//found a free slot
+	ts->class_ = bts;
 
-			if ( cg_debugTrails.integer >= 1 )
-			{
-				Log::Debug( "TS %s created", bts->name );
-			}
+	ts->valid = true;
+	ts->destroyTime = -1;
+	ts->birthTime = cg.time;
 
-			return ts;
+	ts->liveIndex = numLiveTrailSystems;
+	liveTrailSystems[ numLiveTrailSystems++ ] = ts;
+
+	for ( j = 0; j < bts->numBeams; j++ )
+	{
+		if ( ( tb = CG_SpawnNewTrailBeam( bts->beams[ j ], ts ) ) != nullptr )
+		{
+			ts->beams[ ts->numBeams++ ] = tb;
 		}
 	}
 
 	if ( cg_debugTrails.integer >= 1 )
 	{
-		Log::Debug( "MAX_TRAIL_SYSTEMS" );
+		Log::Debug( "TS %s created", bts->name );
 	}
 
-	return nullptr;
+	return ts;
 }
 
 /*
@@ -1553,20 +1550,16 @@ static void CG_GarbageCollectTrailSystems()
 	trailBeam_t   *tb;
 	int           centNum;
 
-	for ( i = 0; i < MAX_TRAIL_SYSTEMS; i++ )
+	//walk backwards so that removing systems doesn't skip any
+	for ( i = numLiveTrailSystems - 1; i >= 0; i-- )
 	{
-		ts = &trailSystems[ i ];
+		ts = liveTrailSystems[ i ];
 		count = 0;
 
-		//don't bother checking already invalid systems
-		if ( !ts->valid )
+		//beam slots are reused once they die, so check the parent too
+		for ( j = 0; j < ts->numBeams; j++ )
 		{
-			continue;
-		}
-
-		for ( j = 0; j < MAX_TRAIL_BEAMS; j++ )
-		{
-			tb = &trailBeams[ j ];
+			tb = ts->beams[ j ];
 
 			if ( tb->valid && tb->parent == ts )
 			{
@@ -1576,7 +1569,7 @@ static void CG_GarbageCollectTrailSystems()
 
 		if ( !count )
 		{
-			ts->valid = false;
+			CG_FreeTrailSystem( ts );
 		}
 
 		//check systems where the parent cent has left the PVS
@@ -1637,41 +1630,27 @@ void CG_AddTrails()
 {
 	int         i;
 	trailBeam_t *tb;
-	int         numTS = 0, numTB = 0;
 
 	//remove expired trail systems
 	CG_GarbageCollectTrailSystems();
 
-	for ( i = 0; i < MAX_TRAIL_BEAMS; i++ )
+	//walk backwards so that removing beams doesn't skip any
+	for ( i = numLiveTrailBeams - 1; i >= 0; i-- )
 	{
-		tb = &trailBeams[ i ];
+		tb = liveTrailBeams[ i ];
 
-		if ( tb->valid )
+		CG_UpdateBeam( tb );
+		CG_RenderBeam( tb );
+
+		if ( !tb->valid )
 		{
-			CG_UpdateBeam( tb );
-			CG_RenderBeam( tb );
+			CG_FreeTrailBeam( tb );
 		}
 	}
 
 	if ( cg_debugTrails.integer >= 2 )
 	{
-		for ( i = 0; i < MAX_TRAIL_SYSTEMS; i++ )
-		{
-			if ( trailSystems[ i ].valid )
-			{
-				numTS++;
-			}
-		}
-
-		for ( i = 0; i < MAX_TRAIL_BEAMS; i++ )
-		{
-			if ( trailBeams[ i ].valid )
-			{
-				numTB++;
-			}
-		}
-
-		Log::Debug( "TS: %d  TB: %d", numTS, numTB );
+		Log::Debug( "TS: %d  TB: %d", numLiveTrailSystems, numLiveTrailBeams );
 	}
 }
 
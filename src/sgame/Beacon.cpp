@@ -130,7 +130,7 @@ namespace Beacon //this should eventually become a class
 
 		ent = G_NewEntity( );
 		ent->s.eType = entityType_t::ET_BEACON;
-		ent->classname = "beacon";
+		G_SetClassname( ent, "beacon" );
 
 		ent->s.bc_type = type;
 		ent->s.bc_data = data;
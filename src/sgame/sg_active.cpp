@@ -1197,36 +1197,39 @@ void SendPendingPredictableEvents( playerState_t *ps )
 ==============
  G_UnlaggedStore
 
- Called on every server frame.  Stores position data for the client at that
- into client->unlaggedHist[] and the time into level.unlaggedTimes[].
+ Called on every server frame.  Stores position data for all clients and the
+ time into a new slot of level.unlagged.
  This data is used by G_UnlaggedCalc()
 ==============
 */
 void G_UnlaggedStore()
 {
-	int        i = 0;
-	gentity_t  *ent;
-	unlagged_t *save;
+	int               i = 0;
+	gentity_t         *ent;
+	unlaggedHistory_t *hist = &level.unlagged;
+	int               slot;
 
 	if ( !g_unlagged.integer )
 	{
 		return;
 	}
 
-	level.unlaggedIndex++;
+	slot = hist->index + 1;
 
-	if ( level.unlaggedIndex >= MAX_UNLAGGED_MARKERS )
+	if ( slot >= MAX_UNLAGGED_MARKERS )
 	{
-		level.unlaggedIndex = 0;
+		slot = 0;
 	}
 
-	level.unlaggedTimes[ level.unlaggedIndex ] = level.time;
+	hist->index = slot;
+	hist->count = std::min( hist->count + 1, MAX_UNLAGGED_MARKERS );
+	hist->times[ slot ] = level.time;
+	hist->calcValid = false;
 
 	for ( i = 0; i < level.maxclients; i++ )
 	{
 		ent = &g_entities[ i ];
-		save = &ent->client->unlaggedHist[ level.unlaggedIndex ];
-		save->used = false;
+		hist->used[ slot ][ i ] = false;
 
 		if ( !ent->r.linked || !( ent->r.contents & CONTENTS_BODY ) )
 		{
@@ -1238,10 +1241,10 @@ void G_UnlaggedStore()
 			continue;
 		}
 
-		VectorCopy( ent->r.mins, save->mins );
-		VectorCopy( ent->r.maxs, save->maxs );
-		VectorCopy( ent->s.pos.trBase, save->origin );
-		save->used = true;
+		VectorCopy( ent->r.mins, hist->mins[ slot ][ i ] );
+		VectorCopy( ent->r.maxs, hist->maxs[ slot ][ i ] );
+		VectorCopy( ent->s.pos.trBase, hist->origins[ slot ][ i ] );
+		hist->used[ slot ][ i ] = true;
 	}
 }
 
@@ -1249,91 +1252,163 @@ void G_UnlaggedStore()
 ==============
  G_UnlaggedClear
 
- Mark all unlaggedHist[] markers for this client invalid.  Useful for
+ Mark all history slots for this client invalid.  Useful for
  preventing teleporting and death.
 ==============
 */
 void G_UnlaggedClear( gentity_t *ent )
 {
 	int i;
+	int num = ent->s.number;
 
 	for ( i = 0; i < MAX_UNLAGGED_MARKERS; i++ )
 	{
-		ent->client->unlaggedHist[ i ].used = false;
+		level.unlagged.used[ i ][ num ] = false;
 	}
 }
 
 /*
 ==============
- G_UnlaggedCalc
+ G_UnlaggedRewind
 
- Loops through all active clients and calculates their predicted position
- for time then stores it in client->unlaggedCalc
+ Finds the slots bracketing time and interpolates the positions of all clients
+ between them into the calc arrays of the history.  Returns false if time is
+ on the current frame.
 ==============
 */
-void G_UnlaggedCalc( int time, gentity_t *rewindEnt )
+static bool G_UnlaggedRewind( int time )
 {
-	int       i = 0;
-	gentity_t *ent;
-	int       startIndex = level.unlaggedIndex;
-	int       stopIndex = -1;
-	int       frameMsec = 0;
-	float     lerp = 0.5f;
+	unlaggedHistory_t *hist = &level.unlagged;
+	int               oldest = hist->index - hist->count + 1;
+	int               lo, hi, start, stop;
+	float             lerp = 0.0f;
+	int               frameMsec;
 
-	if ( !g_unlagged.integer )
+	if ( hist->calcValid && hist->calcTime == time )
 	{
-		return;
+		return hist->calcStart != -1;
 	}
 
-	// clear any calculated values from a previous run
-	for ( i = 0; i < level.maxclients; i++ )
+	hist->calcValid = true;
+	hist->calcTime = time;
+	hist->calcStart = -1;
+
+	if ( !hist->count )
 	{
-		ent = &g_entities[ i ];
+		return false;
+	}
 
-		if ( !ent->inuse )
+	if ( oldest < 0 )
+	{
+		oldest += MAX_UNLAGGED_MARKERS;
+	}
+
+	// times only increase from the oldest slot to the newest one, find the
+	// newest slot that isn't more recent than time
+	lo = 0;
+	hi = hist->count;
+
+	while ( lo < hi )
+	{
+		int mid = ( lo + hi ) / 2;
+
+		if ( hist->times[ ( oldest + mid ) % MAX_UNLAGGED_MARKERS ] <= time )
 		{
-			continue;
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
 		}
+	}
 
-		ent->client->unlaggedCalc.used = false;
+	// client is on the current frame, no need for unlagged
+	if ( lo == hist->count )
+	{
+		return false;
 	}
 
-	for ( i = 0; i < MAX_UNLAGGED_MARKERS; i++ )
+	if ( lo == 0 )
 	{
-		if ( level.unlaggedTimes[ startIndex ] <= time )
-		{
-			break;
-		}
+		// if the oldest slot still isn't old enough
+		// just use it with no lerping
+		start = stop = oldest;
+	}
+	else
+	{
+		start = ( oldest + lo - 1 ) % MAX_UNLAGGED_MARKERS;
+		stop = ( oldest + lo ) % MAX_UNLAGGED_MARKERS;
 
-		stopIndex = startIndex;
+		// lerp between two slots
+		frameMsec = hist->times[ stop ] - hist->times[ start ];
 
-		if ( --startIndex < 0 )
+		if ( frameMsec > 0 )
 		{
-			startIndex = MAX_UNLAGGED_MARKERS - 1;
+			lerp = ( float )( time - hist->times[ start ] ) / ( float ) frameMsec;
 		}
 	}
 
-	if ( i == MAX_UNLAGGED_MARKERS )
+	hist->calcStart = start;
+	hist->calcStop = stop;
+
+	// every client at once, whether they are used or not
 	{
-		// if we searched all markers and the oldest one still isn't old enough
-		// just use the oldest marker with no lerping
-		lerp = 0.0f;
+		const int   n = 3 * level.maxclients;
+		const float *from[ 3 ] = { hist->origins[ start ][ 0 ], hist->mins[ start ][ 0 ], hist->maxs[ start ][ 0 ] };
+		const float *to[ 3 ] = { hist->origins[ stop ][ 0 ], hist->mins[ stop ][ 0 ], hist->maxs[ stop ][ 0 ] };
+		float       *out[ 3 ] = { hist->calcOrigins[ 0 ], hist->calcMins[ 0 ], hist->calcMaxs[ 0 ] };
+
+		for ( int k = 0; k < 3; k++ )
+		{
+			const float *a = from[ k ];
+			const float *b = to[ k ];
+			float       *r = out[ k ];
+
+			for ( int j = 0; j < n; j++ )
+			{
+				r[ j ] = a[ j ] + lerp * ( b[ j ] - a[ j ] );
+			}
+		}
 	}
 
-	// client is on the current frame, no need for unlagged
-	if ( stopIndex == -1 )
+	return true;
+}
+
+/*
+==============
+ G_UnlaggedCalc
+
+ Loops through all active clients and calculates their predicted position
+ for time then stores it in client->unlaggedCalc
+==============
+*/
+void G_UnlaggedCalc( int time, gentity_t *rewindEnt )
+{
+	int               i = 0;
+	gentity_t         *ent;
+	unlaggedHistory_t *hist = &level.unlagged;
+
+	if ( !g_unlagged.integer )
 	{
 		return;
 	}
 
-	// lerp between two markers
-	frameMsec = level.unlaggedTimes[ stopIndex ] -
-	            level.unlaggedTimes[ startIndex ];
+	// clear any calculated values from a previous run
+	for ( i = 0; i < level.maxclients; i++ )
+	{
+		ent = &g_entities[ i ];
 
-	if ( frameMsec > 0 )
+		if ( !ent->inuse )
+		{
+			continue;
+		}
+
+		ent->client->unlaggedCalc.used = false;
+	}
+
+	if ( !G_UnlaggedRewind( time ) )
 	{
-		lerp = ( float )( time - level.unlaggedTimes[ startIndex ] ) /
-		       ( float ) frameMsec;
+		return;
 	}
 
 	for ( i = 0; i < level.maxclients; i++ )
@@ -1360,26 +1435,14 @@ void G_UnlaggedCalc( int time, gentity_t *rewindEnt )
 			continue;
 		}
 
-		if ( !ent->client->unlaggedHist[ startIndex ].used )
-		{
-			continue;
-		}
-
-		if ( !ent->client->unlaggedHist[ stopIndex ].used )
+		if ( !hist->used[ hist->calcStart ][ i ] || !hist->used[ hist->calcStop ][ i ] )
 		{
 			continue;
 		}
 
-		// between two unlagged markers
-		VectorLerpTrem( lerp, ent->client->unlaggedHist[ startIndex ].mins,
-		                ent->client->unlaggedHist[ stopIndex ].mins,
-		                ent->client->unlaggedCalc.mins );
-		VectorLerpTrem( lerp, ent->client->unlaggedHist[ startIndex ].maxs,
-		                ent->client->unlaggedHist[ stopIndex ].maxs,
-		                ent->client->unlaggedCalc.maxs );
-		VectorLerpTrem( lerp, ent->client->unlaggedHist[ startIndex ].origin,
-		                ent->client->unlaggedHist[ stopIndex ].origin,
-		                ent->client->unlaggedCalc.origin );
+		VectorCopy( hist->calcMins[ i ], ent->client->unlaggedCalc.mins );
+		VectorCopy( hist->calcMaxs[ i ], ent->client->unlaggedCalc.maxs );
+		VectorCopy( hist->calcOrigins[ i ], ent->client->unlaggedCalc.origin );
 
 		ent->client->unlaggedCalc.used = true;
 	}
@@ -33,6 +33,11 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "sg_local.h"
 #include "engine/qcommon/q_unicode.h"
 
+#include <climits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 static void G_admin_notIntermission( gentity_t *ent )
 {
 	char command[ MAX_ADMIN_CMD_LEN ];
@@ -392,6 +397,112 @@ g_admin_ban_t     *g_admin_bans = nullptr;
 g_admin_spec_t    *g_admin_specs = nullptr;
 g_admin_command_t *g_admin_commands = nullptr;
 
+/*
+===============
+Admin lookup index
+
+The lists above remain authoritative (they define the config file and
+listbans order), but lookups go through hash tables keyed by level and
+GUID, and IP bans through a binary trie keyed on the masked address bits.
+Anything that edits the lists calls admin_index_invalidate; the index is
+rebuilt on the next lookup.
+===============
+*/
+struct adminBanTrieNode_t
+{
+	int              child[ 2 ] = { 0, 0 };
+	std::vector<int> bans; // list positions of bans whose prefix ends here
+};
+
+static struct
+{
+	bool                                              valid;
+	std::unordered_map<int, g_admin_level_t *>        levels;
+	std::unordered_map<std::string, g_admin_admin_t *> admins;
+	std::vector<g_admin_ban_t *>                      bans; // in list order
+	std::unordered_map<const g_admin_ban_t *, int>    banPosition;
+	std::unordered_map<std::string, std::vector<int>> banGuids;
+	std::vector<adminBanTrieNode_t>                   banTrie; // roots: 0 for IPv4, 1 for IPv6
+} adminIndex;
+
+static void admin_index_invalidate()
+{
+	adminIndex.valid = false;
+}
+
+// number of leading address bits G_AddressCompare looks at
+static int admin_index_mask( const addr_t *ip )
+{
+	int max = ( ip->type == IPv6 ) ? 128 : 32;
+
+	return ( ip->mask < 1 || ip->mask > max ) ? max : ip->mask;
+}
+
+static int admin_index_bit( const addr_t *ip, int bit )
+{
+	return ( ip->addr[ bit >> 3 ] >> ( 7 - ( bit & 7 ) ) ) & 1;
+}
+
+static void admin_index_build()
+{
+	g_admin_level_t *l;
+	g_admin_admin_t *a;
+	g_admin_ban_t   *b;
+	int             pos, i;
+
+	if ( adminIndex.valid )
+	{
+		return;
+	}
+
+	adminIndex.levels.clear();
+	adminIndex.admins.clear();
+	adminIndex.bans.clear();
+	adminIndex.banPosition.clear();
+	adminIndex.banGuids.clear();
+	adminIndex.banTrie.assign( 2, adminBanTrieNode_t() );
+
+	// emplace keeps the first entry, as the list scans did
+	for ( l = g_admin_levels; l; l = l->next )
+	{
+		adminIndex.levels.emplace( l->level, l );
+	}
+
+	for ( a = g_admin_admins; a; a = a->next )
+	{
+		adminIndex.admins.emplace( G_GuidKey( a->guid ), a );
+	}
+
+	for ( pos = 0, b = g_admin_bans; b; pos++, b = b->next )
+	{
+		int node = ( b->ip.type == IPv6 ) ? 1 : 0;
+		int mask = admin_index_mask( &b->ip );
+
+		adminIndex.bans.push_back( b );
+		adminIndex.banPosition[ b ] = pos;
+		adminIndex.banGuids[ G_GuidKey( b->guid ) ].push_back( pos );
+
+		for ( i = 0; i < mask; i++ )
+		{
+			int bit = admin_index_bit( &b->ip, i );
+
+			if ( !adminIndex.banTrie[ node ].child[ bit ] )
+			{
+				int next = adminIndex.banTrie.size();
+
+				adminIndex.banTrie.emplace_back();
+				adminIndex.banTrie[ node ].child[ bit ] = next;
+			}
+
+			node = adminIndex.banTrie[ node ].child[ bit ];
+		}
+
+		adminIndex.banTrie[ node ].bans.push_back( pos );
+	}
+
+	adminIndex.valid = true;
+}
+
 /* ent must be non-nullptr */
 #define G_ADMIN_NAME( ent ) ( ent->client->pers.admin ? ent->client->pers.admin->name : ent->client->pers.netname )
 
@@ -524,32 +635,20 @@ g_admin_cmd_t *G_admin_cmd( const char *cmd )
 
 g_admin_level_t *G_admin_level( const int l )
 {
-	g_admin_level_t *level;
+	admin_index_build();
 
-	for ( level = g_admin_levels; level; level = level->next )
-	{
-		if ( level->level == l )
-		{
-			return level;
-		}
-	}
+	auto it = adminIndex.levels.find( l );
 
-	return nullptr;
+	return ( it != adminIndex.levels.end() ) ? it->second : nullptr;
 }
 
 g_admin_admin_t *G_admin_admin( const char *guid )
 {
-	g_admin_admin_t *admin;
+	admin_index_build();
 
-	for ( admin = g_admin_admins; admin; admin = admin->next )
-	{
-		if ( !Q_stricmp( admin->guid, guid ) )
-		{
-			return admin;
-		}
-	}
+	auto it = adminIndex.admins.find( G_GuidKey( guid ) );
 
-	return nullptr;
+	return ( it != adminIndex.admins.end() ) ? it->second : nullptr;
 }
 
 g_admin_command_t *G_admin_command( const char *cmd )
@@ -760,28 +859,88 @@ static bool admin_higher( gentity_t *admin, gentity_t *victim )
 	                           victim->client->pers.admin );
 }
 
-static void admin_writeconfig_string( char *s, fileHandle_t f )
+static void admin_writeconfig_string( const char *s, std::string &out )
 {
-	if ( s[ 0 ] )
-	{
-		trap_FS_Write( s, strlen( s ), f );
-	}
+	out += s;
+	out += '\n';
+}
 
-	trap_FS_Write( "\n", 1, f );
+static void admin_writeconfig_int( int v, std::string &out )
+{
+	out += va( "%d\n", v );
 }
 
-static void admin_writeconfig_int( int v, fileHandle_t f )
+static void admin_writeconfig_admin( const g_admin_admin_t *a, std::string &out )
 {
-	char buf[ 32 ];
+	out += "[admin]\n";
+	out += "name    = ";
+	admin_writeconfig_string( a->name, out );
+	out += "guid    = ";
+	admin_writeconfig_string( a->guid, out );
+	out += "level   = ";
+	admin_writeconfig_int( a->level, out );
+	out += "flags   = ";
+	admin_writeconfig_string( a->flags, out );
+	out += "pubkey  = ";
+	admin_writeconfig_string( a->pubkey, out );
+	out += "msg     = ";
+	admin_writeconfig_string( a->msg, out );
+	out += "msg2    = ";
+	admin_writeconfig_string( a->msg2, out );
+	out += "counter = ";
+	admin_writeconfig_int( a->counter, out );
+	out += "lastseen = ";
+	admin_writeconfig_int( a->lastSeen.tm_year * 10000 + a->lastSeen.tm_mon * 100 + a->lastSeen.tm_mday, out );
+	out += "\n";
+}
 
-	Com_sprintf( buf, sizeof( buf ), "%d\n", v );
-	trap_FS_Write( buf, strlen( buf ), f );
+static void admin_writeconfig_ban( const g_admin_ban_t *b, std::string &out )
+{
+	out += G_ADMIN_BAN_IS_WARNING( b ) ? "[warning]\n" : "[ban]\n";
+	out += "id      = ";
+	admin_writeconfig_int( b->id, out );
+	out += "name    = ";
+	admin_writeconfig_string( b->name, out );
+	out += "guid    = ";
+	admin_writeconfig_string( b->guid, out );
+	out += "ip      = ";
+	admin_writeconfig_string( b->ip.str, out );
+	out += "reason  = ";
+	admin_writeconfig_string( b->reason, out );
+	out += "made    = ";
+	admin_writeconfig_string( b->made, out );
+	out += "expires = ";
+	admin_writeconfig_int( b->expires, out );
+	out += "banner  = ";
+	admin_writeconfig_string( b->banner, out );
+	out += "\n";
+}
+
+/*
+===============
+Admin journal
+
+Single admin and ban changes are appended to "<g_admin>.journal" rather
+than rewriting the whole g_admin file. G_admin_readconfig replays the
+journal on top of the file and folds it back in; G_admin_writeconfig
+writes a fresh file and empties the journal, which also happens once the
+journal holds MAX_ADMIN_JOURNAL_ENTRIES records. Admin records are keyed
+by GUID and ban records by id, so replaying a journal which was already
+folded in is harmless.
+===============
+*/
+static int adminJournalEntries = 0;
+
+static const char *admin_journal_name()
+{
+	return va( "%s.journal", g_admin.string );
 }
 
 void G_admin_writeconfig()
 {
 	fileHandle_t      f;
 	int               t;
+	std::string       out;
 	g_admin_admin_t   *a;
 	g_admin_level_t   *l;
 	g_admin_ban_t     *b;
@@ -805,14 +964,14 @@ void G_admin_writeconfig()
 
 	for ( l = g_admin_levels; l; l = l->next )
 	{
-		trap_FS_Write( "[level]\n", 8, f );
-		trap_FS_Write( "level   = ", 10, f );
-		admin_writeconfig_int( l->level, f );
-		trap_FS_Write( "name    = ", 10, f );
-		admin_writeconfig_string( l->name, f );
-		trap_FS_Write( "flags   = ", 10, f );
-		admin_writeconfig_string( l->flags, f );
-		trap_FS_Write( "\n", 1, f );
+		out += "[level]\n";
+		out += "level   = ";
+		admin_writeconfig_int( l->level, out );
+		out += "name    = ";
+		admin_writeconfig_string( l->name, out );
+		out += "flags   = ";
+		admin_writeconfig_string( l->flags, out );
+		out += "\n";
 	}
 
 	for ( a = g_admin_admins; a; a = a->next )
@@ -823,26 +982,7 @@ void G_admin_writeconfig()
 			continue;
 		}
 
-		trap_FS_Write( "[admin]\n", 8, f );
-		trap_FS_Write( "name    = ", 10, f );
-		admin_writeconfig_string( a->name, f );
-		trap_FS_Write( "guid    = ", 10, f );
-		admin_writeconfig_string( a->guid, f );
-		trap_FS_Write( "level   = ", 10, f );
-		admin_writeconfig_int( a->level, f );
-		trap_FS_Write( "flags   = ", 10, f );
-		admin_writeconfig_string( a->flags, f );
-		trap_FS_Write( "pubkey  = ", 10, f );
-		admin_writeconfig_string( a->pubkey, f );
-		trap_FS_Write( "msg     = ", 10, f );
-		admin_writeconfig_string( a->msg, f );
-		trap_FS_Write( "msg2    = ", 10, f );
-		admin_writeconfig_string( a->msg2, f );
-		trap_FS_Write( "counter = ", 10, f );
-		admin_writeconfig_int( a->counter, f );
-		trap_FS_Write( "lastseen = ", 11, f );
-		admin_writeconfig_int( a->lastSeen.tm_year * 10000 + a->lastSeen.tm_mon * 100 + a->lastSeen.tm_mday, f );
-		trap_FS_Write( "\n", 1, f );
+		admin_writeconfig_admin( a, out );
 	}
 
 	for ( b = g_admin_bans; b; b = b->next )
@@ -853,47 +993,89 @@ void G_admin_writeconfig()
 			continue;
 		}
 
-		if ( G_ADMIN_BAN_IS_WARNING( b ) )
-		{
-			trap_FS_Write( "[warning]\n", 10, f );
-		}
-		else
+		admin_writeconfig_ban( b, out );
+
+		// keep the pieces handed to the engine reasonably sized
+		if ( out.size() >= 65536 )
 		{
-			trap_FS_Write( "[ban]\n", 6, f );
+			trap_FS_Write( out.data(), out.size(), f );
+			out.clear();
 		}
-
-		trap_FS_Write( "name    = ", 10, f );
-		admin_writeconfig_string( b->name, f );
-		trap_FS_Write( "guid    = ", 10, f );
-		admin_writeconfig_string( b->guid, f );
-		trap_FS_Write( "ip      = ", 10, f );
-		admin_writeconfig_string( b->ip.str, f );
-		trap_FS_Write( "reason  = ", 10, f );
-		admin_writeconfig_string( b->reason, f );
-		trap_FS_Write( "made    = ", 10, f );
-		admin_writeconfig_string( b->made, f );
-		trap_FS_Write( "expires = ", 10, f );
-		admin_writeconfig_int( b->expires, f );
-		trap_FS_Write( "banner  = ", 10, f );
-		admin_writeconfig_string( b->banner, f );
-		trap_FS_Write( "\n", 1, f );
 	}
 
 	for ( c = g_admin_commands; c; c = c->next )
 	{
-		trap_FS_Write( "[command]\n", 10, f );
-		trap_FS_Write( "command = ", 10, f );
-		admin_writeconfig_string( c->command, f );
-		trap_FS_Write( "exec    = ", 10, f );
-		admin_writeconfig_string( c->exec, f );
-		trap_FS_Write( "desc    = ", 10, f );
-		admin_writeconfig_string( c->desc, f );
-		trap_FS_Write( "flag    = ", 10, f );
-		admin_writeconfig_string( c->flag, f );
-		trap_FS_Write( "\n", 1, f );
+		out += "[command]\n";
+		out += "command = ";
+		admin_writeconfig_string( c->command, out );
+		out += "exec    = ";
+		admin_writeconfig_string( c->exec, out );
+		out += "desc    = ";
+		admin_writeconfig_string( c->desc, out );
+		out += "flag    = ";
+		admin_writeconfig_string( c->flag, out );
+		out += "\n";
+	}
+
+	trap_FS_Write( out.data(), out.size(), f );
+	trap_FS_FCloseFile( f );
+
+	// everything in the journal is in the file now
+	if ( trap_FS_FOpenFile( admin_journal_name(), &f, fsMode_t::FS_WRITE ) >= 0 )
+	{
+		trap_FS_FCloseFile( f );
+		adminJournalEntries = 0;
+	}
+}
+
+static void admin_journal_append( const std::string &record )
+{
+	fileHandle_t f;
+
+	if ( !g_admin.string[ 0 ] )
+	{
+		return;
+	}
+
+	// the change is already in memory, so compacting records it too
+	if ( adminJournalEntries >= MAX_ADMIN_JOURNAL_ENTRIES )
+	{
+		G_admin_writeconfig();
+		return;
+	}
+
+	if ( trap_FS_FOpenFile( admin_journal_name(), &f, fsMode_t::FS_APPEND_SYNC ) < 0 )
+	{
+		Log::Warn( "admin_journal: could not open \"%s\", rewriting g_admin instead",
+		           admin_journal_name() );
+		G_admin_writeconfig();
+		return;
 	}
 
+	trap_FS_Write( record.data(), record.size(), f );
 	trap_FS_FCloseFile( f );
+	adminJournalEntries++;
+}
+
+static void admin_journal_ban( const g_admin_ban_t *b )
+{
+	std::string record;
+
+	admin_writeconfig_ban( b, record );
+	admin_journal_append( record );
+}
+
+static void admin_journal_unban( int id )
+{
+	admin_journal_append( va( "[unban]\nid      = %d\n\n", id ) );
+}
+
+void G_admin_journal_admin( const g_admin_admin_t *a )
+{
+	std::string record;
+
+	admin_writeconfig_admin( a, record );
+	admin_journal_append( record );
 }
 
 static void admin_readconfig_string( const char **cnf, char *s, unsigned size )
@@ -1003,6 +1185,7 @@ static void admin_default_levels()
 	            "ALLFLAGS -IMMUTABLE -INCOGNITO",
 	            sizeof( l->flags ) );
 	admin_level_maxname = 15;
+	admin_index_invalidate();
 }
 
 void G_admin_authlog( gentity_t *ent )
@@ -1467,10 +1650,13 @@ static bool G_admin_ban_matches( g_admin_ban_t *ban, gentity_t *ent )
 	         G_AddressCompare( &ban->ip, &ent->client->pers.ip ) );
 }
 
+// returns the first matching ban after start in list order; the candidates
+// come from the GUID table and the trie nodes along the client's address
 static g_admin_ban_t *G_admin_match_ban( gentity_t *ent, const g_admin_ban_t *start )
 {
-	int           t;
-	g_admin_ban_t *ban;
+	const addr_t *ip = &ent->client->pers.ip;
+	int          t, first, best;
+	int          node, mask, i;
 
 	t = Com_GMTime( nullptr );
 
@@ -1479,21 +1665,83 @@ static g_admin_ban_t *G_admin_match_ban( gentity_t *ent, const g_admin_ban_t *st
 		return nullptr;
 	}
 
-	for ( ban = start ? start->next : g_admin_bans; ban; ban = ban->next )
+	admin_index_build();
+
+	first = 0;
+
+	if ( start )
 	{
-		// 0 is for perm ban
-		if ( ban->expires != 0 && ban->expires <= t )
+		auto it = adminIndex.banPosition.find( start );
+
+		if ( it == adminIndex.banPosition.end() )
 		{
-			continue;
+			return nullptr;
 		}
 
-		if ( G_admin_ban_matches( ban, ent ) )
+		first = it->second + 1;
+	}
+
+	best = INT_MAX;
+
+	auto consider = [&]( const std::vector<int> &positions )
+	{
+		for ( int pos : positions )
 		{
-			return ban;
+			g_admin_ban_t *ban;
+
+			if ( pos < first )
+			{
+				continue;
+			}
+
+			if ( pos >= best )
+			{
+				break;
+			}
+
+			ban = adminIndex.bans[ pos ];
+
+			// 0 is for perm ban
+			if ( ban->expires != 0 && ban->expires <= t )
+			{
+				continue;
+			}
+
+			if ( G_admin_ban_matches( ban, ent ) )
+			{
+				best = pos;
+				break;
+			}
 		}
+	};
+
+	auto guid = adminIndex.banGuids.find( G_GuidKey( ent->client->pers.guid ) );
+
+	if ( guid != adminIndex.banGuids.end() )
+	{
+		consider( guid->second );
 	}
 
-	return nullptr;
+	if ( !G_admin_permission( ent, ADMF_IMMUNITY ) )
+	{
+		node = ( ip->type == IPv6 ) ? 1 : 0;
+		mask = ( ip->type == IPv6 ) ? 128 : 32;
+
+		// child index 0 is a root, so it doubles as "no child"
+		for ( i = 0; ; i++ )
+		{
+			consider( adminIndex.banTrie[ node ].bans );
+
+			if ( i == mask || !adminIndex.banTrie[ node ].child[ admin_index_bit( ip, i ) ] )
+			{
+				break;
+			}
+
+			node = adminIndex.banTrie[ node ].child[ admin_index_bit( ip, i ) ];
+		}
+	}
+
+	return ( best != INT_MAX ) ? adminIndex.bans[ best ] : nullptr;
 }
 
 bool G_admin_ban_check( gentity_t *ent, char *reason, int rlen )
@@ -1782,8 +2030,287 @@ void G_admin_pubkey()
 			highest->counter = -1;
 		}
 
-		G_admin_writeconfig();
+		G_admin_journal_admin( highest );
+	}
+}
+
+static bool admin_readconfig_admin_field( const char *t, const char **cnf, g_admin_admin_t *a )
+{
+	if ( !Q_stricmp( t, "name" ) )
+	{
+		admin_readconfig_string( cnf, a->name, sizeof( a->name ) );
+	}
+	else if ( !Q_stricmp( t, "guid" ) )
+	{
+		admin_readconfig_string( cnf, a->guid, sizeof( a->guid ) );
+	}
+	else if ( !Q_stricmp( t, "level" ) )
+	{
+		admin_readconfig_int( cnf, &a->level );
+	}
+	else if ( !Q_stricmp( t, "flags" ) )
+	{
+		admin_readconfig_string( cnf, a->flags, sizeof( a->flags ) );
+	}
+	else if ( !Q_stricmp( t, "pubkey" ) )
+	{
+		admin_readconfig_string( cnf, a->pubkey, sizeof( a->pubkey ) );
+	}
+	else if ( !Q_stricmp( t, "msg" ) )
+	{
+		admin_readconfig_string( cnf, a->msg, sizeof( a->msg ) );
+	}
+	else if ( !Q_stricmp( t, "msg2" ) )
+	{
+		admin_readconfig_string( cnf, a->msg2, sizeof( a->msg2 ) );
+	}
+	else if ( !Q_stricmp( t, "counter" ) )
+	{
+		admin_readconfig_int( cnf, &a->counter );
+	}
+	else if ( !Q_stricmp( t, "lastseen" ) )
+	{
+		unsigned int tm;
+		admin_readconfig_int( cnf, (int *) &tm );
+		// trust the admin here...
+		a->lastSeen.tm_year = tm / 10000;
+		a->lastSeen.tm_mon = ( tm / 100 ) % 100;
+		a->lastSeen.tm_mday = tm % 100;
+	}
+	else
+	{
+		return false;
+	}
+
+	return true;
+}
+
+static bool admin_readconfig_ban_field( const char *t, const char **cnf, g_admin_ban_t *b )
+{
+	char ip[ 44 ];
+
+	if ( !Q_stricmp( t, "id" ) )
+	{
+		admin_readconfig_int( cnf, &b->id );
+	}
+	else if ( !Q_stricmp( t, "name" ) )
+	{
+		admin_readconfig_string( cnf, b->name, sizeof( b->name ) );
+	}
+	else if ( !Q_stricmp( t, "guid" ) )
+	{
+		admin_readconfig_string( cnf, b->guid, sizeof( b->guid ) );
+	}
+	else if ( !Q_stricmp( t, "ip" ) )
+	{
+		admin_readconfig_string( cnf, ip, sizeof( ip ) );
+		G_AddressParse( ip, &b->ip );
+	}
+	else if ( !Q_stricmp( t, "reason" ) )
+	{
+		admin_readconfig_string( cnf, b->reason, sizeof( b->reason ) );
+	}
+	else if ( !Q_stricmp( t, "made" ) )
+	{
+		admin_readconfig_string( cnf, b->made, sizeof( b->made ) );
+	}
+	else if ( !Q_stricmp( t, "expires" ) )
+	{
+		admin_readconfig_int( cnf, &b->expires );
+	}
+	else if ( !Q_stricmp( t, "banner" ) )
+	{
+		admin_readconfig_string( cnf, b->banner, sizeof( b->banner ) );
+	}
+	else
+	{
+		return false;
+	}
+
+	return true;
+}
+
+// applies the journal to the lists read from g_admin, returns the number of records
+static int admin_readjournal()
+{
+	enum { RECORD_NONE, RECORD_ADMIN, RECORD_BAN, RECORD_UNBAN } record = RECORD_NONE;
+
+	std::unordered_map<std::string, g_admin_admin_t *> admins;
+	std::unordered_map<int, g_admin_ban_t *>           bans;
+	g_admin_admin_t                                    *a, *aTail = nullptr;
+	g_admin_ban_t                                      *b, *bTail = nullptr, *prev;
+	g_admin_admin_t                                    admin;
+	g_admin_ban_t                                      ban;
+	fileHandle_t                                       f;
+	int                                                len, count = 0;
+	char                                               *cnf1, *t;
+	const char                                         *cnf;
+
+	len = trap_FS_FOpenFile( admin_journal_name(), &f, fsMode_t::FS_READ );
+
+	if ( len < 0 )
+	{
+		return 0;
+	}
+
+	cnf1 = (char*) BG_Alloc( len + 1 );
+	trap_FS_Read( cnf1, len, f );
+	cnf1[ len ] = '\0';
+	cnf = cnf1;
+	trap_FS_FCloseFile( f );
+
+	for ( a = g_admin_admins; a; aTail = a, a = a->next )
+	{
+		admins.emplace( G_GuidKey( a->guid ), a );
+	}
+
+	for ( b = g_admin_bans; b; bTail = b, b = b->next )
+	{
+		bans.emplace( b->id, b );
+	}
+
+	COM_BeginParseSession( admin_journal_name() );
+
+	while ( 1 )
+	{
+		t = COM_Parse( &cnf );
+
+		// a new header or the end of the file completes the open record
+		if ( record != RECORD_NONE && ( !*t || t[ 0 ] == '[' ) )
+		{
+			if ( record == RECORD_ADMIN )
+			{
+				auto it = admins.find( G_GuidKey( admin.guid ) );
+
+				if ( it != admins.end() )
+				{
+					a = it->second;
+					admin.next = a->next;
+				}
+				else
+				{
+					a = (g_admin_admin_t*) BG_Alloc( sizeof( g_admin_admin_t ) );
+					admin.next = nullptr;
+
+					if ( aTail )
+					{
+						aTail->next = a;
+					}
+					else
+					{
+						g_admin_admins = a;
+					}
+
+					aTail = a;
+					admins.emplace( G_GuidKey( admin.guid ), a );
+				}
+
+				*a = admin;
+			}
+			else if ( record == RECORD_BAN )
+			{
+				auto it = bans.find( ban.id );
+
+				if ( it != bans.end() )
+				{
+					b = it->second;
+					ban.next = b->next;
+				}
+				else
+				{
+					b = (g_admin_ban_t*) BG_Alloc( sizeof( g_admin_ban_t ) );
+					ban.next = nullptr;
+
+					if ( bTail )
+					{
+						bTail->next = b;
+					}
+					else
+					{
+						g_admin_bans = b;
+					}
+
+					bTail = b;
+					bans.emplace( ban.id, b );
+				}
+
+				*b = ban;
+			}
+			else
+			{
+				auto it = bans.find( ban.id );
+
+				// unlinked in one pass below
+				if ( it != bans.end() )
+				{
+					it->second->id = 0;
+					bans.erase( it );
+				}
+			}
+
+			record = RECORD_NONE;
+			count++;
+		}
+
+		if ( !*t )
+		{
+			break;
+		}
+
+		if ( !Q_stricmp( t, "[admin]" ) )
+		{
+			memset( &admin, 0, sizeof( admin ) );
+			record = RECORD_ADMIN;
+		}
+		else if ( !Q_stricmp( t, "[ban]" ) || !Q_stricmp( t, "[warning]" ) || !Q_stricmp( t, "[unban]" ) )
+		{
+			memset( &ban, 0, sizeof( ban ) );
+			ban.warnCount = ( t[ 1 ] == 'w' ) ? -1 : 0;
+			record = ( t[ 1 ] == 'u' ) ? RECORD_UNBAN : RECORD_BAN;
+		}
+		else if ( record == RECORD_ADMIN )
+		{
+			if ( !admin_readconfig_admin_field( t, &cnf, &admin ) )
+			{
+				COM_ParseError( "[admin] unrecognized token \"%s\"", t );
+			}
+		}
+		else if ( record == RECORD_BAN || record == RECORD_UNBAN )
+		{
+			if ( !admin_readconfig_ban_field( t, &cnf, &ban ) )
+			{
+				COM_ParseError( "[ban] unrecognized token \"%s\"", t );
+			}
+		}
+		else
+		{
+			COM_ParseError( "unexpected token \"%s\"", t );
+		}
+	}
+
+	BG_Free( cnf1 );
+
+	for ( prev = nullptr, b = g_admin_bans; b; b = prev ? prev->next : g_admin_bans )
+	{
+		if ( b->id )
+		{
+			prev = b;
+			continue;
+		}
+
+		if ( prev )
+		{
+			prev->next = b->next;
+		}
+		else
+		{
+			g_admin_bans = b->next;
+		}
+
+		BG_Free( b );
 	}
+
+	return count;
 }
 
 bool G_admin_readconfig( gentity_t *ent )
@@ -1799,7 +2326,6 @@ bool G_admin_readconfig( gentity_t *ent )
 	char              *t;
 	bool              level_open, admin_open, ban_open, command_open;
 	int               i;
-	char              ip[ 44 ];
 
 	G_admin_cleanup();
 
@@ -1817,6 +2343,13 @@ bool G_admin_readconfig( gentity_t *ent )
 		Log::Warn( "^3readconfig: ^7could not open admin config file %s",
 		          g_admin.string );
 		admin_default_levels();
+
+		// changes made before the file was first written
+		if ( ( adminJournalEntries = admin_readjournal() ) )
+		{
+			G_admin_writeconfig();
+		}
+
 		return false;
 	}
 
@@ -1936,84 +2469,14 @@ bool G_admin_readconfig( gentity_t *ent )
 		}
 		else if ( admin_open )
 		{
-			if ( !Q_stricmp( t, "name" ) )
-			{
-				admin_readconfig_string( &cnf, a->name, sizeof( a->name ) );
-			}
-			else if ( !Q_stricmp( t, "guid" ) )
-			{
-				admin_readconfig_string( &cnf, a->guid, sizeof( a->guid ) );
-			}
-			else if ( !Q_stricmp( t, "level" ) )
-			{
-				admin_readconfig_int( &cnf, &a->level );
-			}
-			else if ( !Q_stricmp( t, "flags" ) )
-			{
-				admin_readconfig_string( &cnf, a->flags, sizeof( a->flags ) );
-			}
-			else if ( !Q_stricmp( t, "pubkey" ) )
-			{
-				admin_readconfig_string( &cnf, a->pubkey, sizeof( a->pubkey ) );
-			}
-			else if ( !Q_stricmp( t, "msg" ) )
-			{
-				admin_readconfig_string( &cnf, a->msg, sizeof( a->msg ) );
-			}
-			else if ( !Q_stricmp( t, "msg2" ) )
-			{
-				admin_readconfig_string( &cnf, a->msg2, sizeof( a->msg2 ) );
-			}
-			else if ( !Q_stricmp( t, "counter" ) )
-			{
-				admin_readconfig_int( &cnf, &a->counter );
-			}
-			else if ( !Q_stricmp( t, "lastseen" ) )
-			{
-				unsigned int tm;
-				admin_readconfig_int( &cnf, (int *) &tm );
-				// trust the admin here...
-				a->lastSeen.tm_year = tm / 10000;
-				a->lastSeen.tm_mon = ( tm / 100 ) % 100;
-				a->lastSeen.tm_mday = tm % 100;
-			}
-			else
+			if ( !admin_readconfig_admin_field( t, &cnf, a ) )
 			{
 				COM_ParseError( "[admin] unrecognized token \"%s\"", t );
 			}
 		}
 		else if ( ban_open )
 		{
-			if ( !Q_stricmp( t, "name" ) )
-			{
-				admin_readconfig_string( &cnf, b->name, sizeof( b->name ) );
-			}
-			else if ( !Q_stricmp( t, "guid" ) )
-			{
-				admin_readconfig_string( &cnf, b->guid, sizeof( b->guid ) );
-			}
-			else if ( !Q_stricmp( t, "ip" ) )
-			{
-				admin_readconfig_string( &cnf, ip, sizeof( ip ) );
-				G_AddressParse( ip, &b->ip );
-			}
-			else if ( !Q_stricmp( t, "reason" ) )
-			{
-				admin_readconfig_string( &cnf, b->reason, sizeof( b->reason ) );
-			}
-			else if ( !Q_stricmp( t, "made" ) )
-			{
-				admin_readconfig_string( &cnf, b->made, sizeof( b->made ) );
-			}
-			else if ( !Q_stricmp( t, "expires" ) )
-			{
-				admin_readconfig_int( &cnf, &b->expires );
-			}
-			else if ( !Q_stricmp( t, "banner" ) )
-			{
-				admin_readconfig_string( &cnf, b->banner, sizeof( b->banner ) );
-			}
-			else
+			if ( !admin_readconfig_ban_field( t, &cnf, b ) )
 			{
 				COM_ParseError( "[ban] unrecognized token \"%s\"", t );
 			}
@@ -2048,6 +2511,7 @@ bool G_admin_readconfig( gentity_t *ent )
 	}
 
 	BG_Free( cnf2 );
+	adminJournalEntries = admin_readjournal();
 	ADMP( va( "%s %d %d %d %d", QQ( N_("^3readconfig: ^7loaded $1$ levels, $2$ admins, $3$ bans, $4$ commands") ),
 	          lc, ac, bc, cc ) );
 
@@ -2061,6 +2525,13 @@ bool G_admin_readconfig( gentity_t *ent )
 		llsort( ( struct llist ** ) &g_admin_admins, cmplevel );
 	}
 
+	admin_index_invalidate();
+
+	if ( adminJournalEntries )
+	{
+		G_admin_writeconfig();
+	}
+
 	// restore admin mapping
 	for ( i = 0; i < level.maxclients; i++ )
 	{
@@ -2236,6 +2707,7 @@ bool G_admin_setlevel( gentity_t *ent )
 		vic->client->pers.admin = a;
 		Q_strncpyz( a->guid, vic->client->pers.guid, sizeof( a->guid ) );
 		Com_GMTime( &a->lastSeen ); // player is connected...
+		admin_index_invalidate();
 	}
 
 	if ( !a )
@@ -2264,7 +2736,7 @@ bool G_admin_setlevel( gentity_t *ent )
 	      "print_tr %s %s %d %s", QQ( N_("^3setlevel: ^7$1$^7 was given level $2$ admin rights by $3$") ),
 	      Quote( a->name ), a->level, G_quoted_admin_name( ent ) ) );
 
-	G_admin_writeconfig();
+	G_admin_journal_admin( a );
 
 	if ( vic )
 	{
@@ -2322,6 +2794,7 @@ static g_admin_ban_t *admin_create_ban_entry( gentity_t *ent, char *netname, cha
 				expired--;
 			}
 
+			admin_journal_unban( u->id );
 			BG_Free( u );
 		}
 		else
@@ -2350,6 +2823,7 @@ static g_admin_ban_t *admin_create_ban_entry( gentity_t *ent, char *netname, cha
 	Q_strncpyz( b->name, netname, sizeof( b->name ) );
 	Q_strncpyz( b->guid, guid, sizeof( b->guid ) );
 	memcpy( &b->ip, ip, sizeof( b->ip ) );
+	admin_index_invalidate();
 
 	Com_sprintf( b->made, sizeof( b->made ), "%04i-%02i-%02i %02i:%02i:%02i",
 	             1900 + qt.tm_year, qt.tm_mon + 1, qt.tm_mday,
@@ -2381,6 +2855,8 @@ static void admin_create_ban( gentity_t *ent,
 	char          disconnect[ MAX_STRING_CHARS ];
 	g_admin_ban_t *b = admin_create_ban_entry( ent, netname, guid, ip, seconds, ( reason && *reason ) ? reason : "banned by admin" );
 
+	admin_journal_ban( b );
+
 	G_admin_ban_message( nullptr, b, disconnect, sizeof( disconnect ), nullptr, 0 );
 
 	for ( i = 0; i < level.maxclients; i++ )
@@ -2549,7 +3025,6 @@ bool G_admin_kick( gentity_t *ent )
 	                  &vic->client->pers.ip,
 	                  std::max( 1, time ),
 	                  ( *reason ) ? reason : "kicked by admin" );
-	G_admin_writeconfig();
 
 	return true;
 }
@@ -2712,10 +3187,6 @@ bool G_admin_ban( gentity_t *ent )
 	{
 		ADMP( QQ( N_("^3ban: ^7WARNING g_admin not set, not saving ban to a file" ) ) );
 	}
-	else
-	{
-		G_admin_writeconfig();
-	}
 
 	return true;
 }
@@ -2778,6 +3249,7 @@ bool G_admin_unban( gentity_t *ent )
 		        bnum, Quote( ban->name ), G_quoted_admin_name( ent ) ) );
 
 		ban->expires = time;
+		admin_journal_ban( ban );
 	}
 	else
 	{
@@ -2793,7 +3265,9 @@ bool G_admin_unban( gentity_t *ent )
 			p->next = ban->next;
 		}
 
+		admin_journal_unban( ban->id );
 		BG_Free( ban );
+		admin_index_invalidate();
 	}
 
 	if ( wasWarning )
@@ -2801,7 +3275,6 @@ bool G_admin_unban( gentity_t *ent )
 		G_admin_reflag_warnings();
 	}
 
-	G_admin_writeconfig();
 	return true;
 }
 
@@ -2943,6 +3416,7 @@ bool G_admin_adjustban( gentity_t *ent )
 		}
 
 		ban->ip.mask = mask;
+		admin_index_invalidate();
 	}
 
 	reason = ConcatArgs( 3 + skiparg );
@@ -2977,7 +3451,7 @@ bool G_admin_adjustban( gentity_t *ent )
 		G_admin_reflag_warnings();
 	}
 
-	G_admin_writeconfig();
+	admin_journal_ban( ban );
 	return true;
 }
 
@@ -3266,7 +3740,9 @@ bool G_admin_warn( gentity_t *ent )
 	if ( ent && !ent->client->pers.localClient )
 	{
 		int time = G_admin_parse_time( g_adminWarn.string );
-		admin_create_ban_entry( ent, vic->client->pers.netname, vic->client->pers.guid, &vic->client->pers.ip, std::max(1, time), ( *reason ) ? reason : "warned by admin" )->warnCount = -1;
+		g_admin_ban_t *warning = admin_create_ban_entry( ent, vic->client->pers.netname, vic->client->pers.guid, &vic->client->pers.ip, std::max(1, time), ( *reason ) ? reason : "warned by admin" );
+		warning->warnCount = -1;
+		admin_journal_ban( warning );
 		vic->client->pers.hasWarnings = true;
 	}
 
@@ -4516,18 +4992,7 @@ namelog_t *G_NamelogFromString( gentity_t *ent, char *s )
 		}
 		else if ( i >= MAX_CLIENTS )
 		{
-			for ( p = level.namelogs; p; p = p->next )
-			{
-				if ( p->id == i )
-				{
-					break;
-				}
-			}
-
-			if ( p )
-			{
-				return p;
-			}
+			return G_namelog_find( i );
 		}
 
 		return nullptr;
@@ -4963,7 +5428,15 @@ bool G_admin_flag( gentity_t *ent )
 		G_AdminMessage( ent, va( msg[ action ], flag, adminname ) );
 	}
 
-	G_admin_writeconfig();
+	// level flags are rare enough to rewrite the file for
+	if ( level )
+	{
+		G_admin_writeconfig();
+	}
+	else
+	{
+		G_admin_journal_admin( admin );
+	}
 
 	if( vic )
 	{
@@ -5577,6 +6050,8 @@ void G_admin_cleanup()
 	}
 
 	g_admin_commands = nullptr;
+
+	admin_index_invalidate();
 }
 
 bool G_admin_bot( gentity_t *ent )
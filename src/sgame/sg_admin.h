@@ -40,6 +40,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #define MAX_ADMIN_BAN_REASON 100
 
 #define MAX_ADMIN_EXPIRED_BANS   64
+#define MAX_ADMIN_JOURNAL_ENTRIES 1024
 #define G_ADMIN_BAN_EXPIRED(b,t) ( (b)->expires != 0 && (b)->expires <= (t) )
 #define G_ADMIN_BAN_STALE(b,t)   ( (b)->expires != 0 && (b)->expires + ( g_adminRetainExpiredBans.integer ? 86400 : 0 ) <= (t) )
 #define G_ADMIN_BAN_IS_WARNING(b) ( (b)->warnCount < 0 )
@@ -178,6 +179,7 @@ void            G_admin_register_cmds();
 void            G_admin_unregister_cmds();
 void            G_admin_cmdlist( gentity_t *ent );
 void            G_admin_writeconfig();
+void            G_admin_journal_admin( const g_admin_admin_t *a );
 void            G_admin_pubkey();
 
 bool        G_admin_ban_check( gentity_t *ent, char *reason, int rlen );
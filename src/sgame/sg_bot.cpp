@@ -24,6 +24,8 @@
 #include "sg_bot_util.h"
 #include "CBSE.h"
 
+#include <chrono>
+
 static botMemory_t g_botMind[MAX_CLIENTS];
 static AITreeList_t treeList;
 
@@ -179,6 +181,11 @@ bool G_BotSetDefaults( int clientNum, team_t team, int skill, const char* behavi
 	botMind->numRunningNodes = 0;
 	botMind->currentNode = nullptr;
 	memset( &botMind->nav, 0, sizeof( botMind->nav ) );
+	memset( &botMind->memo, 0, sizeof( botMind->memo ) );
+	botMind->memo.framenum = -1;
+
+	// stagger the perception updates of different bots
+	botMind->nextPerceptionTime = level.time + ( clientNum * std::max( g_bot_perceptionInterval.integer, 0 ) ) / MAX_CLIENTS;
 	BotResetEnemyQueue( &botMind->enemyQueue );
 
 	botMind->behaviorTree = ReadBehaviorTree( behavior, &treeList );
@@ -341,6 +348,46 @@ void G_BotDelAllBots()
  =======================
  */
 
+/*
+=======================
+Bot perception scheduling
+
+Looking for enemies and buildings scans all entities, so each bot only does it
+every g_bot_perceptionInterval milliseconds, with the bots spread over different
+frames. On top of that, at most g_bot_thinkBudget microseconds are spent on it
+per frame: due bots that don't fit wait for the next frame, unless they are a
+whole interval late already. The behavior tree, and with it movement and aiming,
+still runs every frame.
+=======================
+*/
+typedef std::chrono::steady_clock clock_type;
+
+static int perceptionFrame = -1;
+static int perceptionBudget; // microseconds left in this frame
+
+static bool BotPerceptionDue( gentity_t *self )
+{
+	int interval = std::max( g_bot_perceptionInterval.integer, 0 );
+
+	if ( perceptionFrame != level.framenum )
+	{
+		perceptionFrame = level.framenum;
+		perceptionBudget = g_bot_thinkBudget.integer;
+	}
+
+	if ( level.time < self->botMind->nextPerceptionTime )
+	{
+		return false;
+	}
+
+	if ( g_bot_thinkBudget.integer <= 0 || perceptionBudget > 0 )
+	{
+		return true;
+	}
+
+	return level.time >= self->botMind->nextPerceptionTime + interval;
+}
+
 void G_BotThink( gentity_t *self )
 {
 	char buf[MAX_STRING_CHARS];
@@ -368,9 +415,21 @@ void G_BotThink( gentity_t *self )
 	//MUST be done
 	while ( trap_BotGetServerCommand( self->client->ps.clientNum, buf, sizeof( buf ) ) );
 
-	BotSearchForEnemy( self );
-	BotFindClosestBuildings( self );
-	BotFindDamagedFriendlyStructure( self );
+	if ( BotPerceptionDue( self ) )
+	{
+		clock_type::time_point start = clock_type::now();
+
+		BotSearchForEnemy( self );
+		BotFindClosestBuildings( self );
+		BotFindDamagedFriendlyStructure( self );
+
+		perceptionBudget -= std::chrono::duration_cast<std::chrono::microseconds>( clock_type::now() - start ).count();
+		self->botMind->nextPerceptionTime = level.time + g_bot_perceptionInterval.integer;
+	}
+	else
+	{
+		BotRefreshPerception( self );
+	}
 
 	//use medkit when hp is low
 	if ( self->entity->Get<HealthComponent>()->Health() < BOT_USEMEDKIT_HP &&
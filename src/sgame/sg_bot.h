@@ -60,6 +60,23 @@ typedef struct
 #include "sg_bot_ai.h"
 #define MAX_NODE_DEPTH 20
 
+// results of expensive condition functions, kept for the current frame
+#define MAX_BOT_MEMO 32
+typedef struct
+{
+	int       func;
+	int       param;
+	int       entityNum;
+	AIValue_t value;
+} botMemoEntry_t;
+
+typedef struct
+{
+	int            framenum;
+	int            numEntries;
+	botMemoEntry_t entries[ MAX_BOT_MEMO ];
+} botMemo_t;
+
 typedef struct
 {
 	enemyQueue_t enemyQueue;
@@ -85,6 +102,9 @@ typedef struct
 	vec3_t      futureAim;
 	usercmd_t   cmdBuffer;
 	botNavCmd_t nav;
+
+	botMemo_t   memo;
+	int         nextPerceptionTime;
 } botMemory_t;
 
 bool G_BotAdd( char *name, team_t team, int skill, const char* behavior );
@@ -101,4 +121,6 @@ void     G_BotDisableArea( vec3_t origin, vec3_t mins, vec3_t maxs );
 void     G_BotEnableArea( vec3_t origin, vec3_t mins, vec3_t maxs );
 void     G_BotInit();
 void     G_BotCleanup(int restart);
+void     G_BotPrintMemoStats();
+void     G_BotResetMemoStats();
 #endif
@@ -323,93 +323,90 @@ AINodeStatus_t BotDecoratorReturn( gentity_t *self, AIGenericNode_t *node )
 	return status;
 }
 
-bool EvalConditionExpression( gentity_t *self, AIExpType_t *exp );
-
-double EvalFunc( gentity_t *self, AIExpType_t *exp )
-{
-	AIValueFunc_t *v = ( AIValueFunc_t * ) exp;
-	AIValue_t vt = v->func( self, v->params );
-	double vd = AIUnBoxDouble( vt );
-	AIDestroyValue( vt );
-	return vd;
-}
-
-// using double because it has enough precision to exactly represent both a float and an int
-double EvalValue( gentity_t *self, AIExpType_t *exp )
-{
-	AIValue_t *v = ( AIValue_t * ) exp;
-
-	if ( *exp == EX_FUNC )
-	{
-		return EvalFunc( self, exp );
-	}
-
-	if ( *exp != EX_VALUE )
-	{
-		return ( double ) EvalConditionExpression( self, exp );
-	}
-
-	return AIUnBoxDouble( *v );
-}
-
-bool EvaluateBinaryOp( gentity_t *self, AIExpType_t *exp )
-{
-	AIBinaryOp_t *o = ( AIBinaryOp_t * ) exp;
-
-	switch ( o->opType )
-	{
-		case OP_LESSTHAN:
-			return EvalValue( self, o->exp1 ) < EvalValue( self, o->exp2 );
-		case OP_LESSTHANEQUAL:
-			return EvalValue( self, o->exp1 ) <= EvalValue( self, o->exp2 );
-		case OP_GREATERTHAN:
-			return EvalValue( self, o->exp1 ) > EvalValue( self, o->exp2 );
-		case OP_GREATERTHANEQUAL:
-			return EvalValue( self, o->exp1 ) >= EvalValue( self, o->exp2 );
-		case OP_EQUAL:
-			return EvalValue( self, o->exp1 ) == EvalValue( self, o->exp2 );
-		case OP_NEQUAL:
-			return EvalValue( self, o->exp1 ) != EvalValue( self, o->exp2 );
-		case OP_AND:
-			return EvalConditionExpression( self, o->exp1 ) && EvalConditionExpression( self, o->exp2 );
-		case OP_OR:
-			return EvalConditionExpression( self, o->exp1 ) || EvalConditionExpression( self, o->exp2 );
-		default:
-			return false;
-	}
-}
+/*
+======================
+AIEvalCondition
 
-bool EvaluateUnaryOp( gentity_t *self, AIExpType_t *exp )
+Runs the compiled code of a condition expression
+======================
+*/
+bool AIEvalCondition( gentity_t *self, const AIConditionCode_t *condition )
 {
-	AIUnaryOp_t *o = ( AIUnaryOp_t * ) exp;
-	return !EvalConditionExpression( self, o->exp );
-}
+	double stack[ MAX_CONDITION_STACK ];
+	int    sp = 0;
+	int    pc = 0;
 
-bool EvalConditionExpression( gentity_t *self, AIExpType_t *exp )
-{
-	if ( *exp == EX_OP )
+	while ( pc < condition->numInstructions )
 	{
-		AIOp_t *op = ( AIOp_t * ) exp;
+		const AIInstruction_t *i = &condition->code[ pc++ ];
 
-		if ( isBinaryOp( op->opType ) )
-		{
-			return EvaluateBinaryOp( self, exp );
-		}
-		else if ( isUnaryOp( op->opType ) )
+		switch ( i->opcode )
 		{
-			return EvaluateUnaryOp( self, exp );
+			case CODE_CONST:
+				stack[ sp++ ] = i->arg.value;
+				break;
+			case CODE_FUNC:
+			{
+				AIValue_t v = i->arg.f.func( self, i->arg.f.params );
+				stack[ sp++ ] = AIUnBoxDouble( v );
+				AIDestroyValue( v );
+				break;
+			}
+			case CODE_NOT:
+				stack[ sp - 1 ] = stack[ sp - 1 ] == 0.0;
+				break;
+			case CODE_LESSTHAN:
+				sp--;
+				stack[ sp - 1 ] = stack[ sp - 1 ] < stack[ sp ];
+				break;
+			case CODE_LESSTHANEQUAL:
+				sp--;
+				stack[ sp - 1 ] = stack[ sp - 1 ] <= stack[ sp ];
+				break;
+			case CODE_GREATERTHAN:
+				sp--;
+				stack[ sp - 1 ] = stack[ sp - 1 ] > stack[ sp ];
+				break;
+			case CODE_GREATERTHANEQUAL:
+				sp--;
+				stack[ sp - 1 ] = stack[ sp - 1 ] >= stack[ sp ];
+				break;
+			case CODE_EQUAL:
+				sp--;
+				stack[ sp - 1 ] = stack[ sp - 1 ] == stack[ sp ];
+				break;
+			case CODE_NEQUAL:
+				sp--;
+				stack[ sp - 1 ] = stack[ sp - 1 ] != stack[ sp ];
+				break;
+			case CODE_BOOL:
+				stack[ sp - 1 ] = stack[ sp - 1 ] != 0.0;
+				break;
+			case CODE_JUMP_IF_FALSE:
+				if ( stack[ sp - 1 ] == 0.0 )
+				{
+					pc = i->arg.target;
+				}
+				else
+				{
+					sp--;
+				}
+				break;
+			case CODE_JUMP_IF_TRUE:
+				if ( stack[ sp - 1 ] != 0.0 )
+				{
+					stack[ sp - 1 ] = 1.0;
+					pc = i->arg.target;
+				}
+				else
+				{
+					sp--;
+				}
+				break;
 		}
 	}
-	else if ( *exp  == EX_VALUE )
-	{
-		return EvalValue( self, exp ) != 0.0;
-	}
-	else if ( *exp == EX_FUNC )
-	{
-		return EvalFunc( self, exp ) != 0.0;
-	}
 
-	return false;
+	return sp && stack[ sp - 1 ] != 0.0;
 }
 
 /*
@@ -427,7 +424,7 @@ AINodeStatus_t BotConditionNode( gentity_t *self, AIGenericNode_t *node )
 
 	AIConditionNode_t *con = ( AIConditionNode_t * ) node;
 
-	success = EvalConditionExpression( self, con->exp );
+	success = AIEvalCondition( self, &con->condition );
 	if ( success )
 	{
 		if ( con->child )
@@ -93,12 +93,27 @@ typedef struct
 	int numNodes;
 } AINodeList_t;
 
+// all the memory used by a behavior tree comes from its own arena,
+// which is released in one go when the tree is freed
+typedef struct AIArenaBlock_s
+{
+	struct AIArenaBlock_s *next;
+	size_t                size;
+	size_t                used;
+} AIArenaBlock_t;
+
+typedef struct
+{
+	AIArenaBlock_t *blocks; // the current block comes first
+} AIArena_t;
+
 typedef struct
 {
 	AINode_t     type;
 	AINodeRunner run;
 	char name[ MAX_QPATH ];
 	AIGenericNode_t *root;
+	AIArena_t    arena;
 } AIBehaviorTree_t;
 
 // operations used in condition nodes
@@ -179,12 +194,56 @@ typedef struct
 	AIExpType_t *exp;
 } AIUnaryOp_t;
 
+// condition expressions are compiled to code for a small stack machine
+// working on doubles, see CompileConditionExpression
+typedef enum
+{
+	CODE_CONST,            // push a constant
+	CODE_FUNC,             // push the result of a function
+	CODE_NOT,
+	CODE_LESSTHAN,
+	CODE_LESSTHANEQUAL,
+	CODE_GREATERTHAN,
+	CODE_GREATERTHANEQUAL,
+	CODE_EQUAL,
+	CODE_NEQUAL,
+	CODE_BOOL,             // convert the top of the stack to 0 or 1
+	CODE_JUMP_IF_FALSE,    // jump if the top is 0, pop it otherwise
+	CODE_JUMP_IF_TRUE      // jump and set the top to 1 if it isn't 0, pop it otherwise
+} AIOpcode_t;
+
+#define MAX_CONDITION_STACK 32
+
 typedef struct
 {
-	AINode_t        type;
-	AINodeRunner    run;
-	AIGenericNode_t *child;
-	AIExpType_t     *exp;
+	AIOpcode_t opcode;
+	int        nparams;
+
+	union
+	{
+		double value;
+		int    target;
+
+		struct
+		{
+			AIFunc    func;
+			AIValue_t *params;
+		} f;
+	} arg;
+} AIInstruction_t;
+
+typedef struct
+{
+	AIInstruction_t *code;
+	int             numInstructions;
+} AIConditionCode_t;
+
+typedef struct
+{
+	AINode_t          type;
+	AINodeRunner      run;
+	AIGenericNode_t   *child;
+	AIConditionCode_t condition;
 } AIConditionNode_t;
 
 typedef struct
@@ -219,6 +278,8 @@ const char *AIUnBoxString( AIValue_t v );
 
 void AIDestroyValue( AIValue_t v );
 
+bool AIEvalCondition( gentity_t *self, const AIConditionCode_t *condition );
+
 botEntityAndDistance_t AIEntityToGentity( gentity_t *self, AIEntity_t e );
 
 // standard behavior tree control-flow nodes
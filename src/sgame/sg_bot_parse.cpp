@@ -24,6 +24,89 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "sg_bot_util.h"
 #include "CBSE.h"
 
+#include <vector>
+
+/*
+======================
+Behavior tree arenas
+
+Everything a behavior tree is made of, nodes, compiled conditions,
+parameters and their strings, is carved out of large blocks owned by
+the tree. Nothing is freed on its own, the whole arena goes at once
+when the tree is freed. Token lists use a temporary arena in the same way.
+======================
+*/
+#define AI_ARENA_BLOCK_SIZE 32768
+#define AI_ARENA_ALIGN      16
+
+// the arena the nodes of the tree being read are allocated from
+static AIArena_t *currentArena = nullptr;
+
+#define allocNode(T) ( T * ) AIArenaAlloc( currentArena, sizeof( T ) );
+
+static inline size_t arenaAlign( size_t size )
+{
+	return ( size + AI_ARENA_ALIGN - 1 ) & ~( size_t ) ( AI_ARENA_ALIGN - 1 );
+}
+
+void *AIArenaAlloc( AIArena_t *arena, size_t size )
+{
+	AIArenaBlock_t *block = arena->blocks;
+	size_t         header = arenaAlign( sizeof( AIArenaBlock_t ) );
+	byte           *ret;
+
+	size = arenaAlign( size );
+
+	if ( !block || block->used + size > block->size )
+	{
+		size_t blockSize = std::max( size, ( size_t ) AI_ARENA_BLOCK_SIZE );
+
+		// BG_Alloc clears the memory, so allocations come zeroed
+		block = ( AIArenaBlock_t * ) BG_Alloc( header + blockSize );
+		block->size = blockSize;
+		block->used = 0;
+
+		if ( arena->blocks && size > AI_ARENA_BLOCK_SIZE / 4 )
+		{
+			// large allocations get a block of their own, keep filling the current one
+			block->next = arena->blocks->next;
+			arena->blocks->next = block;
+		}
+		else
+		{
+			block->next = arena->blocks;
+			arena->blocks = block;
+		}
+	}
+
+	ret = ( byte * ) block + header + block->used;
+	block->used += size;
+	return ret;
+}
+
+char *AIArenaStrdup( AIArena_t *arena, const char *s )
+{
+	size_t len = strlen( s ) + 1;
+	char   *ret = ( char * ) AIArenaAlloc( arena, len );
+
+	memcpy( ret, s, len );
+	return ret;
+}
+
+void AIArenaFree( AIArena_t *arena )
+{
+	AIArenaBlock_t *block = arena->blocks;
+
+	while ( block )
+	{
+		AIArenaBlock_t *next = block->next;
+		BG_Free( block );
+		block = next;
+	}
+
+	arena->blocks = nullptr;
+}
+
 static bool expectToken( const char *s, pc_token_list **list, bool next )
 {
 	const pc_token_list *current = *list;
@@ -51,7 +134,13 @@ AIValue_t AIBoxToken( const pc_token_stripped_t *token )
 {
 	if ( token->type == tokenType_t::TT_STRING )
 	{
-		return AIBoxString( token->string );
+		AIValue_t v;
+
+		// the string lives as long as the tree, it must never go through AIDestroyValue
+		v.expType = EX_VALUE;
+		v.valType = VALUE_STRING;
+		v.l.stringValue = AIArenaStrdup( currentArena, token->string );
+		return v;
 	}
 
 	if ( ( float ) token->intvalue != token->floatvalue )
@@ -64,6 +153,96 @@ AIValue_t AIBoxToken( const pc_token_stripped_t *token )
 	}
 }
 
+// expensive functions remember their results for the current frame, per bot
+typedef enum
+{
+	MEMO_BASERUSHSCORE,
+	MEMO_DIRECTPATHTO,
+	MEMO_DISTANCETO,
+	MEMO_HEALSCORE,
+	MEMO_INATTACKRANGE,
+	MEMO_ISVISIBLE,
+	MEMO_NUM_FUNCS
+} botMemoFunc_t;
+
+static const char *memoFuncNames[ MEMO_NUM_FUNCS ] =
+{
+	"baseRushScore",
+	"directPathTo",
+	"distanceTo",
+	"healScore",
+	"inAttackRange",
+	"isVisible"
+};
+
+static int memoHits[ MEMO_NUM_FUNCS ];
+static int memoMisses[ MEMO_NUM_FUNCS ];
+
+static bool BotMemoLookup( gentity_t *self, botMemoFunc_t func, int param, const gentity_t *ent, AIValue_t *value )
+{
+	botMemo_t *memo = &self->botMind->memo;
+	int       entityNum = ent ? ent->s.number : -1;
+
+	if ( memo->framenum != level.framenum )
+	{
+		memo->framenum = level.framenum;
+		memo->numEntries = 0;
+	}
+
+	for ( int i = 0; i < memo->numEntries; i++ )
+	{
+		botMemoEntry_t *entry = &memo->entries[ i ];
+
+		if ( entry->func == func && entry->param == param && entry->entityNum == entityNum )
+		{
+			*value = entry->value;
+			memoHits[ func ]++;
+			return true;
+		}
+	}
+
+	memoMisses[ func ]++;
+	return false;
+}
+
+static AIValue_t BotMemoStore( gentity_t *self, botMemoFunc_t func, int param, const gentity_t *ent, AIValue_t value )
+{
+	botMemo_t      *memo = &self->botMind->memo;
+	botMemoEntry_t *entry;
+
+	if ( memo->numEntries == MAX_BOT_MEMO )
+	{
+		return value;
+	}
+
+	entry = &memo->entries[ memo->numEntries++ ];
+	entry->func = func;
+	entry->param = param;
+	entry->entityNum = ent ? ent->s.number : -1;
+	entry->value = value;
+
+	return value;
+}
+
+void G_BotPrintMemoStats()
+{
+	Log::Notice( "%-16s %10s %10s %6s", "function", "hits", "misses", "hit %" );
+
+	for ( int i = 0; i < MEMO_NUM_FUNCS; i++ )
+	{
+		int calls = memoHits[ i ] + memoMisses[ i ];
+
+		Log::Notice( "%-16s %10d %10d %6.1f", memoFuncNames[ i ], memoHits[ i ], memoMisses[ i ],
+		             calls ? 100.0f * memoHits[ i ] / calls : 0.0f );
+	}
+}
+
+void G_BotResetMemoStats()
+{
+	memset( memoHits, 0, sizeof( memoHits ) );
+	memset( memoMisses, 0, sizeof( memoMisses ) );
+}
+
 // functions that are used to provide values to the behavior tree in condition nodes
 static AIValue_t buildingIsDamaged( gentity_t *self, const AIValue_t* )
 {
@@ -159,19 +338,48 @@ static AIValue_t teamateHasWeapon( gentity_t *self, const AIValue_t *params )
 static AIValue_t distanceTo( gentity_t *self, const AIValue_t *params )
 {
 	AIEntity_t e = ( AIEntity_t ) AIUnBoxInt( params[ 0 ] );
-	botEntityAndDistance_t ent = AIEntityToGentity( self, e );
-	
-	return AIBoxFloat( ent.distance );
+	botEntityAndDistance_t ent;
+	AIValue_t ret;
+
+	// distances to anything but the goal are already stored in botMind,
+	// and a goal that is a position isn't a usable key
+	if ( e != E_GOAL || !self->botMind->goal.ent )
+	{
+		return AIBoxFloat( AIEntityToGentity( self, e ).distance );
+	}
+
+	if ( BotMemoLookup( self, MEMO_DISTANCETO, e, self->botMind->goal.ent, &ret ) )
+	{
+		return ret;
+	}
+
+	ent = AIEntityToGentity( self, e );
+
+	return BotMemoStore( self, MEMO_DISTANCETO, e, self->botMind->goal.ent, AIBoxFloat( ent.distance ) );
 }
 
 static AIValue_t baseRushScore( gentity_t *self, const AIValue_t* )
 {
-	return AIBoxFloat( BotGetBaseRushScore( self ) );
+	AIValue_t ret;
+
+	if ( BotMemoLookup( self, MEMO_BASERUSHSCORE, 0, nullptr, &ret ) )
+	{
+		return ret;
+	}
+
+	return BotMemoStore( self, MEMO_BASERUSHSCORE, 0, nullptr, AIBoxFloat( BotGetBaseRushScore( self ) ) );
 }
 
 static AIValue_t healScore( gentity_t *self, const AIValue_t* )
 {
-	return AIBoxFloat( BotGetHealScore( self ) );
+	AIValue_t ret;
+
+	if ( BotMemoLookup( self, MEMO_HEALSCORE, 0, nullptr, &ret ) )
+	{
+		return ret;
+	}
+
+	return BotMemoStore( self, MEMO_HEALSCORE, 0, nullptr, AIBoxFloat( BotGetHealScore( self ) ) );
 }
 
 static AIValue_t botClass( gentity_t *self, const AIValue_t* )
@@ -189,20 +397,21 @@ static AIValue_t inAttackRange( gentity_t *self, const AIValue_t *params )
 	botTarget_t target;
 	AIEntity_t et = ( AIEntity_t ) AIUnBoxInt( params[ 0 ] );
 	botEntityAndDistance_t e = AIEntityToGentity( self ,et );
+	AIValue_t ret;
 
 	if ( !e.ent )
 	{
 		return AIBoxInt( false );
 	}
 
-	BotSetTarget( &target, e.ent, nullptr );
-
-	if ( BotTargetInAttackRange( self, target ) )
+	if ( BotMemoLookup( self, MEMO_INATTACKRANGE, et, e.ent, &ret ) )
 	{
-		return AIBoxInt( true );
+		return ret;
 	}
 
-	return AIBoxInt( false );
+	BotSetTarget( &target, e.ent, nullptr );
+
+	return BotMemoStore( self, MEMO_INATTACKRANGE, et, e.ent, AIBoxInt( BotTargetInAttackRange( self, target ) ) );
 }
 
 static AIValue_t isVisible( gentity_t *self, const AIValue_t *params )
@@ -210,12 +419,19 @@ static AIValue_t isVisible( gentity_t *self, const AIValue_t *params )
 	botTarget_t target;
 	AIEntity_t et = ( AIEntity_t ) AIUnBoxInt( params[ 0 ] );
 	botEntityAndDistance_t e = AIEntityToGentity( self, et );
+	AIValue_t ret;
 
 	if ( !e.ent )
 	{
 		return AIBoxInt( false );
 	}
 
+	// enemyLastSeen has already been updated if this was visible
+	if ( BotMemoLookup( self, MEMO_ISVISIBLE, et, e.ent, &ret ) )
+	{
+		return ret;
+	}
+
 	BotSetTarget( &target, e.ent, nullptr );
 
 	if ( BotTargetIsVisible( self, target, CONTENTS_SOLID ) )
@@ -224,10 +440,10 @@ static AIValue_t isVisible( gentity_t *self, const AIValue_t *params )
 		{
 			self->botMind->enemyLastSeen = level.time;
 		}
-		return AIBoxInt( true );
+		return BotMemoStore( self, MEMO_ISVISIBLE, et, e.ent, AIBoxInt( true ) );
 	}
 
-	return AIBoxInt( false );
+	return BotMemoStore( self, MEMO_ISVISIBLE, et, e.ent, AIBoxInt( false ) );
 }
 
 static AIValue_t directPathTo( gentity_t *self, const AIValue_t *params )
@@ -242,8 +458,15 @@ static AIValue_t directPathTo( gentity_t *self, const AIValue_t *params )
 	else if ( ed.ent )
 	{
 		botTarget_t target;
+		AIValue_t   ret;
+
+		if ( BotMemoLookup( self, MEMO_DIRECTPATHTO, e, ed.ent, &ret ) )
+		{
+			return ret;
+		}
+
 		BotSetTarget( &target, ed.ent, nullptr );
-		return AIBoxInt( BotPathIsWalkable( self, target ) );
+		return BotMemoStore( self, MEMO_DIRECTPATHTO, e, ed.ent, AIBoxInt( BotPathIsWalkable( self, target ) ) );
 	}
 
 	return AIBoxInt( false );
@@ -447,13 +670,13 @@ static AIOp_t *newOp( pc_token_list *list )
 
 	if ( isBinaryOp( op ) )
 	{
-		AIBinaryOp_t *b = ( AIBinaryOp_t * ) BG_Alloc( sizeof( *b ) );
+		AIBinaryOp_t *b = allocNode( AIBinaryOp_t );
 		b->opType = op;
 		ret = ( AIOp_t * ) b;
 	}
 	else if ( isUnaryOp( op ) )
 	{
-		AIUnaryOp_t *u = ( AIUnaryOp_t * ) BG_Alloc( sizeof( *u ) );
+		AIUnaryOp_t *u = allocNode( AIUnaryOp_t );
 		u->opType = op;
 		ret = ( AIOp_t * ) u;
 	}
@@ -467,7 +690,7 @@ static AIValue_t *newValueLiteral( pc_token_list **list )
 	pc_token_list *current = *list;
 	pc_token_stripped_t *token = &current->token;
 
-	ret = ( AIValue_t * ) BG_Alloc( sizeof( *ret ) );
+	ret = allocNode( AIValue_t );
 
 	*ret = AIBoxToken( token );
 
@@ -539,7 +762,7 @@ static AIValue_t *parseFunctionParameters( pc_token_list **list, int *nparams, i
 	if ( numParams )
 	{
 		// add the parameters
-		params = ( AIValue_t * ) BG_Alloc( sizeof( *params ) * numParams );
+		params = ( AIValue_t * ) AIArenaAlloc( currentArena, sizeof( *params ) * numParams );
 
 		numParams = 0;
 		parse = parenBegin->next;
@@ -586,7 +809,7 @@ static AIValueFunc_t *newValueFunc( pc_token_list **list )
 	// if the function has no parameters, allow it to be used without parenthesis
 	if ( v.nparams == 0 && parenBegin->token.string[ 0 ] != '(' )
 	{
-		ret = ( AIValueFunc_t * ) BG_Alloc( sizeof( *ret ) );
+		ret = allocNode( AIValueFunc_t );
 		memcpy( ret, &v, sizeof( *ret ) );
 
 		*list = current->next;
@@ -601,7 +824,7 @@ static AIValueFunc_t *newValueFunc( pc_token_list **list )
 	}
 
 	// create the value op
-	ret = ( AIValueFunc_t * ) BG_Alloc( sizeof( *ret ) );
+	ret = allocNode( AIValueFunc_t );
 
 	// copy the members
 	memcpy( ret, &v, sizeof( *ret ) );
@@ -658,8 +881,6 @@ static AIExpType_t *ReadConditionExpression( pc_token_list **list, AIOpType_t op
 		if ( !t1 )
 		{
 			Log::Warn( "Missing right operand for %s on line %d", opTypeToString( op ), prev->token.line );
-			FreeExpression( t );
-			FreeOp( exp );
 			return nullptr;
 		}
 
@@ -686,7 +907,6 @@ static AIExpType_t *Primary( pc_token_list **list )
 		if ( !t )
 		{
 			Log::Warn( "Missing right operand for %s on line %d", opTypeToString( op->opType ), current->token.line );
-			FreeOp( op );
 			return nullptr;
 		}
 
@@ -716,6 +936,193 @@ static AIExpType_t *Primary( pc_token_list **list )
 	return tree;
 }
 
+static void emitConst( std::vector<AIInstruction_t> &code, double value )
+{
+	AIInstruction_t i;
+
+	memset( &i, 0, sizeof( i ) );
+	i.opcode = CODE_CONST;
+	i.arg.value = value;
+	code.push_back( i );
+}
+
+static void emitOp( std::vector<AIInstruction_t> &code, AIOpcode_t opcode )
+{
+	AIInstruction_t i;
+
+	memset( &i, 0, sizeof( i ) );
+	i.opcode = opcode;
+	code.push_back( i );
+}
+
+// returns true if the code from start on only pushes a constant
+static bool isConstantCode( const std::vector<AIInstruction_t> &code, size_t start, double *value )
+{
+	if ( code.size() != start + 1 || code[ start ].opcode != CODE_CONST )
+	{
+		return false;
+	}
+
+	*value = code[ start ].arg.value;
+	return true;
+}
+
+static double foldComparison( AIOpType_t op, double a, double b )
+{
+	switch ( op )
+	{
+		case OP_LESSTHAN:         return a < b;
+		case OP_LESSTHANEQUAL:    return a <= b;
+		case OP_GREATERTHAN:      return a > b;
+		case OP_GREATERTHANEQUAL: return a >= b;
+		case OP_EQUAL:            return a == b;
+		case OP_NEQUAL:           return a != b;
+		default:                  return 0.0;
+	}
+}
+
+static AIOpcode_t comparisonOpcode( AIOpType_t op )
+{
+	switch ( op )
+	{
+		case OP_LESSTHAN:         return CODE_LESSTHAN;
+		case OP_LESSTHANEQUAL:    return CODE_LESSTHANEQUAL;
+		case OP_GREATERTHAN:      return CODE_GREATERTHAN;
+		case OP_GREATERTHANEQUAL: return CODE_GREATERTHANEQUAL;
+		case OP_EQUAL:            return CODE_EQUAL;
+		default:                  return CODE_NEQUAL;
+	}
+}
+
+// appends the code for exp, depth is the size of the stack before it runs
+static void compileExpression( std::vector<AIInstruction_t> &code, AIExpType_t *exp, int depth, int *maxDepth )
+{
+	size_t start = code.size();
+	double value, value2;
+
+	*maxDepth = std::max( *maxDepth, depth + 1 );
+
+	if ( *exp == EX_VALUE )
+	{
+		emitConst( code, AIUnBoxDouble( *( AIValue_t * ) exp ) );
+	}
+	else if ( *exp == EX_FUNC )
+	{
+		AIValueFunc_t   *v = ( AIValueFunc_t * ) exp;
+		AIInstruction_t i;
+
+		memset( &i, 0, sizeof( i ) );
+		i.opcode = CODE_FUNC;
+		i.nparams = v->nparams;
+		i.arg.f.func = v->func;
+		i.arg.f.params = v->params;
+		code.push_back( i );
+	}
+	else if ( isUnaryOp( ( ( AIOp_t * ) exp )->opType ) )
+	{
+		AIUnaryOp_t *u = ( AIUnaryOp_t * ) exp;
+
+		compileExpression( code, u->exp, depth, maxDepth );
+
+		if ( isConstantCode( code, start, &value ) )
+		{
+			code[ start ].arg.value = value == 0.0;
+		}
+		else
+		{
+			emitOp( code, CODE_NOT );
+		}
+	}
+	else
+	{
+		AIBinaryOp_t *b = ( AIBinaryOp_t * ) exp;
+
+		compileExpression( code, b->exp1, depth, maxDepth );
+
+		if ( b->opType == OP_AND || b->opType == OP_OR )
+		{
+			bool isAnd = b->opType == OP_AND;
+
+			if ( isConstantCode( code, start, &value ) )
+			{
+				// the left operand decides whether the right one is needed
+				if ( ( value == 0.0 ) == isAnd )
+				{
+					code[ start ].arg.value = !isAnd;
+					return;
+				}
+
+				code.pop_back();
+				compileExpression( code, b->exp2, depth, maxDepth );
+
+				if ( isConstantCode( code, start, &value ) )
+				{
+					code[ start ].arg.value = value != 0.0;
+				}
+				else
+				{
+					emitOp( code, CODE_BOOL );
+				}
+			}
+			else
+			{
+				size_t jump = code.size();
+
+				emitOp( code, isAnd ? CODE_JUMP_IF_FALSE : CODE_JUMP_IF_TRUE );
+				compileExpression( code, b->exp2, depth, maxDepth );
+				emitOp( code, CODE_BOOL );
+				code[ jump ].arg.target = code.size();
+			}
+		}
+		else
+		{
+			size_t start2 = code.size();
+			bool   constant = isConstantCode( code, start, &value );
+
+			compileExpression( code, b->exp2, depth + 1, maxDepth );
+
+			if ( constant && isConstantCode( code, start2, &value2 ) )
+			{
+				code.resize( start + 1 );
+				code[ start ].arg.value = foldComparison( b->opType, value, value2 );
+			}
+			else
+			{
+				emitOp( code, comparisonOpcode( b->opType ) );
+			}
+		}
+	}
+}
+
+/*
+======================
+CompileConditionExpression
+
+Turns an expression tree into code for AIEvalCondition, with constant
+sub-expressions folded. The code shares the function parameters of the
+tree, both live in the arena of the behavior tree being read
+======================
+*/
+static bool CompileConditionExpression( AIExpType_t *exp, AIConditionCode_t *condition, int line )
+{
+	std::vector<AIInstruction_t> code;
+	int maxDepth = 0;
+
+	compileExpression( code, exp, 0, &maxDepth );
+
+	condition->code = ( AIInstruction_t * ) AIArenaAlloc( currentArena, sizeof( *condition->code ) * code.size() );
+	condition->numInstructions = code.size();
+	memcpy( condition->code, code.data(), sizeof( *condition->code ) * code.size() );
+
+	if ( maxDepth > MAX_CONDITION_STACK )
+	{
+		Log::Warn( "condition expression on line %d is too complex", line );
+		return false;
+	}
+
+	return true;
+}
+
 static void BotInitNode( AINode_t type, AINodeRunner func, void *node )
 {
 	AIGenericNode_t *n = ( AIGenericNode_t * ) node;
@@ -746,6 +1153,7 @@ AIGenericNode_t *ReadConditionNode( pc_token_list **tokenlist )
 	pc_token_list *current = *tokenlist;
 
 	AIConditionNode_t *condition;
+	AIExpType_t       *exp;
 
 	if ( !expectToken( "condition", &current, true ) )
 	{
@@ -755,20 +1163,24 @@ AIGenericNode_t *ReadConditionNode( pc_token_list **tokenlist )
 	condition = allocNode( AIConditionNode_t );
 	BotInitNode( CONDITION_NODE, BotConditionNode, condition );
 
-	condition->exp = ReadConditionExpression( &current, OP_NONE );
+	exp = ReadConditionExpression( &current, OP_NONE );
 
 	if ( !current )
 	{
 		*tokenlist = current;
 		Log::Warn( "Unexpected end of file" );
-		FreeConditionNode( condition );
 		return nullptr;
 	}
 
-	if ( !condition->exp )
+	if ( !exp )
+	{
+		*tokenlist = current;
+		return nullptr;
+	}
+
+	if ( !CompileConditionExpression( exp, &condition->condition, ( *tokenlist )->token.line ) )
 	{
 		*tokenlist = current;
-		FreeConditionNode( condition );
 		return nullptr;
 	}
 
@@ -787,14 +1199,12 @@ AIGenericNode_t *ReadConditionNode( pc_token_list **tokenlist )
 	{
 		Log::Warn( "Failed to parse child node of condition on line %d", (*tokenlist)->token.line );
 		*tokenlist = current;
-		FreeConditionNode( condition );
 		return nullptr;
 	}
 
 	if ( !expectToken( "}", &current, true ) )
 	{
 		*tokenlist = current;
-		FreeConditionNode( condition );
 		return nullptr;
 	}
 
@@ -1078,8 +1488,6 @@ AIGenericNode_t *ReadNodeList( pc_token_list **tokenlist )
 		if ( node && list->numNodes >= MAX_NODE_LIST )
 		{
 			Log::Warn( "Max selector children limit exceeded at line %d", (*tokenlist)->token.line );
-			FreeNode( node );
-			FreeNodeList( list );
 			*tokenlist = current;
 			return nullptr;
 		}
@@ -1092,7 +1500,6 @@ AIGenericNode_t *ReadNodeList( pc_token_list **tokenlist )
 		if ( !node )
 		{
 			*tokenlist = current;
-			FreeNodeList( list );
 			return nullptr;
 		}
 
@@ -1216,6 +1623,8 @@ AIBehaviorTree_t *ReadBehaviorTree( const char *name, AITreeList_t *list )
 	char treefilename[ MAX_QPATH ];
 	int handle;
 	pc_token_list *tokenlist;
+	AIArena_t tokenArena;
+	AIArena_t *prevArena;
 	AIBehaviorTree_t *tree;
 	pc_token_list *current;
 	AIGenericNode_t *node;
@@ -1324,11 +1733,16 @@ AIBehaviorTree_t *ReadBehaviorTree( const char *name, AITreeList_t *list )
 		return nullptr;
 	}
 
-	tokenlist = CreateTokenList( handle );
+	tokenArena.blocks = nullptr;
+	tokenlist = CreateTokenList( handle, &tokenArena );
 	trap_Parse_FreeSource( handle );
 
 	tree = ( AIBehaviorTree_t * ) BG_Alloc( sizeof( AIBehaviorTree_t ) );
 
+	// included trees are read recursively into their own arena
+	prevArena = currentArena;
+	currentArena = &tree->arena;
+
 	Q_strncpyz( tree->name, name, sizeof( tree->name ) );
 
 	tree->run = BotBehaviorNode;
@@ -1339,6 +1753,8 @@ AIBehaviorTree_t *ReadBehaviorTree( const char *name, AITreeList_t *list )
 	current = tokenlist;
 
 	node = ReadNode( &current );
+	currentArena = prevArena;
+
 	if ( node )
 	{
 		tree->root = node;
@@ -1349,11 +1765,18 @@ AIBehaviorTree_t *ReadBehaviorTree( const char *name, AITreeList_t *list )
 		tree = nullptr;
 	}
 
-	FreeTokenList( tokenlist );
+	AIArenaFree( &tokenArena );
 	return tree;
 }
 
-pc_token_list *CreateTokenList( int handle )
+/*
+======================
+CreateTokenList
+
+Reads all the tokens of a source into a list allocated from the given arena
+======================
+*/
+pc_token_list *CreateTokenList( int handle, AIArena_t *arena )
 {
 	pc_token_t token;
 	char filename[ MAX_QPATH ];
@@ -1362,7 +1785,7 @@ pc_token_list *CreateTokenList( int handle )
 
 	while ( trap_Parse_ReadToken( handle, &token ) )
 	{
-		pc_token_list *list = ( pc_token_list * ) BG_Alloc( sizeof( pc_token_list ) );
+		pc_token_list *list = ( pc_token_list * ) AIArenaAlloc( arena, sizeof( pc_token_list ) );
 		
 		if ( current )
 		{
@@ -1382,26 +1805,13 @@ pc_token_list *CreateTokenList( int handle )
 		current->token.intvalue = token.intvalue;
 		current->token.subtype = token.subtype;
 		current->token.type = token.type;
-		current->token.string = BG_strdup( token.string );
+		current->token.string = AIArenaStrdup( arena, token.string );
 		trap_Parse_SourceFileAndLine( handle, filename, &current->token.line );
 	}
 
 	return root;
 }
 
-void FreeTokenList( pc_token_list *list )
-{
-	pc_token_list *current = list;
-	while( current )
-	{
-		pc_token_list *node = current;
-		current = current->next;
-
-		BG_Free( node->token.string );
-		BG_Free( node );
-	}
-}
-
 // functions for keeping a list of behavior trees loaded
 void InitTreeList( AITreeList_t *list )
 {
@@ -1414,8 +1824,8 @@ void AddTreeToList( AITreeList_t *list, AIBehaviorTree_t *tree )
 {
 	if ( list->maxTrees == list->numTrees )
 	{
-		AIBehaviorTree_t **trees = ( AIBehaviorTree_t ** ) BG_Alloc( sizeof( AIBehaviorTree_t * ) * list->maxTrees );
 		list->maxTrees *= 2;
+		AIBehaviorTree_t **trees = ( AIBehaviorTree_t ** ) BG_Alloc( sizeof( AIBehaviorTree_t * ) * list->maxTrees );
 		memcpy( trees, list->trees, sizeof( AIBehaviorTree_t * ) * list->numTrees );
 		BG_Free( list->trees );
 		list->trees = trees;
@@ -1456,150 +1866,11 @@ void FreeTreeList( AITreeList_t *list )
 	list->numTrees = 0;
 }
 
-// functions for freeing the memory of condition expressions
-void FreeValue( AIValue_t *v )
-{
-	if ( !v )
-	{
-		return;
-	}
-	AIDestroyValue( *v );
-	BG_Free( v );
-}
-
-void FreeValueFunc( AIValueFunc_t *v )
-{
-	int i;
-	if ( !v )
-	{
-		return;
-	}
-
-	for ( i = 0; i < v->nparams; i++ )
-	{
-		AIDestroyValue( v->params[ i ] );
-	}
-
-	BG_Free( v->params );
-	BG_Free( v );
-}
-
-void FreeExpression( AIExpType_t *exp )
-{
-	if ( !exp )
-	{
-		return;
-	}
-
-	if ( *exp == EX_FUNC )
-	{
-		AIValueFunc_t *v = ( AIValueFunc_t * ) exp;
-		FreeValueFunc( v );
-	}
-	else if ( *exp == EX_VALUE )
-	{
-		AIValue_t *v = ( AIValue_t * ) exp;
-		
-		FreeValue( v );
-	}
-	else if ( *exp == EX_OP )
-	{
-		AIOp_t *op = ( AIOp_t * ) exp;
-
-		FreeOp( op );
-	}
-}
-void FreeOp( AIOp_t *op )
-{
-	if ( !op )
-	{
-		return;
-	}
-
-	if ( isBinaryOp( op->opType ) )
-	{
-		AIBinaryOp_t *b = ( AIBinaryOp_t * ) op;
-		FreeExpression( b->exp1 );
-		FreeExpression( b->exp2 );
-	}
-	else if ( isUnaryOp( op->opType ) )
-	{
-		AIUnaryOp_t *u = ( AIUnaryOp_t * ) op;
-		FreeExpression( u->exp );
-	}
-
-	BG_Free( op );
-}
-
-// freeing behavior tree nodes
-void FreeConditionNode( AIConditionNode_t *node )
-{
-	FreeNode( node->child );
-	FreeExpression( node->exp );
-	BG_Free( node );
-}
-
-void FreeNodeList( AINodeList_t *node )
-{
-	int i;
-	for ( i = 0; i < node->numNodes; i++ )
-	{
-		FreeNode( node->list[ i ] );
-	}
-	BG_Free( node );
-}
-
-void FreeActionNode( AIActionNode_t *action )
-{
-	int i;
-	for ( i = 0; i < action->nparams; i++ )
-	{
-		AIDestroyValue( action->params[ i ] );
-	}
-
-	BG_Free( action->params );
-	BG_Free( action );
-}
-
-void FreeDecoratorNode( AIDecoratorNode_t *decorator )
-{
-	BG_Free( decorator->params );
-	FreeNode( decorator->child );
-	BG_Free( decorator );
-}
-
-void FreeNode( AIGenericNode_t *node )
-{
-	if ( !node )
-	{
-		return;
-	}
-
-	switch( node->type )
-	{
-		case SELECTOR_NODE:
-			FreeNodeList( ( AINodeList_t * ) node );
-			break;
-		case CONDITION_NODE:
-			FreeConditionNode( ( AIConditionNode_t * ) node );
-			break;
-		case ACTION_NODE:
-			FreeActionNode( ( AIActionNode_t * ) node );
-			break;
-		case DECORATOR_NODE:
-			FreeDecoratorNode( ( AIDecoratorNode_t * ) node );
-			break;
-		default:
-			break;
-	}
-}
-
 void FreeBehaviorTree( AIBehaviorTree_t *tree )
 {
 	if ( tree )
 	{
-		FreeNode(tree->root);
-
+		AIArenaFree( &tree->arena );
 		BG_Free( tree );
 	}
 	else
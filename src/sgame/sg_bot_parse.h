@@ -24,7 +24,6 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "sg_bot_ai.h"
 
-#define allocNode(T) ( T * ) BG_Alloc( sizeof( T ) );
 #define stringify2(T, val) va( #T " %d", val )
 #define D2(T, val) trap_Parse_AddGlobalDefine( stringify2( T, val ) )
 #define D(T) D2(T, T)
@@ -70,8 +69,11 @@ void              AddTreeToList( AITreeList_t *list, AIBehaviorTree_t *tree );
 void              RemoveTreeFromList( AITreeList_t *list, AIBehaviorTree_t *tree );
 void              FreeTreeList( AITreeList_t *list );
 
-pc_token_list *CreateTokenList( int handle );
-void           FreeTokenList( pc_token_list *list );
+void          *AIArenaAlloc( AIArena_t *arena, size_t size );
+char          *AIArenaStrdup( AIArena_t *arena, const char *s );
+void           AIArenaFree( AIArena_t *arena );
+
+pc_token_list *CreateTokenList( int handle, AIArena_t *arena );
 
 AIGenericNode_t  *ReadNode( pc_token_list **tokenlist );
 AIGenericNode_t  *ReadConditionNode( pc_token_list **tokenlist );
@@ -80,13 +82,5 @@ AIGenericNode_t  *ReadNodeList( pc_token_list **tokenlist );
 AIBehaviorTree_t *ReadBehaviorTree( const char *name, AITreeList_t *list );
 
 void FreeBehaviorTree( AIBehaviorTree_t *tree );
-void FreeActionNode( AIActionNode_t *action );
-void FreeConditionNode( AIConditionNode_t *node );
-void FreeNodeList( AINodeList_t *node );
-void FreeNode( AIGenericNode_t *node );
-void FreeOp( AIOp_t *op );
-void FreeExpression( AIExpType_t *exp );
-void FreeValueFunc( AIValueFunc_t *v );
-void FreeValue( AIValue_t *v );
 
 #endif
@@ -23,6 +23,8 @@
 #include "sg_bot_util.h"
 #include "CBSE.h"
 
+#include <vector>
+
 /*
  = *======================
  Scoring functions for logic
@@ -422,6 +424,93 @@ void BotGetDesiredBuy( gentity_t *self, weapon_t *weapon, upgrade_t *upgrades, i
 		}
 	}
 }
+/*
+ = *======================
+ Shared perception
+
+ Entity lists that don't depend on the bot looking at them are built once per
+ frame for all bots: usable buildings of each type, damaged buildings and possible
+ enemies of each team, in entity order. Bots still check every candidate again
+ since it could have died since the lists were built.
+ =======================
+ */
+static struct
+{
+	int                     framenum;
+	std::vector<gentity_t*> buildings[ BA_NUM_BUILDABLES ];
+	std::vector<gentity_t*> damaged[ NUM_TEAMS ];
+	std::vector<gentity_t*> enemies[ NUM_TEAMS ]; // enemies of the team, whatever bot looks at them
+} perception = { -1 };
+
+static bool BotBuildingIsUsable( gentity_t *ent )
+{
+	return ent->inuse && ent->s.eType == entityType_t::ET_BUILDABLE && !G_Dead( ent ) &&
+	       !( ent->buildableTeam == TEAM_HUMANS && ( !ent->powered || !ent->spawned ) );
+}
+
+static void BotUpdatePerception()
+{
+	if ( perception.framenum == level.framenum )
+	{
+		return;
+	}
+
+	perception.framenum = level.framenum;
+
+	for ( auto &list : perception.buildings )
+	{
+		list.clear();
+	}
+
+	for ( int team = 0; team < NUM_TEAMS; team++ )
+	{
+		perception.damaged[ team ].clear();
+		perception.enemies[ team ].clear();
+	}
+
+	for ( gentity_t *ent = g_entities; ent < &g_entities[ level.num_entities ]; ent++ )
+	{
+		team_t team;
+
+		if ( !ent->inuse )
+		{
+			continue;
+		}
+
+		if ( ent->s.eType == entityType_t::ET_BUILDABLE && BotBuildingIsUsable( ent ) )
+		{
+			perception.buildings[ ent->s.modelindex ].push_back( ent );
+
+			if ( !ent->entity->Get<HealthComponent>()->FullHealth() && ent->spawned && ent->powered &&
+			     ent->buildableTeam > TEAM_NONE && ent->buildableTeam < NUM_TEAMS )
+			{
+				perception.damaged[ ent->buildableTeam ].push_back( ent );
+			}
+		}
+
+		// see BotEnemyIsValid for the checks that depend on the bot
+		team = BotGetEntityTeam( ent );
+
+		if ( team <= TEAM_NONE || team >= NUM_TEAMS || !G_Alive( ent ) )
+		{
+			continue;
+		}
+
+		if ( ent->client && ent->client->sess.spectatorState != SPECTATOR_NOT )
+		{
+			continue;
+		}
+
+		for ( int other = TEAM_NONE + 1; other < NUM_TEAMS; other++ )
+		{
+			if ( other != team )
+			{
+				perception.enemies[ other ].push_back( ent );
+			}
+		}
+	}
+}
+
 /*
  = *======================
  Entity Querys
@@ -433,10 +522,15 @@ gentity_t* BotFindBuilding( gentity_t *self, int buildingType, int range )
 	gentity_t* closestBuilding = nullptr;
 	float newDistance;
 	float rangeSquared = Square( range );
-	gentity_t *target = &g_entities[MAX_CLIENTS];
-	int i;
 
-	for ( i = MAX_CLIENTS; i < level.num_entities; i++, target++ )
+	if ( buildingType <= BA_NONE || buildingType >= BA_NUM_BUILDABLES )
+	{
+		return nullptr;
+	}
+
+	BotUpdatePerception();
+
+	for ( gentity_t *target : perception.buildings[ buildingType ] )
 	{
 		if ( !target->inuse )
 		{
@@ -463,51 +557,34 @@ gentity_t* BotFindBuilding( gentity_t *self, int buildingType, int range )
 
 void BotFindClosestBuildings( gentity_t *self )
 {
-	gentity_t *testEnt;
 	botEntityAndDistance_t *ent;
 
-	// clear out building list
-	for ( unsigned i = 0; i < ARRAY_LEN( self->botMind->closestBuildings ); i++ )
-	{
-		self->botMind->closestBuildings[ i ].ent = nullptr;
-		self->botMind->closestBuildings[ i ].distance = INT_MAX;
-	}
+	BotUpdatePerception();
 
-	for ( testEnt = &g_entities[MAX_CLIENTS]; testEnt < &g_entities[level.num_entities - 1]; testEnt++ )
+	for ( unsigned i = 0; i < ARRAY_LEN( self->botMind->closestBuildings ); i++ )
 	{
-		float newDist;
-		//ignore entities that arnt in use
-		if ( !testEnt->inuse )
-		{
-			continue;
-		}
+		ent = &self->botMind->closestBuildings[ i ];
+		ent->ent = nullptr;
+		ent->distance = INT_MAX;
 
-		//skip non buildings
-		if ( testEnt->s.eType != entityType_t::ET_BUILDABLE )
+		for ( gentity_t *testEnt : perception.buildings[ i ] )
 		{
-			continue;
-		}
+			float newDist;
 
-		//ignore dead targets
-		if ( G_Dead( testEnt ) )
-		{
-			continue;
-		}
-
-		//skip human buildings that are currently building or arn't powered
-		if ( testEnt->buildableTeam == TEAM_HUMANS && ( !testEnt->powered || !testEnt->spawned ) )
-		{
-			continue;
-		}
-
-		newDist = Distance( self->s.origin, testEnt->s.origin );
+			//skip buildings that died or lost power since the list was built,
+			//and slots that were freed and reused as another buildable
+			if ( !BotBuildingIsUsable( testEnt ) || testEnt->s.modelindex != (int) i )
+			{
+				continue;
+			}
 
-		ent = &self->botMind->closestBuildings[ testEnt->s.modelindex ];
+			newDist = Distance( self->s.origin, testEnt->s.origin );
 
-		if ( newDist < ent->distance )
-		{
-			ent->ent = testEnt;
-			ent->distance = newDist;
+			if ( newDist < ent->distance )
+			{
+				ent->ent = testEnt;
+				ent->distance = newDist;
+			}
 		}
 	}
 }
@@ -516,13 +593,20 @@ void BotFindDamagedFriendlyStructure( gentity_t *self )
 {
 	float minDistSqr;
 
-	gentity_t *target;
+	team_t team = self->client->pers.team;
 	self->botMind->closestDamagedBuilding.ent = nullptr;
 	self->botMind->closestDamagedBuilding.distance = INT_MAX;
 
 	minDistSqr = Square( self->botMind->closestDamagedBuilding.distance );
 
-	for ( target = &g_entities[MAX_CLIENTS]; target < &g_entities[level.num_entities - 1]; target++ )
+	if ( team <= TEAM_NONE || team >= NUM_TEAMS )
+	{
+		return;
+	}
+
+	BotUpdatePerception();
+
+	for ( gentity_t *target : perception.damaged[ team ] )
 	{
 		float distSqr;
 
@@ -566,6 +650,73 @@ void BotFindDamagedFriendlyStructure( gentity_t *self )
 	}
 }
 
+/*
+======================
+BotRefreshPerception
+
+Cheap update of what BotSearchForEnemy, BotFindClosestBuildings and
+BotFindDamagedFriendlyStructure found last time, for the frames in which
+they don't run: drops entities that aren't valid anymore and updates the
+distances, without looking for new ones
+======================
+*/
+void BotRefreshPerception( gentity_t *self )
+{
+	botMemory_t *mind = self->botMind;
+
+	if ( mind->bestEnemy.ent )
+	{
+		if ( BotEnemyIsValid( self, mind->bestEnemy.ent ) )
+		{
+			mind->bestEnemy.distance = Distance( self->s.origin, mind->bestEnemy.ent->s.origin );
+		}
+		else
+		{
+			mind->bestEnemy.ent = nullptr;
+			mind->bestEnemy.distance = INT_MAX;
+		}
+	}
+
+	for ( unsigned i = 0; i < ARRAY_LEN( mind->closestBuildings ); i++ )
+	{
+		botEntityAndDistance_t *ent = &mind->closestBuildings[ i ];
+
+		if ( !ent->ent )
+		{
+			continue;
+		}
+
+		// the entity could have been freed and reused since
+		if ( !ent->ent->inuse || ent->ent->s.eType != entityType_t::ET_BUILDABLE ||
+		     ent->ent->s.modelindex != ( int ) i || G_Dead( ent->ent ) ||
+		     ( ent->ent->buildableTeam == TEAM_HUMANS && ( !ent->ent->powered || !ent->ent->spawned ) ) )
+		{
+			ent->ent = nullptr;
+			ent->distance = INT_MAX;
+			continue;
+		}
+
+		ent->distance = Distance( self->s.origin, ent->ent->s.origin );
+	}
+
+	if ( mind->closestDamagedBuilding.ent )
+	{
+		gentity_t *target = mind->closestDamagedBuilding.ent;
+
+		if ( !target->inuse || target->s.eType != entityType_t::ET_BUILDABLE ||
+		     target->buildableTeam != self->client->pers.team || G_Dead( target ) ||
+		     target->entity->Get<HealthComponent>()->FullHealth() || !target->spawned || !target->powered )
+		{
+			mind->closestDamagedBuilding.ent = nullptr;
+			mind->closestDamagedBuilding.distance = INT_MAX;
+		}
+		else
+		{
+			mind->closestDamagedBuilding.distance = Distance( self->s.origin, target->s.origin );
+		}
+	}
+}
+
 bool BotEntityIsVisible( gentity_t *self, gentity_t *target, int mask )
 {
 	botTarget_t bt;
@@ -579,12 +730,18 @@ gentity_t* BotFindBestEnemy( gentity_t *self )
 	float bestInvisibleEnemyScore = 0;
 	gentity_t *bestVisibleEnemy = nullptr;
 	gentity_t *bestInvisibleEnemy = nullptr;
-	gentity_t *target;
 	team_t    team = BotGetEntityTeam( self );
 	bool  hasRadar = ( team == TEAM_ALIENS ) ||
 	                     ( team == TEAM_HUMANS && BG_InventoryContainsUpgrade( UP_RADAR, self->client->ps.stats ) );
 
-	for ( target = g_entities; target < &g_entities[level.num_entities - 1]; target++ )
+	if ( self->client->pers.team <= TEAM_NONE || self->client->pers.team >= NUM_TEAMS )
+	{
+		return nullptr;
+	}
+
+	BotUpdatePerception();
+
+	for ( gentity_t *target : perception.enemies[ self->client->pers.team ] )
 	{
 		float newScore;
 
@@ -635,18 +792,18 @@ gentity_t* BotFindBestEnemy( gentity_t *self )
 
 gentity_t* BotFindClosestEnemy( gentity_t *self )
 {
-	gentity_t* closestEnemy = nullptr;
-	float minDistance = Square( ALIENSENSE_RANGE );
 	gentity_t *target;
+	int entityList[ MAX_GENTITIES ];
+	int numEntities;
+
+	// closest first, so the first one that qualifies is the answer
+	numEntities = G_SpatialNearestEntities( self->s.origin, ALIENSENSE_RANGE, entityList, MAX_GENTITIES,
+	                                        G_Enemy( BotGetEntityTeam( self ) ),
+	                                        ETYPE_MASK( entityType_t::ET_PLAYER ) | ETYPE_MASK( entityType_t::ET_BUILDABLE ) );
 
-	for ( target = g_entities; target < &g_entities[level.num_entities - 1]; target++ )
+	for ( int i = 0; i < numEntities; i++ )
 	{
-		float newDistance;
-		//ignore entities that arnt in use
-		if ( !target->inuse )
-		{
-			continue;
-		}
+		target = &g_entities[ entityList[ i ] ];
 
 		// Only consider living targets.
 		if ( !G_Alive( target ) )
@@ -689,14 +846,10 @@ gentity_t* BotFindClosestEnemy( gentity_t *self )
 				continue;
 			}
 		}
-		newDistance = DistanceSquared( self->s.origin, target->s.origin );
-		if ( newDistance <= minDistance )
-		{
-			minDistance = newDistance;
-			closestEnemy = target;
-		}
+
+		return target;
 	}
-	return closestEnemy;
+	return nullptr;
 }
 
 botTarget_t BotGetRushTarget( gentity_t *self )
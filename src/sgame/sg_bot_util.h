@@ -38,6 +38,7 @@ void       BotFindClosestBuildings( gentity_t *self );
 gentity_t* BotFindBuilding( gentity_t *self, int buildingType, int range );
 bool   BotTeamateHasWeapon( gentity_t *self, int weapon );
 void       BotSearchForEnemy( gentity_t *self );
+void       BotRefreshPerception( gentity_t *self );
 void       BotPain( gentity_t *self, gentity_t *attacker, int damage );
 
 // aiming
@@ -24,6 +24,8 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "sg_local.h"
 #include "CBSE.h"
 
+#include <set>
+
 /*
 ================
 G_WarnPrimaryUnderAttack
@@ -466,12 +468,13 @@ attempt to find creep for self, return true if successful
 */
 bool G_FindCreep( gentity_t *self )
 {
-	int       i;
+	int       i, num;
 	gentity_t *ent;
 	gentity_t *closestSpawn = nullptr;
 	int       distance = 0;
 	int       minDistance = 10000;
-	vec3_t    temp_v;
+	vec3_t    temp_v, mins, maxs;
+	int       entityList[ MAX_GENTITIES ];
 
 	//don't check for creep if flying through the air
 	if ( !self->client && self->s.groundEntityNum == ENTITYNUM_NONE )
@@ -482,12 +485,19 @@ bool G_FindCreep( gentity_t *self )
 	//if self does not have a parentNode or its parentNode is invalid find a new one
 	if ( self->client || !self->powerSource || !self->powerSource->inuse || G_Dead( self->powerSource ) )
 	{
-		for ( i = MAX_CLIENTS, ent = g_entities + i; i < level.num_entities; i++, ent++ )
+		// anything further away than CREEP_BASESIZE can't provide creep
+		for ( i = 0; i < 3; i++ )
 		{
-			if ( ent->s.eType != entityType_t::ET_BUILDABLE )
-			{
-				continue;
-			}
+			mins[ i ] = self->s.origin[ i ] - ( CREEP_BASESIZE + 1 );
+			maxs[ i ] = self->s.origin[ i ] + ( CREEP_BASESIZE + 1 );
+		}
+
+		num = G_SpatialEntitiesInBox( mins, maxs, entityList, MAX_GENTITIES, TEAM_ALIENS,
+		                              ETYPE_MASK( entityType_t::ET_BUILDABLE ) );
+
+		for ( i = 0; i < num; i++ )
+		{
+			ent = &g_entities[ entityList[ i ] ];
 
 			if ( ( ent->s.modelindex == BA_A_SPAWN || ent->s.modelindex == BA_A_OVERMIND ) &&
 			     G_Alive( ent ) )
@@ -1184,9 +1194,14 @@ static bool AHive_FindTarget( gentity_t *self )
 	}
 
 	// search best target
-	gentity_t *ent = nullptr;
-	while ( ( ent = G_IterateEntitiesWithinRadius( ent, self->s.origin, HIVE_SENSE_RANGE ) ) )
+	int entityList[ MAX_GENTITIES ];
+	int num = G_SpatialEntitiesInRadius( self->s.origin, HIVE_SENSE_RANGE, entityList, MAX_GENTITIES,
+	                                     TEAM_HUMANS, ETYPE_MASK( entityType_t::ET_PLAYER ) );
+
+	for ( int i = 0; i < num; i++ )
 	{
+		gentity_t *ent = &g_entities[ entityList[ i ] ];
+
 		if ( AHive_TargetValid( self, ent, false ) && AHive_isBetterTarget( self, ent ) )
 		{
 			// change target if I find a valid target that's better than the old one
@@ -1471,15 +1486,32 @@ Used by ATrapper_Think to locate enemy gentities
 void ATrapper_FindEnemy( gentity_t *ent, int range )
 {
 	gentity_t *target;
-	int       i;
+	int       i, num;
 	int       start;
+	int       entityList[ MAX_CLIENTS ];
+	vec3_t    mins, maxs;
+
+	for ( i = 0; i < 3; i++ )
+	{
+		mins[ i ] = ent->r.currentOrigin[ i ] - range;
+		maxs[ i ] = ent->r.currentOrigin[ i ] + range;
+	}
 
-	// iterate through entities
-	start = rand() / ( RAND_MAX / MAX_CLIENTS + 1 );
+	num = G_SpatialEntitiesInBox( mins, maxs, entityList, MAX_CLIENTS, TEAM_HUMANS,
+	                              ETYPE_MASK( entityType_t::ET_PLAYER ) );
 
-	for ( i = start; i < MAX_CLIENTS + start; i++ )
+	if ( !num )
 	{
-		target = g_entities + ( i % MAX_CLIENTS );
+		ent->target = nullptr;
+		return;
+	}
+
+	// iterate through players in range
+	start = rand() / ( RAND_MAX / num + 1 );
+
+	for ( i = start; i < num + start; i++ )
+	{
+		target = g_entities + entityList[ i % num ];
 
 		//if target is not valid keep searching
 		if ( !ATrapper_CheckTarget( ent, target, range ) )
@@ -1753,6 +1785,167 @@ static float OutgoingInterference( buildable_t buildable, gentity_t *neighbor, f
 	return power * std::max( 0.0f, 1.0f - ( distance / range ) );
 }
 
+/*
+=================================================================================
+
+human power grid
+
+For every human buildable, the grid keeps the human buildables that are within
+PowerRelevantRange of it, sorted by entity number so that spare power is summed up in the
+same order as a G_IterateEntitiesWithinRadius scan would, and the reverse edges. It is
+reconciled with the entity list before every power calculation, so that only buildables
+that were built, removed or moved cause neighbor lists to be updated.
+
+=================================================================================
+*/
+
+typedef struct
+{
+	bool             present;
+	vec3_t           origin;    // s.origin, used when looking for neighbors
+	vec3_t           currentOrigin, mins, maxs; // used when being looked for
+	std::vector<int> neighbors; // buildables that can interfere with this one
+	std::vector<int> dependents; // buildables that this one can interfere with
+} powerNode_t;
+
+static powerNode_t      powerNodes[ MAX_GENTITIES ];
+static std::vector<int> powerNodeList;
+static int              powerGridRange;
+
+static inline bool IsHumanBuildable( const gentity_t *ent )
+{
+	return ent->s.eType == entityType_t::ET_BUILDABLE && ent->buildableTeam == TEAM_HUMANS;
+}
+
+/*
+=================
+PowerGridInRange
+
+Same test as G_IterateEntitiesWithinRadius.
+=================
+*/
+static bool PowerGridInRange( const powerNode_t *self, const powerNode_t *neighbor )
+{
+	vec3_t eorg;
+
+	for ( int j = 0; j < 3; j++ )
+	{
+		eorg[ j ] = self->origin[ j ] - ( neighbor->currentOrigin[ j ] + ( neighbor->mins[ j ] + neighbor->maxs[ j ] ) * 0.5 );
+	}
+
+	return VectorLength( eorg ) <= powerGridRange;
+}
+
+static void PowerGridUnlink( int num )
+{
+	powerNode_t *node = &powerNodes[ num ];
+
+	for ( int dependent : node->dependents )
+	{
+		std::vector<int> &list = powerNodes[ dependent ].neighbors;
+		list.erase( std::lower_bound( list.begin(), list.end(), num ) );
+	}
+
+	for ( int neighbor : node->neighbors )
+	{
+		std::vector<int> &list = powerNodes[ neighbor ].dependents;
+		list.erase( std::find( list.begin(), list.end(), num ) );
+	}
+
+	node->neighbors.clear();
+	node->dependents.clear();
+}
+
+static void PowerGridAddEdge( int from, int to )
+{
+	std::vector<int> &list = powerNodes[ from ].neighbors;
+
+	list.insert( std::lower_bound( list.begin(), list.end(), to ), to );
+	powerNodes[ to ].dependents.push_back( from );
+}
+
+/*
+=================
+PowerGridUpdate
+
+Brings the power grid in sync with the human buildables in the world.
+=================
+*/
+static void PowerGridUpdate()
+{
+	std::vector<int> members, changed;
+	bool             rebuild = ( powerGridRange != PowerRelevantRange() );
+	gentity_t        *ent = nullptr;
+
+	powerGridRange = PowerRelevantRange();
+
+	while ( ( ent = G_IterateEntities( ent, nullptr, false, 0, nullptr ) ) )
+	{
+		if ( IsHumanBuildable( ent ) )
+		{
+			members.push_back( ent->s.number );
+		}
+	}
+
+	// remove buildables that are gone
+	for ( int num : powerNodeList )
+	{
+		if ( !std::binary_search( members.begin(), members.end(), num ) )
+		{
+			PowerGridUnlink( num );
+			powerNodes[ num ].present = false;
+		}
+	}
+
+	// find buildables that are new or have moved
+	for ( int num : members )
+	{
+		powerNode_t *node = &powerNodes[ num ];
+
+		ent = &g_entities[ num ];
+
+		if ( rebuild || !node->present || !VectorCompare( node->origin, ent->s.origin ) ||
+		     !VectorCompare( node->currentOrigin, ent->r.currentOrigin ) ||
+		     !VectorCompare( node->mins, ent->r.mins ) || !VectorCompare( node->maxs, ent->r.maxs ) )
+		{
+			PowerGridUnlink( num );
+			node->present = true;
+			VectorCopy( ent->s.origin, node->origin );
+			VectorCopy( ent->r.currentOrigin, node->currentOrigin );
+			VectorCopy( ent->r.mins, node->mins );
+			VectorCopy( ent->r.maxs, node->maxs );
+			changed.push_back( num );
+		}
+	}
+
+	// link changed buildables with all others, pairs of changed buildables only once
+	for ( size_t i = 0; i < changed.size(); i++ )
+	{
+		int num = changed[ i ];
+
+		for ( int other : members )
+		{
+			if ( other == num ||
+			     std::binary_search( changed.begin(), changed.begin() + i, other ) )
+			{
+				continue;
+			}
+
+			if ( PowerGridInRange( &powerNodes[ num ], &powerNodes[ other ] ) )
+			{
+				PowerGridAddEdge( num, other );
+			}
+
+			if ( PowerGridInRange( &powerNodes[ other ], &powerNodes[ num ] ) )
+			{
+				PowerGridAddEdge( other, num );
+			}
+		}
+	}
+
+	powerNodeList = std::move( members );
+}
+
 /*
 =================
 CalculateSparePower
@@ -1804,14 +1997,9 @@ static void CalculateSparePower( gentity_t *self )
 		self->currentSparePower = 0;
 	}
 
-	neighbor = nullptr;
-	while ( ( neighbor = G_IterateEntitiesWithinRadius( neighbor, self->s.origin, PowerRelevantRange() ) ) )
+	for ( int num : powerNodes[ self->s.number ].neighbors )
 	{
-		if ( self == neighbor )
-		{
-			continue;
-		}
-
+		neighbor = &g_entities[ num ];
 		distance = Distance( self->s.origin, neighbor->s.origin );
 
 		self->expectedSparePower += IncomingInterference( (buildable_t) self->s.modelindex, neighbor, distance, true );
@@ -1843,94 +2031,91 @@ G_SetHumanBuildablePowerState
 Powers human buildables up and down based on available power and reactor status.
 Updates expected spare power for all human buildables.
 
-TODO: Assemble a list of relevant entities first.
+Buildables lacking power are powered down one at a time, highest deficit first. Since a
+buildable going down only changes the spare power of its dependents in the power grid,
+only those are reevaluated before the next one is picked.
 =================
 */
 void G_SetHumanBuildablePowerState()
 {
-	bool  done;
-	float     lowestSparePower;
-	gentity_t *ent = nullptr, *lowestSparePowerEnt;
-
-	static int nextCalculation = 0;
+	std::set<std::pair<float, int>> candidates;
+	static float candidateKeys[ MAX_GENTITIES ];
+	static int   nextCalculation = 0;
 
 	if ( level.time < nextCalculation )
 	{
 		return;
 	}
 
+	PowerGridUpdate();
+
 	// first pass: predict spare power for all buildables,
 	//             power up buildables that have enough power
-	while ( ( ent = G_IterateEntities( ent, nullptr, false, 0, nullptr ) ) )
+	for ( int num : powerNodeList )
+	{
+		gentity_t *ent = &g_entities[ num ];
+
+		CalculateSparePower( ent );
+
+		if ( ent->currentSparePower >= 0.0f )
+		{
+			ent->powered = true;
+		}
+	}
+
+	// second pass: update spare power for all powered buildables and queue them for shutdown
+	for ( int num : powerNodeList )
 	{
-		// discard irrelevant entities
-		if ( ent->s.eType != entityType_t::ET_BUILDABLE || ent->buildableTeam != TEAM_HUMANS )
+		gentity_t *ent = &g_entities[ num ];
+
+		// ignore buildables that haven't yet spawned, are already powered down or need no power
+		if ( !ent->spawned || !ent->powered || !BG_Buildable( ent->s.modelindex )->powerConsumption )
 		{
 			continue;
 		}
 
 		CalculateSparePower( ent );
 
-		if ( ent->currentSparePower >= 0.0f )
+		// never shut down the telenode, even if it was set to consume power and operates below
+		// its threshold
+		if ( ent->s.modelindex == BA_H_SPAWN )
 		{
-			ent->powered = true;
+			continue;
 		}
+
+		candidateKeys[ num ] = ent->currentSparePower;
+		candidates.emplace( ent->currentSparePower, num );
 	}
 
 	// power down buildables that lack power, highest deficit first
-	do
+	while ( !candidates.empty() && candidates.begin()->first < 0.0f )
 	{
-		lowestSparePowerEnt = nullptr;
-		lowestSparePower = MAX_QINT;
+		int num = candidates.begin()->second;
 
-		// find buildable with highest power deficit
-		while ( ( ent = G_IterateEntities( ent, nullptr, false, 0, nullptr ) ) )
-		{
-			// discard irrelevant entities
-			if ( ent->s.eType != entityType_t::ET_BUILDABLE || ent->buildableTeam != TEAM_HUMANS )
-			{
-				continue;
-			}
+		candidates.erase( candidates.begin() );
+		g_entities[ num ].powered = false;
 
-			// ignore buildables that haven't yet spawned or are already powered down
-			if ( !ent->spawned || !ent->powered )
-			{
-				continue;
-			}
+		for ( int dependent : powerNodes[ num ].dependents )
+		{
+			gentity_t *ent = &g_entities[ dependent ];
 
-			// ignore buildables that need no power
-			if ( !BG_Buildable( ent->s.modelindex )->powerConsumption )
+			if ( !ent->spawned || !ent->powered || !BG_Buildable( ent->s.modelindex )->powerConsumption )
 			{
 				continue;
 			}
 
 			CalculateSparePower( ent );
 
-			// never shut down the telenode, even if it was set to consume power and operates below
-			// its threshold
 			if ( ent->s.modelindex == BA_H_SPAWN )
 			{
 				continue;
 			}
 
-			if ( ent->currentSparePower < lowestSparePower )
-			{
-				lowestSparePower = ent->currentSparePower;
-				lowestSparePowerEnt = ent;
-			}
-		}
-
-		if ( lowestSparePower < 0.0f )
-		{
-			lowestSparePowerEnt->powered = false;
-			done = false;
-		}
-		else
-		{
-			done = true;
+			candidates.erase( std::make_pair( candidateKeys[ dependent ], dependent ) );
+			candidateKeys[ dependent ] = ent->currentSparePower;
+			candidates.emplace( ent->currentSparePower, dependent );
 		}
 	}
-	while ( !done );
 
 	nextCalculation = level.time + 500;
 }
@@ -2411,9 +2596,15 @@ static bool HTurret_FindTarget( gentity_t *self, float range,
 	HTurret_RemoveTarget( self );
 
 	// search best target
-	gentity_t *ent = nullptr;
-	while ( ( ent = G_IterateEntitiesWithinRadius( ent, self->s.origin, range ) ) )
+	int entityList[ MAX_GENTITIES ];
+	int num = G_SpatialEntitiesInRadius( self->s.origin, range, entityList, MAX_GENTITIES,
+	                                     G_Enemy( self->buildableTeam ),
+	                                     ETYPE_MASK( entityType_t::ET_PLAYER ) );
+
+	for ( int i = 0; i < num; i++ )
 	{
+		gentity_t *ent = &g_entities[ entityList[ i ] ];
+
 		if ( HTurret_TargetValid( self, ent, true, range ) && isBetterTarget( self, ent ) )
 		{
 			self->target = ent;
@@ -4183,7 +4374,7 @@ static gentity_t *Build( gentity_t *builder, buildable_t buildable, const vec3_t
 	// Spawn the buildable
 	built->s.eType = entityType_t::ET_BUILDABLE;
 	built->killedBy = ENTITYNUM_NONE;
-	built->classname = attr->entityName;
+	G_SetClassname( built, attr->entityName );
 	built->s.modelindex = buildable;
 	built->s.modelindex2 = attr->team;
 	built->buildableTeam = (team_t) built->s.modelindex2;
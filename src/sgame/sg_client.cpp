@@ -436,11 +436,11 @@ static void SpawnCorpse( gentity_t *ent )
 
 	if ( ent->client->pers.team == TEAM_HUMANS )
 	{
-		body->classname = "humanCorpse";
+		G_SetClassname( body, "humanCorpse" );
 	}
 	else
 	{
-		body->classname = "alienCorpse";
+		G_SetClassname( body, "alienCorpse" );
 	}
 
 	body->s.misc = MAX_CLIENTS;
@@ -1371,7 +1371,7 @@ void ClientAdminChallenge( int clientNum )
 		client->pers.pubkey_challengedAt = level.time ^ ( 5 * clientNum ); // a small amount of jitter
 
 		// copy the decrypted message because generating a new message will overwrite it
-		G_admin_writeconfig();
+		G_admin_journal_admin( admin );
 	}
 }
 
@@ -1737,7 +1737,7 @@ void ClientSpawn( gentity_t *ent, gentity_t *spawn, const vec3_t origin, const v
 
 	ent->s.groundEntityNum = ENTITYNUM_NONE;
 	ent->client = &level.clients[ index ];
-	ent->classname = S_PLAYER_CLASSNAME;
+	G_SetClassname( ent, S_PLAYER_CLASSNAME );
 	if ( client->noclip )
 	{
 		client->cliprcontents = CONTENTS_BODY;
@@ -1986,7 +1986,7 @@ void ClientDisconnect( int clientNum )
 	ent->client->ps.persistant[ PERS_SPECSTATE ] = SPECTATOR_NOT;
 
 	G_FreeEntity(ent);
-	ent->classname = "disconnected";
+	G_SetClassname( ent, "disconnected" );
 	ent->client = level.clients + clientNum;
 
 	trap_SetConfigstring( CS_PLAYERS + clientNum, "" );
@@ -37,31 +37,10 @@ Maryland 20850 USA.
 #include "sg_local.h"
 #include "sg_cm_world.h"
 
-typedef struct worldEntity_s
-{
-	struct worldSector_s *worldSector;
-	struct worldEntity_s *nextEntityInWorldSector;
-} worldEntity_t;
-
-worldEntity_t wentities[ MAX_GENTITIES ];
-
-worldEntity_t *G_CM_WorldEntityForGentity( gentity_t *gEnt )
-{
-	if ( !gEnt || gEnt->s.number < 0 || gEnt->s.number >= MAX_GENTITIES )
-	{
-		Com_Error(errorParm_t::ERR_DROP, "G_CM_SvEntityForGentity: bad gEnt" );
-	}
-
-	return &wentities[ gEnt->s.number ];
-}
-
-gentity_t *G_CM_GEntityForWorldEntity( worldEntity_t *ent )
-{
-	int num;
-
-	num = ent - wentities;
-	return &g_entities[ num ];
-}
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
 
 /*
 =================
@@ -232,163 +211,498 @@ bool G_CM_EntityContact( const vec3_t mins, const vec3_t maxs, const gentity_t *
 ENTITY CHECKING
 
 To avoid linearly searching through lists of entities during environment testing,
-the world is carved up with an evenly spaced, axially aligned bsp tree.  Entities
-are kept in chains either at the final leafs, or at the first node that splits
-them, which prevents having to deal with multiple fragments of a single entity.
+linked entities are kept in a dynamic bounding volume hierarchy: a binary tree of
+axis aligned boxes whose leafs are the entities. Leafs are slightly enlarged so that
+small movements don't require the tree to be updated, and the tree is rebalanced
+with rotations as entities are inserted and removed, so that its depth stays
+logarithmic no matter how the entities are distributed in the map.
 
 ===============================================================================
 */
 
-typedef struct worldSector_s
+#define WORLDTREE_NODES      ( 2 * MAX_GENTITIES )
+#define WORLDTREE_MARGIN     8.0f
+#define WORLDTREE_STACK_SIZE 256
+
+typedef struct
 {
-	int                  axis; // -1 = leaf node
-	float                dist;
-	struct worldSector_s *children[ 2 ];
+	vec3_t mins, maxs;         // enlarged bounds for leafs
+	int    parent;
+	int    children[ 2 ];      // -1 for leafs
+	int    height;             // 0 for leafs, -1 for free nodes
+	int    item;               // entity number for leafs, next free node for free nodes
+	vec3_t itemMins, itemMaxs; // exact bounds for leafs
+} worldTreeNode_t;
 
-	worldEntity_t        *entities;
-} worldSector_t;
+typedef struct
+{
+	worldTreeNode_t nodes[ WORLDTREE_NODES ];
+	int             leafs[ MAX_GENTITIES ]; // leaf for each item, -1 if not in the tree
+	int             root;
+	int             freeList;
+} worldTree_t;
 
-#define AREA_DEPTH 4
-#define AREA_NODES 64
+static worldTree_t worldTree;
+
+static inline float BoxSurface( const vec3_t mins, const vec3_t maxs )
+{
+	float dx = maxs[ 0 ] - mins[ 0 ];
+	float dy = maxs[ 1 ] - mins[ 1 ];
+	float dz = maxs[ 2 ] - mins[ 2 ];
+
+	return 2.0f * ( dx * dy + dy * dz + dz * dx );
+}
+
+static inline void BoxUnion( const vec3_t mins1, const vec3_t maxs1, const vec3_t mins2,
+                             const vec3_t maxs2, vec3_t mins, vec3_t maxs )
+{
+	for ( int i = 0; i < 3; i++ )
+	{
+		mins[ i ] = std::min( mins1[ i ], mins2[ i ] );
+		maxs[ i ] = std::max( maxs1[ i ], maxs2[ i ] );
+	}
+}
+
+static inline bool BoxesOverlap( const vec3_t mins1, const vec3_t maxs1, const vec3_t mins2, const vec3_t maxs2 )
+{
+	return !( mins1[ 0 ] > maxs2[ 0 ] || mins1[ 1 ] > maxs2[ 1 ] || mins1[ 2 ] > maxs2[ 2 ] ||
+	          maxs1[ 0 ] < mins2[ 0 ] || maxs1[ 1 ] < mins2[ 1 ] || maxs1[ 2 ] < mins2[ 2 ] );
+}
+
+static inline bool BoxContains( const vec3_t outerMins, const vec3_t outerMaxs, const vec3_t mins, const vec3_t maxs )
+{
+	return outerMins[ 0 ] <= mins[ 0 ] && outerMins[ 1 ] <= mins[ 1 ] && outerMins[ 2 ] <= mins[ 2 ] &&
+	       outerMaxs[ 0 ] >= maxs[ 0 ] && outerMaxs[ 1 ] >= maxs[ 1 ] && outerMaxs[ 2 ] >= maxs[ 2 ];
+}
 
-worldSector_t sv_worldSectors[ AREA_NODES ];
-int           sv_numworldSectors;
+static void WorldTree_Clear( worldTree_t *tree )
+{
+	tree->root = -1;
+	tree->freeList = 0;
+
+	for ( int i = 0; i < WORLDTREE_NODES; i++ )
+	{
+		tree->nodes[ i ].height = -1;
+		tree->nodes[ i ].item = i + 1 < WORLDTREE_NODES ? i + 1 : -1;
+	}
+
+	for ( int i = 0; i < MAX_GENTITIES; i++ )
+	{
+		tree->leafs[ i ] = -1;
+	}
+}
+
+static int WorldTree_AllocNode( worldTree_t *tree )
+{
+	int             index = tree->freeList;
+	worldTreeNode_t *node;
+
+	// there are always enough nodes for a leaf per entity and the inner nodes joining them
+	ASSERT_NQ( index, -1 );
+
+	node = &tree->nodes[ index ];
+	tree->freeList = node->item;
+
+	node->parent = -1;
+	node->children[ 0 ] = node->children[ 1 ] = -1;
+	node->height = 0;
+	node->item = -1;
+
+	return index;
+}
+
+static void WorldTree_FreeNode( worldTree_t *tree, int index )
+{
+	tree->nodes[ index ].height = -1;
+	tree->nodes[ index ].item = tree->freeList;
+	tree->freeList = index;
+}
+
+static void WorldTree_FixNode( worldTree_t *tree, int index )
+{
+	worldTreeNode_t *node = &tree->nodes[ index ];
+	worldTreeNode_t *child1 = &tree->nodes[ node->children[ 0 ] ];
+	worldTreeNode_t *child2 = &tree->nodes[ node->children[ 1 ] ];
+
+	node->height = 1 + std::max( child1->height, child2->height );
+	BoxUnion( child1->mins, child1->maxs, child2->mins, child2->maxs, node->mins, node->maxs );
+}
 
 /*
 ===============
-G_CM_SectorList_f
+WorldTree_Rotate
+
+Lifts the higher grandchild below a node up by one level if the node is imbalanced.
+Returns the index of the node that takes its place.
 ===============
 */
-void G_CM_SectorList_f()
+static int WorldTree_Rotate( worldTree_t *tree, int iA )
 {
-	int           i, c;
-	worldSector_t *sec;
-	worldEntity_t    *ent;
+	worldTreeNode_t *A = &tree->nodes[ iA ];
 
-	for ( i = 0; i < AREA_NODES; i++ )
+	if ( A->height < 2 )
 	{
-		sec = &sv_worldSectors[ i ];
+		return iA;
+	}
 
-		c = 0;
+	int iB = A->children[ 0 ];
+	int iC = A->children[ 1 ];
+	int balance = tree->nodes[ iC ].height - tree->nodes[ iB ].height;
 
-		for ( ent = sec->entities; ent; ent = ent->nextEntityInWorldSector )
-		{
-			c++;
-		}
+	if ( balance >= -1 && balance <= 1 )
+	{
+		return iA;
+	}
+
+	// rotate the higher child (C) up, it keeps its higher child and A gets the lower one
+	int side = balance > 1 ? 1 : 0;
+	int iHigh = A->children[ side ];
+	worldTreeNode_t *high = &tree->nodes[ iHigh ];
+	int iF = high->children[ 0 ];
+	int iG = high->children[ 1 ];
+
+	high->children[ 0 ] = iA;
+	high->parent = A->parent;
+	A->parent = iHigh;
 
-		Log::Notice( "sector %i: %i entities\n", i, c );
+	if ( high->parent != -1 )
+	{
+		worldTreeNode_t *parent = &tree->nodes[ high->parent ];
+		parent->children[ parent->children[ 0 ] == iA ? 0 : 1 ] = iHigh;
 	}
+	else
+	{
+		tree->root = iHigh;
+	}
+
+	if ( tree->nodes[ iF ].height > tree->nodes[ iG ].height )
+	{
+		high->children[ 1 ] = iF;
+		A->children[ side ] = iG;
+		tree->nodes[ iG ].parent = iA;
+	}
+	else
+	{
+		high->children[ 1 ] = iG;
+		A->children[ side ] = iF;
+		tree->nodes[ iF ].parent = iA;
+	}
+
+	WorldTree_FixNode( tree, iA );
+	WorldTree_FixNode( tree, iHigh );
+
+	return iHigh;
 }
 
 /*
 ===============
-G_CM_CreateworldSector
+WorldTree_InsertLeaf
 
-Builds a uniformly subdivided tree for the given world size
+Finds the cheapest sibling for a leaf using the surface area heuristic.
 ===============
 */
-worldSector_t  *G_CM_CreateworldSector( int depth, vec3_t mins, vec3_t maxs )
+static void WorldTree_InsertLeaf( worldTree_t *tree, int leaf )
 {
-	worldSector_t *anode;
-	vec3_t        size;
-	vec3_t        mins1, maxs1, mins2, maxs2;
+	worldTreeNode_t *leafNode = &tree->nodes[ leaf ];
+	vec3_t          mins, maxs;
+	int             index, sibling, oldParent, newParent;
 
-	anode = &sv_worldSectors[ sv_numworldSectors ];
-	sv_numworldSectors++;
+	if ( tree->root == -1 )
+	{
+		tree->root = leaf;
+		leafNode->parent = -1;
+		return;
+	}
 
-	if ( depth == AREA_DEPTH )
+	index = tree->root;
+
+	while ( tree->nodes[ index ].height > 0 )
 	{
-		anode->axis = -1;
-		anode->children[ 0 ] = anode->children[ 1 ] = nullptr;
-		return anode;
+		worldTreeNode_t *node = &tree->nodes[ index ];
+		float           area, combinedArea, cost, inheritanceCost, childCost[ 2 ];
+
+		area = BoxSurface( node->mins, node->maxs );
+		BoxUnion( node->mins, node->maxs, leafNode->mins, leafNode->maxs, mins, maxs );
+		combinedArea = BoxSurface( mins, maxs );
+
+		// cost of creating a new parent for this node and the new leaf
+		cost = 2.0f * combinedArea;
+
+		// minimum cost of pushing the leaf further down the tree
+		inheritanceCost = 2.0f * ( combinedArea - area );
+
+		for ( int i = 0; i < 2; i++ )
+		{
+			worldTreeNode_t *child = &tree->nodes[ node->children[ i ] ];
+
+			BoxUnion( child->mins, child->maxs, leafNode->mins, leafNode->maxs, mins, maxs );
+			childCost[ i ] = BoxSurface( mins, maxs ) + inheritanceCost;
+
+			if ( child->height > 0 )
+			{
+				childCost[ i ] -= BoxSurface( child->mins, child->maxs );
+			}
+		}
+
+		if ( cost < childCost[ 0 ] && cost < childCost[ 1 ] )
+		{
+			break;
+		}
+
+		index = node->children[ childCost[ 0 ] < childCost[ 1 ] ? 0 : 1 ];
 	}
 
-	VectorSubtract( maxs, mins, size );
+	sibling = index;
+	oldParent = tree->nodes[ sibling ].parent;
+	newParent = WorldTree_AllocNode( tree );
 
-	if ( size[ 0 ] > size[ 1 ] )
+	tree->nodes[ newParent ].parent = oldParent;
+	tree->nodes[ newParent ].children[ 0 ] = sibling;
+	tree->nodes[ newParent ].children[ 1 ] = leaf;
+	tree->nodes[ sibling ].parent = newParent;
+	leafNode->parent = newParent;
+
+	if ( oldParent != -1 )
 	{
-		anode->axis = 0;
+		worldTreeNode_t *parent = &tree->nodes[ oldParent ];
+		parent->children[ parent->children[ 0 ] == sibling ? 0 : 1 ] = newParent;
 	}
 	else
 	{
-		anode->axis = 1;
+		tree->root = newParent;
 	}
 
-	anode->dist = 0.5 * ( maxs[ anode->axis ] + mins[ anode->axis ] );
-	VectorCopy( mins, mins1 );
-	VectorCopy( mins, mins2 );
-	VectorCopy( maxs, maxs1 );
-	VectorCopy( maxs, maxs2 );
+	// walk back up the tree fixing heights and bounds
+	for ( index = newParent; index != -1; index = tree->nodes[ index ].parent )
+	{
+		WorldTree_FixNode( tree, index );
+		index = WorldTree_Rotate( tree, index );
+	}
+}
 
-	maxs1[ anode->axis ] = mins2[ anode->axis ] = anode->dist;
+static void WorldTree_RemoveLeaf( worldTree_t *tree, int leaf )
+{
+	int parent, grandParent, sibling, index;
+
+	if ( leaf == tree->root )
+	{
+		tree->root = -1;
+		return;
+	}
+
+	parent = tree->nodes[ leaf ].parent;
+	grandParent = tree->nodes[ parent ].parent;
+	sibling = tree->nodes[ parent ].children[ tree->nodes[ parent ].children[ 0 ] == leaf ? 1 : 0 ];
+
+	WorldTree_FreeNode( tree, parent );
 
-	anode->children[ 0 ] = G_CM_CreateworldSector( depth + 1, mins2, maxs2 );
-	anode->children[ 1 ] = G_CM_CreateworldSector( depth + 1, mins1, maxs1 );
+	if ( grandParent == -1 )
+	{
+		tree->root = sibling;
+		tree->nodes[ sibling ].parent = -1;
+		return;
+	}
 
-	return anode;
+	worldTreeNode_t *grandParentNode = &tree->nodes[ grandParent ];
+	grandParentNode->children[ grandParentNode->children[ 0 ] == parent ? 0 : 1 ] = sibling;
+	tree->nodes[ sibling ].parent = grandParent;
+
+	for ( index = grandParent; index != -1; index = tree->nodes[ index ].parent )
+	{
+		WorldTree_FixNode( tree, index );
+		index = WorldTree_Rotate( tree, index );
+	}
+}
+
+static void WorldTree_Unlink( worldTree_t *tree, int item )
+{
+	int leaf = tree->leafs[ item ];
+
+	if ( leaf == -1 )
+	{
+		return;
+	}
+
+	WorldTree_RemoveLeaf( tree, leaf );
+	WorldTree_FreeNode( tree, leaf );
+	tree->leafs[ item ] = -1;
 }
 
 /*
 ===============
-G_CM_ClearWorld
+WorldTree_Link
 
+Inserts or updates an item. The tree is only modified if the item left its enlarged bounds.
 ===============
 */
-void G_CM_ClearWorld()
+static void WorldTree_Link( worldTree_t *tree, int item, const vec3_t mins, const vec3_t maxs )
 {
-	clipHandle_t h;
-	vec3_t       mins, maxs;
+	int             leaf = tree->leafs[ item ];
+	worldTreeNode_t *node;
 
-	memset( sv_worldSectors, 0, sizeof( sv_worldSectors ) );
-	memset( wentities, 0, sizeof( wentities ) );
-	sv_numworldSectors = 0;
+	if ( leaf != -1 )
+	{
+		node = &tree->nodes[ leaf ];
 
-	// get world map bounds
-	h = CM_InlineModel( 0 );
-	CM_ModelBounds( h, mins, maxs );
-	G_CM_CreateworldSector( 0, mins, maxs );
+		if ( BoxContains( node->mins, node->maxs, mins, maxs ) )
+		{
+			VectorCopy( mins, node->itemMins );
+			VectorCopy( maxs, node->itemMaxs );
+			return;
+		}
+
+		WorldTree_RemoveLeaf( tree, leaf );
+	}
+	else
+	{
+		leaf = WorldTree_AllocNode( tree );
+		tree->leafs[ item ] = leaf;
+	}
+
+	node = &tree->nodes[ leaf ];
+	node->item = item;
+	node->height = 0;
+	node->children[ 0 ] = node->children[ 1 ] = -1;
+	VectorCopy( mins, node->itemMins );
+	VectorCopy( maxs, node->itemMaxs );
+
+	for ( int i = 0; i < 3; i++ )
+	{
+		node->mins[ i ] = mins[ i ] - WORLDTREE_MARGIN;
+		node->maxs[ i ] = maxs[ i ] + WORLDTREE_MARGIN;
+	}
+
+	WorldTree_InsertLeaf( tree, leaf );
 }
 
 /*
 ===============
-G_CM_UnlinkEntity
+WorldTree_Query
 
+Fills in the items whose bounds intersect the given area, returns the number found.
 ===============
 */
-void G_CM_UnlinkEntity( gentity_t *gEnt )
+static int WorldTree_Query( const worldTree_t *tree, const vec3_t mins, const vec3_t maxs, int *list, int maxcount )
 {
-	worldEntity_t* scan;
-	worldSector_t* ws;
-
-	worldEntity_t* went = G_CM_WorldEntityForGentity( gEnt );
+	int stack[ WORLDTREE_STACK_SIZE ];
+	int stackSize = 0;
+	int count = 0;
 
-	gEnt->r.linked = false;
-
-	ws = went->worldSector;
-
-	if ( !ws )
+	if ( tree->root == -1 )
 	{
-		return; // not linked in anywhere
+		return 0;
 	}
 
-	went->worldSector = nullptr;
+	stack[ stackSize++ ] = tree->root;
 
-	if ( ws->entities == went )
+	while ( stackSize )
 	{
-		ws->entities = went->nextEntityInWorldSector;
-		return;
+		const worldTreeNode_t *node = &tree->nodes[ stack[ --stackSize ] ];
+
+		if ( !BoxesOverlap( node->mins, node->maxs, mins, maxs ) )
+		{
+			continue;
+		}
+
+		if ( node->height == 0 )
+		{
+			if ( !BoxesOverlap( node->itemMins, node->itemMaxs, mins, maxs ) )
+			{
+				continue;
+			}
+
+			// benchmark trees hold saved layouts, not live entities
+			if ( tree == &worldTree && !g_entities[ node->item ].r.linked )
+			{
+				continue;
+			}
+
+			if ( count == maxcount )
+			{
+				Log::Warn( "G_CM_AreaEntities: MAXCOUNT" );
+				return count;
+			}
+
+			list[ count++ ] = node->item;
+			continue;
+		}
+
+		// the tree is balanced, so this can only happen if it's corrupted
+		if ( stackSize + 2 > WORLDTREE_STACK_SIZE )
+		{
+			Log::Warn( "G_CM_AreaEntities: world tree too deep" );
+			return count;
+		}
+
+		stack[ stackSize++ ] = node->children[ 0 ];
+		stack[ stackSize++ ] = node->children[ 1 ];
 	}
 
-	for ( scan = ws->entities; scan; scan = scan->nextEntityInWorldSector )
+	return count;
+}
+
+/*
+===============
+G_CM_WorldTreeInfo_f
+===============
+*/
+void G_CM_WorldTreeInfo_f()
+{
+	int leafs = 0;
+	int nodes = 0;
+
+	for ( int i = 0; i < WORLDTREE_NODES; i++ )
 	{
-		if ( scan->nextEntityInWorldSector == went )
+		if ( worldTree.nodes[ i ].height == 0 )
 		{
-			scan->nextEntityInWorldSector = went->nextEntityInWorldSector;
-			return;
+			leafs++;
+		}
+		else if ( worldTree.nodes[ i ].height > 0 )
+		{
+			nodes++;
 		}
 	}
 
-	Log::Warn( "G_CM_UnlinkEntity: not found in worldSector\n" );
+	Log::Notice( "world tree: %i entities, %i inner nodes, height %i", leafs, nodes,
+	             worldTree.root == -1 ? 0 : worldTree.nodes[ worldTree.root ].height );
+}
+
+/*
+===============
+G_CM_ClearWorld
+
+===============
+*/
+void G_CM_ClearWorld()
+{
+	WorldTree_Clear( &worldTree );
+
+	G_SpatialClear();
+}
+
+static void G_CM_CheckGentity( const gentity_t *gEnt )
+{
+	if ( !gEnt || gEnt->s.number < 0 || gEnt->s.number >= MAX_GENTITIES )
+	{
+		Com_Error(errorParm_t::ERR_DROP, "G_CM_CheckGentity: bad gEnt" );
+	}
+}
+
+/*
+===============
+G_CM_UnlinkEntity
+
+===============
+*/
+void G_CM_UnlinkEntity( gentity_t *gEnt )
+{
+	G_CM_CheckGentity( gEnt );
+
+	gEnt->r.linked = false;
+
+	G_SpatialUnlink( gEnt );
+
+	WorldTree_Unlink( &worldTree, gEnt->s.number );
 }
 
 /*
@@ -400,7 +714,6 @@ G_CM_LinkEntity
 #define MAX_TOTAL_ENT_LEAFS 128
 void G_CM_LinkEntity( gentity_t *gEnt )
 {
-	worldSector_t *node;
 	int           leafs[ MAX_TOTAL_ENT_LEAFS ];
 	int           cluster;
 	int           num_leafs;
@@ -409,12 +722,11 @@ void G_CM_LinkEntity( gentity_t *gEnt )
 	int           lastLeaf;
 	float         *origin, *angles;
 
-	worldEntity_t* went = G_CM_WorldEntityForGentity( gEnt );
+	G_CM_CheckGentity( gEnt );
 
-	if ( went->worldSector )
-	{
-		G_CM_UnlinkEntity( gEnt );  // unlink from old position
-	}
+	// stay in the world tree so that it can be updated in place, see below
+	gEnt->r.linked = false;
+	G_SpatialUnlink( gEnt );
 
 	// encode the size into the entityState_t for client prediction
 	if ( gEnt->r.bmodel )
@@ -519,6 +831,7 @@ void G_CM_LinkEntity( gentity_t *gEnt )
 	// entity is outside the world and can be considered unlinked
 	if ( !num_leafs )
 	{
+		G_CM_UnlinkEntity( gEnt );
 		return;
 	}
 
@@ -568,36 +881,12 @@ void G_CM_LinkEntity( gentity_t *gEnt )
 
 	gEnt->r.linkcount++;
 
-	// find the first world sector node that the ent's box crosses
-	node = sv_worldSectors;
-
-	while ( 1 )
-	{
-		if ( node->axis == -1 )
-		{
-			break;
-		}
-
-		if ( gEnt->r.absmin[ node->axis ] > node->dist )
-		{
-			node = node->children[ 0 ];
-		}
-		else if ( gEnt->r.absmax[ node->axis ] < node->dist )
-		{
-			node = node->children[ 1 ];
-		}
-		else
-		{
-			break; // crosses the node
-		}
-	}
-
-	// link it in
-	went->worldSector = node;
-	went->nextEntityInWorldSector = node->entities;
-	node->entities = went;
+	// moves within the enlarged bounds of its leaf don't change the tree
+	WorldTree_Link( &worldTree, gEnt->s.number, gEnt->r.absmin, gEnt->r.absmax );
 
 	gEnt->r.linked = true;
+
+	G_SpatialLink( gEnt );
 }
 
 /*
@@ -610,55 +899,130 @@ bounds.  This does NOT mean that they actually touch in the case of bmodels.
 ============================================================================
 */
 
-typedef struct
+/*
+================
+G_CM_AreaEntities
+================
+*/
+int G_CM_AreaEntities( const vec3_t mins, const vec3_t maxs, int *entityList, int maxcount )
 {
-	const float *mins;
-	const float *maxs;
-	int         *list;
-	int         count, maxcount;
-} areaParms_t;
+	return WorldTree_Query( &worldTree, mins, maxs, entityList, maxcount );
+}
 
 /*
-====================
-G_CM_AreaEntities_r
+============================================================================
 
-====================
+AREA QUERY BENCHMARK
+
+Compares the world tree against the uniformly subdivided sector tree it replaced,
+on the current entity layout or on one saved with G_CM_SaveEntityLayout.
+============================================================================
 */
-void G_CM_AreaEntities_r( worldSector_t *node, areaParms_t *ap )
+
+#define AREA_DEPTH 4
+#define AREA_NODES 64
+
+typedef struct
+{
+	int   axis; // -1 = leaf node
+	float dist;
+	int   children[ 2 ];
+	int   entities; // first entity, -1 if none
+} worldSector_t;
+
+typedef struct
+{
+	worldSector_t sectors[ AREA_NODES ];
+	int           numSectors;
+	int           next[ MAX_GENTITIES ];
+} sectorTree_t;
+
+typedef struct
 {
-	worldEntity_t     *check, *next;
-	gentity_t *gcheck;
-//	int             count;
+	int    num;
+	vec3_t absmin, absmax;
+} layoutEntity_t;
 
-//	count = 0;
+static int SectorTree_Create( sectorTree_t *tree, int depth, vec3_t mins, vec3_t maxs )
+{
+	int           index = tree->numSectors++;
+	worldSector_t *anode = &tree->sectors[ index ];
+	vec3_t        size;
+	vec3_t        mins1, maxs1, mins2, maxs2;
 
-	for ( check = node->entities; check; check = next )
+	anode->entities = -1;
+
+	if ( depth == AREA_DEPTH )
 	{
-		next = check->nextEntityInWorldSector;
+		anode->axis = -1;
+		anode->children[ 0 ] = anode->children[ 1 ] = -1;
+		return index;
+	}
+
+	VectorSubtract( maxs, mins, size );
 
-		gcheck = G_CM_GEntityForWorldEntity( check );
+	anode->axis = size[ 0 ] > size[ 1 ] ? 0 : 1;
+	anode->dist = 0.5 * ( maxs[ anode->axis ] + mins[ anode->axis ] );
 
-		if ( !gcheck->r.linked )
+	VectorCopy( mins, mins1 );
+	VectorCopy( mins, mins2 );
+	VectorCopy( maxs, maxs1 );
+	VectorCopy( maxs, maxs2 );
+
+	maxs1[ anode->axis ] = mins2[ anode->axis ] = anode->dist;
+
+	anode->children[ 0 ] = SectorTree_Create( tree, depth + 1, mins2, maxs2 );
+	anode->children[ 1 ] = SectorTree_Create( tree, depth + 1, mins1, maxs1 );
+
+	return index;
+}
+
+static void SectorTree_Link( sectorTree_t *tree, int num, const vec3_t absmin, const vec3_t absmax )
+{
+	worldSector_t *node = &tree->sectors[ 0 ];
+
+	// find the first world sector node that the box crosses
+	while ( node->axis != -1 )
+	{
+		if ( absmin[ node->axis ] > node->dist )
 		{
-			continue;
+			node = &tree->sectors[ node->children[ 0 ] ];
+		}
+		else if ( absmax[ node->axis ] < node->dist )
+		{
+			node = &tree->sectors[ node->children[ 1 ] ];
 		}
+		else
+		{
+			break; // crosses the node
+		}
+	}
+
+	tree->next[ num ] = node->entities;
+	node->entities = num;
+}
 
-		if ( gcheck->r.absmin[ 0 ] > ap->maxs[ 0 ]
-		     || gcheck->r.absmin[ 1 ] > ap->maxs[ 1 ]
-		     || gcheck->r.absmin[ 2 ] > ap->maxs[ 2 ]
-		     || gcheck->r.absmax[ 0 ] < ap->mins[ 0 ] || gcheck->r.absmax[ 1 ] < ap->mins[ 1 ] || gcheck->r.absmax[ 2 ] < ap->mins[ 2 ] )
+static void SectorTree_Query( const sectorTree_t *tree, int sector, const layoutEntity_t *layout,
+                              const int *layoutIndex, const vec3_t mins, const vec3_t maxs,
+                              int *list, int *count, int maxcount )
+{
+	const worldSector_t *node = &tree->sectors[ sector ];
+
+	for ( int num = node->entities; num != -1; num = tree->next[ num ] )
+	{
+		const layoutEntity_t *check = &layout[ layoutIndex[ num ] ];
+
+		if ( !BoxesOverlap( check->absmin, check->absmax, mins, maxs ) )
 		{
 			continue;
 		}
 
-		if ( ap->count == ap->maxcount )
+		if ( *count == maxcount )
 		{
-			Log::Notice( "G_CM_AreaEntities: MAXCOUNT\n" );
 			return;
 		}
 
-		ap->list[ ap->count ] = check - wentities;
-		ap->count++;
+		list[ ( *count )++ ] = num;
 	}
 
 	if ( node->axis == -1 )
@@ -667,35 +1031,284 @@ void G_CM_AreaEntities_r( worldSector_t *node, areaParms_t *ap )
 	}
 
 	// recurse down both sides
-	if ( ap->maxs[ node->axis ] > node->dist )
+	if ( maxs[ node->axis ] > node->dist )
 	{
-		G_CM_AreaEntities_r( node->children[ 0 ], ap );
+		SectorTree_Query( tree, node->children[ 0 ], layout, layoutIndex, mins, maxs, list, count, maxcount );
 	}
 
-	if ( ap->mins[ node->axis ] < node->dist )
+	if ( mins[ node->axis ] < node->dist )
 	{
-		G_CM_AreaEntities_r( node->children[ 1 ], ap );
+		SectorTree_Query( tree, node->children[ 1 ], layout, layoutIndex, mins, maxs, list, count, maxcount );
 	}
 }
 
 /*
-================
-G_CM_AreaEntities
-================
+===============
+G_CM_SaveEntityLayout
+
+Writes the world bounds and the absolute bounds of all linked entities to a file,
+for use with G_CM_BenchmarkAreaQueries.
+===============
 */
-int G_CM_AreaEntities( const vec3_t mins, const vec3_t maxs, int *entityList, int maxcount )
+void G_CM_SaveEntityLayout( const char *filename )
+{
+	fileHandle_t f;
+	vec3_t       mins, maxs;
+	std::string  out;
+	int          count = 0;
+
+	if ( trap_FS_FOpenFile( filename, &f, fsMode_t::FS_WRITE ) < 0 )
+	{
+		Log::Warn( "could not open %s for writing", filename );
+		return;
+	}
+
+	CM_ModelBounds( CM_InlineModel( 0 ), mins, maxs );
+
+	out = Str::Format( "world %f %f %f %f %f %f\n", mins[ 0 ], mins[ 1 ], mins[ 2 ], maxs[ 0 ], maxs[ 1 ], maxs[ 2 ] );
+
+	for ( int i = 0; i < level.num_entities; i++ )
+	{
+		const gentity_t *ent = &g_entities[ i ];
+
+		if ( !ent->r.linked )
+		{
+			continue;
+		}
+
+		out += Str::Format( "%d %f %f %f %f %f %f\n", i,
+		                    ent->r.absmin[ 0 ], ent->r.absmin[ 1 ], ent->r.absmin[ 2 ],
+		                    ent->r.absmax[ 0 ], ent->r.absmax[ 1 ], ent->r.absmax[ 2 ] );
+		count++;
+	}
+
+	trap_FS_Write( out.data(), out.size(), f );
+	trap_FS_FCloseFile( f );
+
+	Log::Notice( "wrote %d entities to %s", count, filename );
+}
+
+static bool G_CM_LoadEntityLayout( const char *filename, vec3_t worldMins, vec3_t worldMaxs,
+                                   std::vector<layoutEntity_t> &layout )
 {
-	areaParms_t ap;
+	fileHandle_t f;
+	int          len = trap_FS_FOpenFile( filename, &f, fsMode_t::FS_READ );
+	std::string  buffer;
+	const char   *line;
+	bool         haveWorld = false;
+
+	if ( len < 0 )
+	{
+		Log::Warn( "could not open %s", filename );
+		return false;
+	}
+
+	buffer.resize( len );
+	trap_FS_Read( &buffer[ 0 ], len, f );
+	trap_FS_FCloseFile( f );
+
+	for ( line = buffer.c_str(); *line; )
+	{
+		layoutEntity_t ent;
+
+		if ( sscanf( line, "world %f %f %f %f %f %f", &worldMins[ 0 ], &worldMins[ 1 ], &worldMins[ 2 ],
+		             &worldMaxs[ 0 ], &worldMaxs[ 1 ], &worldMaxs[ 2 ] ) == 6 )
+		{
+			haveWorld = true;
+		}
+		else if ( sscanf( line, "%d %f %f %f %f %f %f", &ent.num, &ent.absmin[ 0 ], &ent.absmin[ 1 ],
+		                  &ent.absmin[ 2 ], &ent.absmax[ 0 ], &ent.absmax[ 1 ], &ent.absmax[ 2 ] ) == 7 &&
+		          ent.num >= 0 && ent.num < MAX_GENTITIES )
+		{
+			layout.push_back( ent );
+		}
+
+		line = strchr( line, '\n' );
+
+		if ( !line )
+		{
+			break;
+		}
+
+		line++;
+	}
+
+	if ( !haveWorld )
+	{
+		Log::Warn( "%s is not an entity layout", filename );
+		return false;
+	}
+
+	return true;
+}
+
+/*
+===============
+G_CM_BenchmarkAreaQueries
+
+Runs the same random queries against the world tree and the sector tree, built
+from the same entity layout, checks that they find the same entities and reports
+the time spent per query. Half of the queries are boxes around random points, the
+other half enclose a player sized box moving along a random segment, as traces do.
+===============
+*/
+void G_CM_BenchmarkAreaQueries( int numQueries, const char *filename )
+{
+	typedef std::chrono::steady_clock clock_type;
+
+	static worldTree_t  bvh;
+	static sectorTree_t sectors;
+	std::vector<layoutEntity_t> layout;
+	int                 layoutIndex[ MAX_GENTITIES ];
+	vec3_t              worldMins, worldMaxs;
+	std::vector<float>  queries;
+	int                 list[ MAX_GENTITIES ];
+	clock_type::duration bvhTime{}, sectorTime{}, buildTime{};
+	int64_t             found = 0;
+	int                 mismatches = 0;
+
+	if ( filename )
+	{
+		if ( !G_CM_LoadEntityLayout( filename, worldMins, worldMaxs, layout ) )
+		{
+			return;
+		}
+	}
+	else
+	{
+		CM_ModelBounds( CM_InlineModel( 0 ), worldMins, worldMaxs );
+
+		for ( int i = 0; i < level.num_entities; i++ )
+		{
+			const gentity_t *ent = &g_entities[ i ];
+			layoutEntity_t  lent;
+
+			if ( !ent->r.linked )
+			{
+				continue;
+			}
+
+			lent.num = i;
+			VectorCopy( ent->r.absmin, lent.absmin );
+			VectorCopy( ent->r.absmax, lent.absmax );
+			layout.push_back( lent );
+		}
+	}
 
-	ap.mins = mins;
-	ap.maxs = maxs;
-	ap.list = entityList;
-	ap.count = 0;
-	ap.maxcount = maxcount;
+	if ( layout.empty() )
+	{
+		Log::Notice( "no entities to benchmark with" );
+		return;
+	}
 
-	G_CM_AreaEntities_r( sv_worldSectors, &ap );
+	// build both trees
+	{
+		clock_type::time_point start = clock_type::now();
 
-	return ap.count;
+		WorldTree_Clear( &bvh );
+
+		for ( size_t i = 0; i < layout.size(); i++ )
+		{
+			WorldTree_Link( &bvh, layout[ i ].num, layout[ i ].absmin, layout[ i ].absmax );
+		}
+
+		buildTime = clock_type::now() - start;
+	}
+
+	sectors.numSectors = 0;
+	SectorTree_Create( &sectors, 0, worldMins, worldMaxs );
+
+	for ( size_t i = 0; i < layout.size(); i++ )
+	{
+		layoutIndex[ layout[ i ].num ] = i;
+		SectorTree_Link( &sectors, layout[ i ].num, layout[ i ].absmin, layout[ i ].absmax );
+	}
+
+	// generate the queries up front so that both trees get the same ones
+	{
+		std::mt19937                          rng( 0x5eed );
+		std::uniform_real_distribution<float> unit( 0.0f, 1.0f );
+		static const vec3_t                   playerMins = { -15.0f, -15.0f, -24.0f };
+		static const vec3_t                   playerMaxs = { 15.0f, 15.0f, 32.0f };
+
+		queries.resize( numQueries * 6 );
+
+		for ( int q = 0; q < numQueries; q++ )
+		{
+			float  *mins = &queries[ q * 6 ];
+			float  *maxs = mins + 3;
+			vec3_t start, end;
+
+			for ( int i = 0; i < 3; i++ )
+			{
+				start[ i ] = worldMins[ i ] + unit( rng ) * ( worldMaxs[ i ] - worldMins[ i ] );
+			}
+
+			if ( q & 1 )
+			{
+				for ( int i = 0; i < 3; i++ )
+				{
+					end[ i ] = start[ i ] + ( unit( rng ) * 2.0f - 1.0f ) * 1024.0f;
+					mins[ i ] = std::min( start[ i ], end[ i ] ) + playerMins[ i ] - 1;
+					maxs[ i ] = std::max( start[ i ], end[ i ] ) + playerMaxs[ i ] + 1;
+				}
+			}
+			else
+			{
+				for ( int i = 0; i < 3; i++ )
+				{
+					float size = 16.0f + unit( rng ) * 496.0f;
+
+					mins[ i ] = start[ i ] - size;
+					maxs[ i ] = start[ i ] + size;
+				}
+			}
+		}
+	}
+
+	for ( int q = 0; q < numQueries; q++ )
+	{
+		const float            *mins = &queries[ q * 6 ];
+		const float            *maxs = mins + 3;
+		int                    bvhCount, sectorCount = 0;
+		clock_type::time_point start;
+		int                    sectorList[ MAX_GENTITIES ];
+
+		start = clock_type::now();
+		bvhCount = WorldTree_Query( &bvh, mins, maxs, list, MAX_GENTITIES );
+		bvhTime += clock_type::now() - start;
+
+		start = clock_type::now();
+		SectorTree_Query( &sectors, 0, layout.data(), layoutIndex, mins, maxs, sectorList, &sectorCount, MAX_GENTITIES );
+		sectorTime += clock_type::now() - start;
+
+		found += bvhCount;
+
+		std::sort( list, list + bvhCount );
+		std::sort( sectorList, sectorList + sectorCount );
+
+		if ( bvhCount != sectorCount || !std::equal( list, list + bvhCount, sectorList ) )
+		{
+			mismatches++;
+		}
+	}
+
+	auto usec = []( clock_type::duration d )
+	{
+		return std::chrono::duration_cast<std::chrono::duration<double, std::micro>>( d ).count();
+	};
+
+	Log::Notice( "%d entities, %d queries, %.1f entities found per query",
+	             ( int ) layout.size(), numQueries, ( double ) found / numQueries );
+	Log::Notice( "world tree:  %.3f us per query, height %d, built in %.1f us",
+	             usec( bvhTime ) / numQueries, bvh.root == -1 ? 0 : bvh.nodes[ bvh.root ].height,
+	             usec( buildTime ) );
+	Log::Notice( "sector tree: %.3f us per query", usec( sectorTime ) / numQueries );
+
+	if ( mismatches )
+	{
+		Log::Warn( "%d queries returned different entities", mismatches );
+	}
 }
 
 //===========================================================================
@@ -58,7 +58,12 @@ void G_CM_LinkEntity( gentity_t *ent );
 
 clipHandle_t G_CM_ClipHandleForEntity( const sharedEntity_t *ent );
 
-void         G_CM_SectorList_f();
+// world tree statistics, and a benchmark comparing it to the old sector tree
+// on the current or a saved entity layout
+
+void         G_CM_WorldTreeInfo_f();
+void         G_CM_SaveEntityLayout( const char *filename );
+void         G_CM_BenchmarkAreaQueries( int numQueries, const char *filename );
 
 int          G_CM_AreaEntities( const vec3_t mins, const vec3_t maxs, int *entityList, int maxcount );
 
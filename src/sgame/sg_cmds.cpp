@@ -326,16 +326,20 @@ int G_ClientNumbersFromString( const char *s, int *plist, int max )
 	return found;
 }
 
+#define SCOREBOARD_STRING_SIZE 1400
+
 /*
 ==================
-ScoreboardMessage
+ScoreboardEncode
 
+Writes the scoreboard as seen by a member of the given team. Weapons and
+upgrades are only shown to spectators and team mates, so there are only
+as many different scoreboards as there are teams.
 ==================
 */
-void ScoreboardMessage( gentity_t *ent )
+static void ScoreboardEncode( team_t viewerTeam, char *string, int size )
 {
 	char      entry[ 1024 ];
-	char      string[ 1400 ];
 	int       stringlength;
 	int       i, j;
 	gclient_t *cl;
@@ -365,8 +369,7 @@ void ScoreboardMessage( gentity_t *ent )
 		}
 
 		if ( cl->sess.spectatorState == SPECTATOR_NOT &&
-		     ( ent->client->pers.team == TEAM_NONE ||
-		       cl->pers.team == ent->client->pers.team ) )
+		     ( viewerTeam == TEAM_NONE || cl->pers.team == viewerTeam ) )
 		{
 			weapon = (weapon_t) cl->ps.weapon;
 
@@ -407,17 +410,87 @@ void ScoreboardMessage( gentity_t *ent )
 
 		j = strlen( entry );
 
-		if ( stringlength + j >= (int) sizeof( string ) )
+		if ( stringlength + j >= size )
 		{
 			break;
 		}
 
-		strcpy( string + stringlength, entry );
+		memcpy( string + stringlength, entry, j + 1 );
 		stringlength += j;
 	}
+}
+
+static unsigned ScoreboardChecksum( const char *string )
+{
+	unsigned hash = BG_Hash( string, strlen( string ) );
+
+	// 0 means nothing was sent yet
+	return hash ? hash : 1;
+}
+
+static void ScoreboardSend( gentity_t *ent, const char *string )
+{
+	const char *message = va( "scores %i %i%s", level.team[ TEAM_ALIENS ].kills,
+	                          level.team[ TEAM_HUMANS ].kills, string );
+
+	ent->client->pers.scoreboardChecksum = ScoreboardChecksum( message );
+	trap_SendServerCommand( ent - g_entities, message );
+}
+
+/*
+==================
+ScoreboardMessage
+
+==================
+*/
+void ScoreboardMessage( gentity_t *ent )
+{
+	char string[ SCOREBOARD_STRING_SIZE ];
 
-	trap_SendServerCommand( ent - g_entities, va( "scores %i %i%s",
-	                        level.team[ TEAM_ALIENS ].kills, level.team[ TEAM_HUMANS ].kills, string ) );
+	ScoreboardEncode( (team_t) ent->client->pers.team, string, sizeof( string ) );
+	ScoreboardSend( ent, string );
+}
+
+/*
+========================
+SendScoreboardMessageToAllClients
+
+Do this at BeginIntermission time and whenever ranks are recalculated
+due to enters/exits/forced team changes
+
+The scoreboard is encoded once per team, and only sent to the clients
+whose last scoreboard is out of date
+========================
+*/
+void SendScoreboardMessageToAllClients()
+{
+	char     strings[ NUM_TEAMS ][ SCOREBOARD_STRING_SIZE ];
+	unsigned checksums[ NUM_TEAMS ];
+	bool     encoded[ NUM_TEAMS ] = { };
+
+	for ( int i = 0; i < level.maxclients; i++ )
+	{
+		gentity_t *ent = g_entities + i;
+		int       team = ent->client->pers.team;
+
+		if ( ent->client->pers.connected != CON_CONNECTED )
+		{
+			continue;
+		}
+
+		if ( !encoded[ team ] )
+		{
+			ScoreboardEncode( (team_t) team, strings[ team ], sizeof( strings[ team ] ) );
+			checksums[ team ] = ScoreboardChecksum( va( "scores %i %i%s", level.team[ TEAM_ALIENS ].kills,
+			                                            level.team[ TEAM_HUMANS ].kills, strings[ team ] ) );
+			encoded[ team ] = true;
+		}
+
+		if ( ent->client->pers.scoreboardChecksum != checksums[ team ] )
+		{
+			ScoreboardSend( ent, strings[ team ] );
+		}
+	}
 }
 
 /*
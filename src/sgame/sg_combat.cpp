@@ -870,7 +870,7 @@ bool G_SelectiveRadiusDamage( vec3_t origin, gentity_t *attacker, float damage,
 		maxs[ i ] = origin[ i ] + radius;
 	}
 
-	numListedEntities = trap_EntitiesInBox( mins, maxs, entityList, MAX_GENTITIES );
+	numListedEntities = G_SpatialEntitiesInBox( mins, maxs, entityList, MAX_GENTITIES );
 
 	for ( e = 0; e < numListedEntities; e++ )
 	{
@@ -947,7 +947,7 @@ bool G_RadiusDamage( vec3_t origin, gentity_t *attacker, float damage,
 		maxs[ i ] = origin[ i ] + radius;
 	}
 
-	numListedEntities = trap_EntitiesInBox( mins, maxs, entityList, MAX_GENTITIES );
+	numListedEntities = G_SpatialEntitiesInBox( mins, maxs, entityList, MAX_GENTITIES );
 
 	for ( e = 0; e < numListedEntities; e++ )
 	{
@@ -36,6 +36,11 @@ Maryland 20850 USA.
 #include "sg_entities.h"
 #include "CBSE.h"
 
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 static EmptyEntity emptyEntity(EmptyEntity::Params{nullptr});
 
 /*
@@ -63,6 +68,119 @@ void G_InitGentity( gentity_t *entity )
 	entity->s.number = entity - g_entities;
 	entity->r.ownerNum = ENTITYNUM_NONE;
 	entity->creationTime = level.time;
+
+	G_UpdateEntityIndex( entity );
+}
+
+/*
+=================
+Entity free list
+
+Freed slots are queued in the order they were freed, so the slot that has
+been free the longest is always at the head and the whole reuse policy
+comes down to looking at it.
+=================
+*/
+static struct
+{
+	int  prev[ MAX_GENTITIES ];
+	int  next[ MAX_GENTITIES ];
+	bool queued[ MAX_GENTITIES ];
+	int  head, tail;
+} freeSlots;
+
+static void FreeSlotRemove( int num )
+{
+	if ( freeSlots.prev[ num ] >= 0 )
+	{
+		freeSlots.next[ freeSlots.prev[ num ] ] = freeSlots.next[ num ];
+	}
+	else
+	{
+		freeSlots.head = freeSlots.next[ num ];
+	}
+
+	if ( freeSlots.next[ num ] >= 0 )
+	{
+		freeSlots.prev[ freeSlots.next[ num ] ] = freeSlots.prev[ num ];
+	}
+	else
+	{
+		freeSlots.tail = freeSlots.prev[ num ];
+	}
+
+	freeSlots.queued[ num ] = false;
+}
+
+static void FreeSlotAppend( int num )
+{
+	if ( freeSlots.queued[ num ] )
+	{
+		FreeSlotRemove( num );
+	}
+
+	freeSlots.prev[ num ] = freeSlots.tail;
+	freeSlots.next[ num ] = -1;
+
+	if ( freeSlots.tail >= 0 )
+	{
+		freeSlots.next[ freeSlots.tail ] = num;
+	}
+	else
+	{
+		freeSlots.head = num;
+	}
+
+	freeSlots.tail = num;
+	freeSlots.queued[ num ] = true;
+}
+
+/*
+=================
+G_InitEntityFreeList
+
+Called whenever g_entities is reset
+=================
+*/
+void G_InitEntityFreeList()
+{
+	memset( freeSlots.queued, 0, sizeof( freeSlots.queued ) );
+	freeSlots.head = freeSlots.tail = -1;
+}
+
+/*
+=================
+FreeSlotTake
+
+Returns the slot that has been free the longest, or nullptr if there are none
+or, unless force is set, if it was freed too recently
+=================
+*/
+static gentity_t *FreeSlotTake( bool force )
+{
+	while ( freeSlots.head >= 0 )
+	{
+		gentity_t *slot = &g_entities[ freeSlots.head ];
+
+		// something took the slot without going through G_NewEntity
+		if ( slot->inuse )
+		{
+			FreeSlotRemove( freeSlots.head );
+			continue;
+		}
+
+		// the first couple seconds of server time can involve a lot of
+		// freeing and allocating, so relax the replacement policy
+		if ( !force && slot->freetime > level.startTime + 2000 && level.time - slot->freetime < 1000 )
+		{
+			return nullptr;
+		}
+
+		FreeSlotRemove( freeSlots.head );
+		return slot;
+	}
+
+	return nullptr;
 }
 
 /*
@@ -77,59 +195,40 @@ never be used by anything else.
 Try to avoid reusing an entity that was recently freed, because it
 can cause the client to think the entity morphed into something else
 instead of being removed and recreated, which can cause interpolated
-angles and bad trails.
+angles and bad trails. New slots are only opened when no freed one is old
+enough, and recently freed ones are only reused when there's no room left.
 =================
 */
 gentity_t *G_NewEntity()
 {
-	int       i, force;
 	gentity_t *newEntity;
 
-	newEntity = nullptr; // shut up warning
-	i = 0; // shut up warning
+	newEntity = FreeSlotTake( false );
 
-	for ( force = 0; force < 2; force++ )
+	if ( !newEntity && level.num_entities == ENTITYNUM_MAX_NORMAL )
 	{
-		// if we go through all entities first and can't find a free one,
-		// then try again a second time, this time ignoring times
-		newEntity = &g_entities[ MAX_CLIENTS ];
+		newEntity = FreeSlotTake( true );
 
-		for ( i = MAX_CLIENTS; i < level.num_entities; i++, newEntity++ )
+		if ( !newEntity )
 		{
-			if ( newEntity->inuse )
+			for ( int i = 0; i < MAX_GENTITIES; i++ )
 			{
-				continue;
+				Log::Warn( "%4i: %s", i, g_entities[ i ].classname );
 			}
 
-			// the first couple seconds of server time can involve a lot of
-			// freeing and allocating, so relax the replacement policy
-			if ( !force && newEntity->freetime > level.startTime + 2000 && level.time - newEntity->freetime < 1000 )
-			{
-				continue;
-			}
-
-			// reuse this slot
-			G_InitGentity( newEntity );
-			return newEntity;
-		}
-
-		if ( i != MAX_GENTITIES )
-		{
-			break;
+			Com_Error(errorParm_t::ERR_DROP,  "G_Spawn: no free entities" );
 		}
 	}
 
-	if ( i == ENTITYNUM_MAX_NORMAL )
+	if ( newEntity )
 	{
-		for ( i = 0; i < MAX_GENTITIES; i++ )
-		{
-			Log::Warn( "%4i: %s", i, g_entities[ i ].classname );
-		}
-
-		Com_Error(errorParm_t::ERR_DROP,  "G_Spawn: no free entities" );
+		// reuse this slot
+		G_InitGentity( newEntity );
+		return newEntity;
 	}
 
 	// open up a new slot
+	newEntity = &g_entities[ level.num_entities ];
 	level.num_entities++;
 
 	// let the server system know that there are more entities
@@ -187,6 +286,14 @@ void G_FreeEntity( gentity_t *entity )
 	entity->classname = "freent";
 	entity->freetime = level.time;
 	entity->inuse = false;
+
+	G_UpdateEntityIndex( entity );
+
+	// s.number was cleared above
+	if ( entity - g_entities >= MAX_CLIENTS && entity - g_entities < level.num_entities )
+	{
+		FreeSlotAppend( entity - g_entities );
+	}
 }
 
 
@@ -207,7 +314,7 @@ gentity_t *G_NewTempEntity( const vec3_t origin, int event )
 	newEntity = G_NewEntity();
 	newEntity->s.eType = Util::enum_cast<entityType_t>( Util::ordinal(entityType_t::ET_EVENTS) + event );
 
-	newEntity->classname = "tempEntity";
+	G_SetClassname( newEntity, "tempEntity" );
 	newEntity->eventTime = level.time;
 	newEntity->freeAfterEvent = true;
 
@@ -287,11 +394,196 @@ void G_PrintEntityNameList(gentity_t *entity)
 /*
 =================================================================================
 
+entity index
+
+=================================================================================
+*/
+
+/*
+ * Entities in use are indexed by classname and by each of their names, without
+ * regard to case. The lists are kept in entity number order, so walking one visits
+ * entities in the same order as a scan of g_entities would. Lookups still test
+ * every candidate, but anything that gives an entity new names has to call
+ * G_UpdateEntityIndex, and a new classname has to be set with G_SetClassname, or it
+ * won't be found.
+ */
+typedef std::unordered_map<std::string, std::vector<int>> entityIndex_t;
+
+static entityIndex_t classnameIndex;
+static entityIndex_t nameIndex;
+
+// the keys each slot is currently indexed under
+static struct
+{
+	std::string              classname;
+	std::vector<std::string> names;
+	bool                     indexed;
+} indexedEntities[ MAX_GENTITIES ];
+
+static std::string EntityIndexKey( const char *string )
+{
+	std::string key( string );
+
+	for ( char &c : key )
+	{
+		c = Str::ctolower( c );
+	}
+
+	return key;
+}
+
+static void EntityIndexInsert( entityIndex_t &index, const std::string &key, int num )
+{
+	std::vector<int> &list = index[ key ];
+	auto             it = std::lower_bound( list.begin(), list.end(), num );
+
+	if ( it == list.end() || *it != num )
+	{
+		list.insert( it, num );
+	}
+}
+
+static void EntityIndexRemove( entityIndex_t &index, const std::string &key, int num )
+{
+	auto found = index.find( key );
+
+	if ( found == index.end() )
+	{
+		return;
+	}
+
+	std::vector<int> &list = found->second;
+	auto             it = std::lower_bound( list.begin(), list.end(), num );
+
+	if ( it != list.end() && *it == num )
+	{
+		list.erase( it );
+	}
+
+	if ( list.empty() )
+	{
+		index.erase( found );
+	}
+}
+
+static const std::vector<int> *EntityIndexFind( const entityIndex_t &index, const char *string )
+{
+	auto found = index.find( EntityIndexKey( string ) );
+
+	return found == index.end() ? nullptr : &found->second;
+}
+
+/*
+=============
+G_ClearEntityIndex
+
+Called whenever g_entities is reset
+=============
+*/
+void G_ClearEntityIndex()
+{
+	classnameIndex.clear();
+	nameIndex.clear();
+
+	for ( int i = 0; i < MAX_GENTITIES; i++ )
+	{
+		indexedEntities[ i ].classname.clear();
+		indexedEntities[ i ].names.clear();
+		indexedEntities[ i ].indexed = false;
+	}
+}
+
+/*
+=============
+G_UpdateEntityIndex
+
+Indexes an entity under its current classname and names
+=============
+*/
+void G_UpdateEntityIndex( gentity_t *entity )
+{
+	int  num = entity - g_entities;
+	auto &indexed = indexedEntities[ num ];
+
+	if ( indexed.indexed )
+	{
+		EntityIndexRemove( classnameIndex, indexed.classname, num );
+
+		for ( const std::string &name : indexed.names )
+		{
+			EntityIndexRemove( nameIndex, name, num );
+		}
+
+		indexed.classname.clear();
+		indexed.names.clear();
+		indexed.indexed = false;
+	}
+
+	// the world and none slots are past level.num_entities and never searched
+	if ( !entity->inuse || num >= level.num_entities )
+	{
+		return;
+	}
+
+	if ( entity->classname )
+	{
+		indexed.classname = EntityIndexKey( entity->classname );
+		EntityIndexInsert( classnameIndex, indexed.classname, num );
+	}
+
+	for ( int i = 0; i < MAX_ENTITY_ALIASES && entity->names[ i ]; i++ )
+	{
+		indexed.names.push_back( EntityIndexKey( entity->names[ i ] ) );
+		EntityIndexInsert( nameIndex, indexed.names.back(), num );
+	}
+
+	indexed.indexed = true;
+}
+
+/*
+=============
+G_SetClassname
+
+Gives an entity a new classname and reindexes it
+=============
+*/
+void G_SetClassname( gentity_t *entity, const char *classname )
+{
+	entity->classname = classname;
+	G_UpdateEntityIndex( entity );
+}
+
+/*
+=================================================================================
+
 gentity list handling and searching
 
 =================================================================================
 */
 
+static inline bool EntityMatches( gentity_t *entity, const char *classname, bool skipdisabled, size_t fieldofs, const char *match )
+{
+	char *fieldString;
+
+	if ( !entity->inuse )
+		return false;
+
+	if( skipdisabled && !entity->enabled)
+		return false;
+
+	if ( classname && Q_stricmp( entity->classname, classname ) )
+		return false;
+
+	if ( fieldofs && match )
+	{
+		fieldString = * ( char ** )( ( byte * ) entity + fieldofs );
+		if ( Q_stricmp( fieldString, match ) )
+			return false;
+	}
+
+	return true;
+}
+
 /*
 =============
 G_IterateEntities
@@ -303,11 +595,14 @@ Iteration will continue to return the gentity following the "previous" parameter
 or nullptr if there are no further matching gentities.
 
 Set nullptr as previous gentity to start the iteration from the beginning
+
+Searches by classname or by one of the names are answered from the entity index.
 =============
 */
 gentity_t *G_IterateEntities( gentity_t *entity, const char *classname, bool skipdisabled, size_t fieldofs, const char *match )
 {
-	char *fieldString;
+	const std::vector<int> *candidates = nullptr;
+	bool                   indexed = false;
 
 	if ( !entity )
 	{
@@ -321,26 +616,42 @@ gentity_t *G_IterateEntities( gentity_t *entity, const char *classname, bool ski
 		entity++;
 	}
 
-	for ( ; entity < &g_entities[ level.num_entities ]; entity++ )
+	if ( classname )
 	{
-		if ( !entity->inuse )
-			continue;
+		candidates = EntityIndexFind( classnameIndex, classname );
+		indexed = true;
+	}
+	else if ( match && fieldofs >= FOFS( names ) && fieldofs < FOFS( names[ MAX_ENTITY_ALIASES ] ) )
+	{
+		candidates = EntityIndexFind( nameIndex, match );
+		indexed = true;
+	}
 
-		if( skipdisabled && !entity->enabled)
-			continue;
+	if ( indexed )
+	{
+		if ( !candidates )
+		{
+			return nullptr;
+		}
 
+		for ( auto it = std::lower_bound( candidates->begin(), candidates->end(), entity - g_entities );
+		      it != candidates->end() && *it < level.num_entities; ++it )
+		{
+			if ( EntityMatches( &g_entities[ *it ], classname, skipdisabled, fieldofs, match ) )
+			{
+				return &g_entities[ *it ];
+			}
+		}
 
-		if ( classname && Q_stricmp( entity->classname, classname ) )
-			continue;
+		return nullptr;
+	}
 
-		if ( fieldofs && match )
+	for ( ; entity < &g_entities[ level.num_entities ]; entity++ )
+	{
+		if ( EntityMatches( entity, classname, skipdisabled, fieldofs, match ) )
 		{
-			fieldString = * ( char ** )( ( byte * ) entity + fieldofs );
-			if ( Q_stricmp( fieldString, match ) )
-				continue;
+			return entity;
 		}
-
-		return entity;
 	}
 
 	return nullptr;
@@ -599,16 +910,49 @@ gentity_t *G_ResolveEntityKeyword( gentity_t *self, char *keyword )
 	return resolution;
 }
 
+/*
+=============
+G_IterateNamedEntities
+
+Returns the next entity after the given one, or the first one outside of the
+client slots, that is known by the given name
+=============
+*/
+static gentity_t *G_IterateNamedEntities( gentity_t *entity, const char *name, bool skipdisabled )
+{
+	const std::vector<int> *candidates = EntityIndexFind( nameIndex, name );
+	int                    start = entity ? entity - g_entities + 1 : MAX_CLIENTS;
+
+	if ( !candidates )
+	{
+		return nullptr;
+	}
+
+	for ( auto it = std::lower_bound( candidates->begin(), candidates->end(), start );
+	      it != candidates->end() && *it < level.num_entities; ++it )
+	{
+		entity = &g_entities[ *it ];
+
+		if ( !entity->inuse || ( skipdisabled && !entity->enabled ) )
+			continue;
+
+		if( G_MatchesName(entity, name) )
+			return entity;
+	}
+
+	return nullptr;
+}
+
 gentity_t *G_IterateTargets(gentity_t *entity, int *targetIndex, gentity_t *self)
 {
 	gentity_t *possibleTarget = nullptr;
 
-	if (entity)
-		goto cont;
+	if (!entity)
+		*targetIndex = 0;
 
-	for (*targetIndex = 0; self->targets[*targetIndex]; ++(*targetIndex))
+	for (; self->targets[*targetIndex]; ++(*targetIndex), entity = nullptr)
 	{
-		if(self->targets[*targetIndex][0] == '$')
+		if(!entity && self->targets[*targetIndex][0] == '$')
 		{
 			possibleTarget = G_ResolveEntityKeyword( self, self->targets[*targetIndex] );
 			if(possibleTarget && possibleTarget->enabled)
@@ -616,40 +960,28 @@ gentity_t *G_IterateTargets(gentity_t *entity, int *targetIndex, gentity_t *self
 			return nullptr;
 		}
 
-		for( entity = &g_entities[ MAX_CLIENTS ]; entity < &g_entities[ level.num_entities ]; entity++ )
-		{
-			if ( !entity->inuse || !entity->enabled)
-				continue;
-
-			if( G_MatchesName(entity, self->targets[*targetIndex]) )
-				return entity;
+		entity = G_IterateNamedEntities( entity, self->targets[*targetIndex], true );
 
-			cont: ;
-		}
+		if ( entity )
+			return entity;
 	}
 	return nullptr;
 }
 
 gentity_t *G_IterateCallEndpoints(gentity_t *entity, int *calltargetIndex, gentity_t *self)
 {
-	if (entity)
-		goto cont;
+	if (!entity)
+		*calltargetIndex = 0;
 
-	for (*calltargetIndex = 0; self->calltargets[*calltargetIndex].name; ++(*calltargetIndex))
+	for (; self->calltargets[*calltargetIndex].name; ++(*calltargetIndex), entity = nullptr)
 	{
-		if(self->calltargets[*calltargetIndex].name[0] == '$')
+		if(!entity && self->calltargets[*calltargetIndex].name[0] == '$')
 			return G_ResolveEntityKeyword( self, self->calltargets[*calltargetIndex].name );
 
-		for( entity = &g_entities[ MAX_CLIENTS ]; entity < &g_entities[ level.num_entities ]; entity++ )
-		{
-			if ( !entity->inuse )
-				continue;
-
-			if( G_MatchesName(entity, self->calltargets[*calltargetIndex].name) )
-				return entity;
+		entity = G_IterateNamedEntities( entity, self->calltargets[*calltargetIndex].name, false );
 
-			cont: ;
-		}
+		if ( entity )
+			return entity;
 	}
 	return nullptr;
 }
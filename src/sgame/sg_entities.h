@@ -222,6 +222,10 @@ typedef struct
 //lifecycle
 void       G_InitGentityMinimal( gentity_t *e );
 void       G_InitGentity( gentity_t *e );
+void       G_InitEntityFreeList();
+void       G_ClearEntityIndex();
+void       G_UpdateEntityIndex( gentity_t *e );
+void       G_SetClassname( gentity_t *e, const char *classname );
 gentity_t  *G_NewEntity();
 gentity_t  *G_NewTempEntity( const vec3_t origin, int event );
 void       G_FreeEntity( gentity_t *e );
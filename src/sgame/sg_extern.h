@@ -54,6 +54,7 @@ extern  vmCvar_t g_maxGameClients;
 extern  vmCvar_t g_lockTeamsAtStart;
 extern  vmCvar_t g_minNameChangePeriod;
 extern  vmCvar_t g_maxNameChanges;
+extern  vmCvar_t g_namelogMaxDisconnected;
 
 extern  vmCvar_t g_showHelpOnConnection;
 extern  vmCvar_t g_timelimit;
@@ -177,6 +178,8 @@ extern  vmCvar_t g_combatCooldown;
 extern  vmCvar_t g_geoip;
 
 extern  vmCvar_t g_debugEntities;
+extern  vmCvar_t g_debugLocations;
+extern  vmCvar_t g_profileFrames;
 
 extern  vmCvar_t g_instantBuilding;
 
@@ -216,5 +219,7 @@ extern vmCvar_t g_bot_numInGroup;
 extern vmCvar_t g_bot_persistent;
 extern vmCvar_t g_bot_buildLayout;
 extern vmCvar_t g_bot_debug;
+extern vmCvar_t g_bot_perceptionInterval;
+extern vmCvar_t g_bot_thinkBudget;
 
 #endif // SG_EXTERN_H_
@@ -43,6 +43,7 @@ along with Daemon Source Code.  If not, see <http://www.gnu.org/licenses/>.
 #include "sg_admin.h"
 #include "sg_bot.h"
 #include "sg_entities.h"
+#include "sg_profiler.h"
 
 // struct definitions
 #include "sg_struct.h"
@@ -22,6 +22,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 */
 
 #include "sg_local.h"
+#include "sg_cm_world.h"
 #include "CBSE.h"
 #include "backend/CBSEBackend.h"
 
@@ -105,6 +106,7 @@ vmCvar_t           pmove_msec;
 vmCvar_t           pmove_accurate;
 vmCvar_t           g_minNameChangePeriod;
 vmCvar_t           g_maxNameChanges;
+vmCvar_t           g_namelogMaxDisconnected;
 
 vmCvar_t           g_initialBuildPoints;
 vmCvar_t           g_initialMineRate;
@@ -193,6 +195,8 @@ vmCvar_t           g_combatCooldown;
 vmCvar_t           g_geoip;
 
 vmCvar_t           g_debugEntities;
+vmCvar_t           g_debugLocations;
+vmCvar_t           g_profileFrames;
 
 vmCvar_t           g_instantBuilding;
 
@@ -236,6 +240,8 @@ vmCvar_t g_bot_numInGroup;
 vmCvar_t g_bot_persistent;
 vmCvar_t g_bot_debug;
 vmCvar_t g_bot_buildLayout;
+vmCvar_t g_bot_perceptionInterval;
+vmCvar_t g_bot_thinkBudget;
 
 //</bot stuff>
 
@@ -279,6 +285,7 @@ static cvarTable_t gameCvarTable[] =
 	// clients: limits
 	{ &g_minNameChangePeriod,         "g_minNameChangePeriod",         "5",                                0,                                               0, false    , nullptr       },
 	{ &g_maxNameChanges,              "g_maxNameChanges",              "5",                                0,                                               0, false    , nullptr       },
+	{ &g_namelogMaxDisconnected,      "g_namelogMaxDisconnected",      "256",                              0,                                               0, false    , nullptr       },
 	{ &g_enableVsays,                 "g_voiceChats",                  "1",                                0,                                               0, false    , nullptr       },
 	{ &g_inactivity,                  "g_inactivity",                  "0",                                0,                                               0, true     , nullptr       },
 	{ &g_emoticonsAllowedInNames,     "g_emoticonsAllowedInNames",     "1",                                CVAR_LATCH,                                      0, false    , nullptr       },
@@ -345,6 +352,8 @@ static cvarTable_t gameCvarTable[] =
 	{ &g_debugMapRotation,            "g_debugMapRotation",            "0",                                0,                                               0, false    , nullptr       },
 	{ &g_debugVoices,                 "g_debugVoices",                 "0",                                0,                                               0, false    , nullptr       },
 	{ &g_debugEntities,               "g_debugEntities",               "0",                                0,                                               0, false    , nullptr       },
+	{ &g_debugLocations,              "g_debugLocations",              "0",                                0,                                               0, false    , nullptr       },
+	{ &g_profileFrames,               "g_profileFrames",               "0",                                0,                                               0, false    , nullptr       },
 	{ &g_debugFire,                   "g_debugFire",                   "0",                                0,                                               0, false    , nullptr       },
 
 	// gameplay: basic
@@ -441,7 +450,9 @@ static cvarTable_t gameCvarTable[] =
 	{ &g_bot_infinite_funds, "g_bot_infinite_funds", "0",  CVAR_NORESTART, 0, false, nullptr },
 	{ &g_bot_numInGroup, "g_bot_numInGroup", "3",  CVAR_NORESTART, 0, false, nullptr },
 	{ &g_bot_debug, "g_bot_debug", "0",  CVAR_NORESTART, 0, false, nullptr },
-	{ &g_bot_buildLayout, "g_bot_buildLayout", "botbuild",  CVAR_NORESTART, 0, false, nullptr }
+	{ &g_bot_buildLayout, "g_bot_buildLayout", "botbuild",  CVAR_NORESTART, 0, false, nullptr },
+	{ &g_bot_perceptionInterval, "g_bot_perceptionInterval", "100",  CVAR_NORESTART, 0, false, nullptr },
+	{ &g_bot_thinkBudget, "g_bot_thinkBudget", "2000",  CVAR_NORESTART, 0, false, nullptr }
 };
 
 static const size_t gameCvarTableSize = ARRAY_LEN( gameCvarTable );
@@ -449,6 +460,7 @@ static const size_t gameCvarTableSize = ARRAY_LEN( gameCvarTable );
 void               CheckExitRules();
 void               G_CountSpawns();
 static void        G_LogGameplayStats( int state );
+static void        G_LogFlush();
 
 // state field of G_LogGameplayStats
 enum
@@ -520,6 +532,9 @@ void G_FindEntityGroups()
 					masterEntity->names[k] = comparedEntity->names[k];
 					comparedEntity->names[k] = nullptr;
 				}
+
+				G_UpdateEntityIndex( masterEntity );
+				G_UpdateEntityIndex( comparedEntity );
 			}
 		}
 	}
@@ -794,6 +809,9 @@ void G_InitGame( int levelTime, int randomSeed, bool inClient )
 	memset( g_entities, 0, MAX_GENTITIES * sizeof( g_entities[ 0 ] ) );
 	level.gentities = g_entities;
 
+	// nothing is linked any more, so forget what the world tree held
+	G_CM_ClearWorld();
+
 	// initilize special entities so they don't need to be special cased in the CBSE code later on
 	G_InitGentityMinimal( g_entities + ENTITYNUM_NONE );
 	G_InitGentityMinimal( g_entities + ENTITYNUM_WORLD );
@@ -812,6 +830,8 @@ void G_InitGame( int levelTime, int randomSeed, bool inClient )
 	// always leave room for the max number of clients, even if they aren't all used, so numbers
 	// inside that range are NEVER anything but clients
 	level.num_entities = MAX_CLIENTS;
+	G_InitEntityFreeList();
+	G_ClearEntityIndex();
 
 	for( i = 0; i < MAX_CLIENTS; i++ )
 	{
@@ -838,6 +858,9 @@ void G_InitGame( int levelTime, int randomSeed, bool inClient )
 	// add any fake entities
 	G_SpawnFakeEntities();
 
+	// all the locations are known now
+	Team_BuildLocationTable();
+
 	BaseClustering::Init();
 
 	// load up a custom building layout if there is one
@@ -960,14 +983,24 @@ void G_ShutdownGame( int restart )
 	{
 		G_LogPrintf( "ShutdownGame:" );
 		G_LogPrintf( "------------------------------------------------------------" );
-		trap_FS_FCloseFile( level.logFile );
-		level.logFile = 0;
 	}
 
 	// finalize logging of gameplay statistics
 	if ( level.logGameplayFile )
 	{
 		G_LogGameplayStats( LOG_GAMEPLAY_STATS_FOOTER );
+	}
+
+	G_LogFlush();
+
+	if ( level.logFile )
+	{
+		trap_FS_FCloseFile( level.logFile );
+		level.logFile = 0;
+	}
+
+	if ( level.logGameplayFile )
+	{
 		trap_FS_FCloseFile( level.logGameplayFile );
 		level.logGameplayFile = 0;
 	}
@@ -1554,27 +1587,6 @@ MAP CHANGING
 ========================================================================
 */
 
-/*
-========================
-SendScoreboardMessageToAllClients
-
-Do this at BeginIntermission time and whenever ranks are recalculated
-due to enters/exits/forced team changes
-========================
-*/
-void SendScoreboardMessageToAllClients()
-{
-	int i;
-
-	for ( i = 0; i < level.maxclients; i++ )
-	{
-		if ( level.clients[ i ].pers.connected == CON_CONNECTED )
-		{
-			ScoreboardMessage( g_entities + i );
-		}
-	}
-}
-
 /*
 ========================
 MoveClientToIntermission
@@ -1794,6 +1806,84 @@ void G_AdminMessage( gentity_t *ent, const char *msg )
 	             msg );
 }
 
+/*
+=================
+Log buffers
+
+Lines for the log files are collected in fixed size buffers and written with
+a single call at the end of every frame, or as soon as a buffer gets full.
+A buffer whose write fails is dropped, and the number of entries lost is
+reported on the console. With g_logFileSync set, the game log is written
+out after every line, as before.
+=================
+*/
+#define LOG_BUFFER_SIZE 65536
+
+typedef struct
+{
+	fileHandle_t *file;
+	char         data[ LOG_BUFFER_SIZE ];
+	int          used;
+	int          entries; // number of writes held in data
+	int          dropped; // entries lost since the last report
+} logBuffer_t;
+
+static logBuffer_t gameLog = { &level.logFile };
+static logBuffer_t gameplayLog = { &level.logGameplayFile };
+
+static void G_LogBufferFlush( logBuffer_t *log )
+{
+	if ( !log->used )
+	{
+		return;
+	}
+
+	if ( !*log->file || trap_FS_Write( log->data, log->used, *log->file ) != log->used )
+	{
+		log->dropped += log->entries;
+	}
+	else if ( log->dropped )
+	{
+		Log::Warn( "%d log entries could not be written", log->dropped );
+		log->dropped = 0;
+	}
+
+	log->used = 0;
+	log->entries = 0;
+}
+
+static void G_LogBufferWrite( logBuffer_t *log, const char *text, int len )
+{
+	if ( log->used + len > LOG_BUFFER_SIZE )
+	{
+		G_LogBufferFlush( log );
+	}
+
+	// can't happen with the line sizes used here
+	if ( len > LOG_BUFFER_SIZE )
+	{
+		log->dropped++;
+		return;
+	}
+
+	memcpy( log->data + log->used, text, len );
+	log->used += len;
+	log->entries++;
+}
+
+/*
+=================
+G_LogFlush
+
+Writes out everything logged so far
+=================
+*/
+static void G_LogFlush()
+{
+	G_LogBufferFlush( &gameLog );
+	G_LogBufferFlush( &gameplayLog );
+}
+
 /*
 =================
 G_LogPrintf
@@ -1835,9 +1925,16 @@ void QDECL PRINTF_LIKE(1) G_LogPrintf( const char *fmt, ... )
 		return;
 	}
 
-	Color::StripColors( string, decolored, sizeof( decolored ) );
-	trap_FS_Write( decolored, strlen( decolored ), level.logFile );
-    trap_FS_Write( "\n", 1, level.logFile );
+	Color::StripColors( string, decolored, sizeof( decolored ) - 1 );
+	tslen = strlen( decolored );
+	decolored[ tslen++ ] = '\n';
+
+	G_LogBufferWrite( &gameLog, decolored, tslen );
+
+	if ( g_logFileSync.integer )
+	{
+		G_LogBufferFlush( &gameLog );
+	}
 }
 
 /*
@@ -2027,7 +2124,7 @@ static void G_LogGameplayStats( int state )
 			return;
 	}
 
-	trap_FS_Write( logline, strlen( logline ), level.logGameplayFile );
+	G_LogBufferWrite( &gameplayLog, logline, strlen( logline ) );
 
 	if ( state == LOG_GAMEPLAY_STATS_BODY )
 	{
@@ -2811,6 +2908,8 @@ void G_RunFrame( int levelTime )
 
 	msec = level.time - level.previousTime;
 
+	Profiler::BeginFrame();
+
 	// generate public-key messages
 	G_admin_pubkey();
 
@@ -2824,137 +2923,214 @@ void G_RunFrame( int levelTime )
 	G_CheckPmoveParamChanges();
 
 	// go through all allocated objects
-	ent = &g_entities[ 0 ];
-	for ( i = 0; i < level.num_entities; i++, ent++ )
 	{
-		if ( !ent->inuse ) continue;
+		Profiler::Scope entitiesScope( Profiler::PS_ENTITIES );
 
-		// clear events that are too old
-		if ( level.time - ent->eventTime > EVENT_VALID_MSEC )
+		ent = &g_entities[ 0 ];
+		for ( i = 0; i < level.num_entities; i++, ent++ )
 		{
-			if ( ent->s.event )
-			{
-				ent->s.event = 0; // &= EV_EVENT_BITS;
+			if ( !ent->inuse ) continue;
 
-				if ( ent->client )
+			// clear events that are too old
+			if ( level.time - ent->eventTime > EVENT_VALID_MSEC )
+			{
+				if ( ent->s.event )
 				{
-					ent->client->ps.externalEvent = 0;
-					//ent->client->ps.events[0] = 0;
-					//ent->client->ps.events[1] = 0;
+					ent->s.event = 0; // &= EV_EVENT_BITS;
+
+					if ( ent->client )
+					{
+						ent->client->ps.externalEvent = 0;
+						//ent->client->ps.events[0] = 0;
+						//ent->client->ps.events[1] = 0;
+					}
 				}
-			}
 
-			if ( ent->freeAfterEvent )
-			{
-				// tempEntities or dropped items completely go away after their event
-				G_FreeEntity( ent );
-				continue;
-			}
-			else if ( ent->unlinkAfterEvent )
-			{
-				// items that will respawn will hide themselves after their pickup event
-				ent->unlinkAfterEvent = false;
-				trap_UnlinkEntity( ent );
+				if ( ent->freeAfterEvent )
+				{
+					// tempEntities or dropped items completely go away after their event
+					G_FreeEntity( ent );
+					continue;
+				}
+				else if ( ent->unlinkAfterEvent )
+				{
+					// items that will respawn will hide themselves after their pickup event
+					ent->unlinkAfterEvent = false;
+					trap_UnlinkEntity( ent );
+				}
 			}
-		}
 
-		// temporary entities don't think
-		if ( ent->freeAfterEvent ) continue;
+			// temporary entities don't think
+			if ( ent->freeAfterEvent ) continue;
 
-		// calculate the acceleration of this entity
-		if ( ent->evaluateAcceleration ) G_EvaluateAcceleration( ent, msec );
+			// calculate the acceleration of this entity
+			if ( ent->evaluateAcceleration ) G_EvaluateAcceleration( ent, msec );
 
-		if ( !ent->r.linked && ent->neverFree ) continue;
+			if ( !ent->r.linked && ent->neverFree ) continue;
 
-		// think/run entitiy by type
-		switch ( ent->s.eType )
-		{
-			case entityType_t::ET_MISSILE:
-				G_RunMissile( ent );
-				continue;
-
-			case entityType_t::ET_BUILDABLE:
-				// TODO: Do buildables make any use of G_Physics' functionality apart from the call
-				//       to G_RunThink?
-				G_Physics( ent, msec );
-				continue;
-
-			case entityType_t::ET_CORPSE:
-				G_Physics( ent, msec );
-				continue;
-
-			case entityType_t::ET_MOVER:
-				G_RunMover( ent );
-				continue;
+			// think/run entitiy by type
+			switch ( ent->s.eType )
+			{
+				case entityType_t::ET_MISSILE:
+				{
+					Profiler::Scope scope( Profiler::PS_ENT_MISSILE );
+					G_RunMissile( ent );
+					continue;
+				}
 
-			default:
-				if ( ent->physicsObject )
+				case entityType_t::ET_BUILDABLE:
 				{
+					// TODO: Do buildables make any use of G_Physics' functionality apart from the call
+					//       to G_RunThink?
+					Profiler::Scope scope( Profiler::PS_ENT_BUILDABLE );
 					G_Physics( ent, msec );
 					continue;
 				}
-				else if ( i < MAX_CLIENTS )
+
+				case entityType_t::ET_CORPSE:
 				{
-					G_RunClient( ent );
+					Profiler::Scope scope( Profiler::PS_ENT_CORPSE );
+					G_Physics( ent, msec );
 					continue;
 				}
-				else
+
+				case entityType_t::ET_MOVER:
 				{
-					G_RunThink( ent );
+					Profiler::Scope scope( Profiler::PS_ENT_MOVER );
+					G_RunMover( ent );
+					continue;
+				}
 
-					// allow entities to free themselves before acting
-					if ( ent->inuse )
+				default:
+					if ( ent->physicsObject )
 					{
-						// TODO: Is this even used/necessary?
-						//       Why do only randomly chose entities do this?
-						G_RunAct( ent );
+						Profiler::Scope scope( Profiler::PS_ENT_PHYSICS );
+						G_Physics( ent, msec );
+						continue;
 					}
-				}
+					else if ( i < MAX_CLIENTS )
+					{
+						Profiler::Scope scope( Profiler::PS_ENT_CLIENT );
+						G_RunClient( ent );
+						continue;
+					}
+					else
+					{
+						Profiler::Scope scope( Profiler::PS_ENT_THINK );
+						G_RunThink( ent );
+
+						// allow entities to free themselves before acting
+						if ( ent->inuse )
+						{
+							// TODO: Is this even used/necessary?
+							//       Why do only randomly chose entities do this?
+							G_RunAct( ent );
+						}
+					}
+			}
 		}
 	}
 
 	// perform final fixups on the players
-	ent = &g_entities[ 0 ];
-
-	for ( i = 0; i < level.maxclients; i++, ent++ )
 	{
-		if ( ent->inuse )
+		Profiler::Scope scope( Profiler::PS_CLIENT_END_FRAME );
+
+		ent = &g_entities[ 0 ];
+
+		for ( i = 0; i < level.maxclients; i++, ent++ )
 		{
-			ClientEndFrame( ent );
+			if ( ent->inuse )
+			{
+				ClientEndFrame( ent );
+			}
 		}
 	}
 
 	// save position information for all active clients
-	G_UnlaggedStore();
+	{
+		Profiler::Scope scope( Profiler::PS_UNLAGGED_STORE );
+		G_UnlaggedStore();
+	}
+
+	{
+		Profiler::Scope scope( Profiler::PS_COUNT_SPAWNS );
+		G_CountSpawns();
+	}
+
+	{
+		Profiler::Scope scope( Profiler::PS_POWER_STATE );
+		G_SetHumanBuildablePowerState();
+	}
+
+	{
+		Profiler::Scope scope( Profiler::PS_MINE_BUILD_POINTS );
+		G_MineBuildPoints();
+	}
+
+	{
+		Profiler::Scope scope( Profiler::PS_MOMENTUM );
+		G_DecreaseMomentum();
+	}
 
-	G_CountSpawns();
-	G_SetHumanBuildablePowerState();
-	G_MineBuildPoints();
-	G_DecreaseMomentum();
 	G_CalculateAvgPlayers();
-	G_SpawnClients( TEAM_ALIENS );
-	G_SpawnClients( TEAM_HUMANS );
-	G_UpdateZaps( msec );
-	Beacon::Frame( );
 
-	G_PrepareEntityNetCode();
+	{
+		Profiler::Scope scope( Profiler::PS_SPAWN_CLIENTS );
+		G_SpawnClients( TEAM_ALIENS );
+		G_SpawnClients( TEAM_HUMANS );
+	}
+
+	{
+		Profiler::Scope scope( Profiler::PS_ZAPS );
+		G_UpdateZaps( msec );
+	}
+
+	{
+		Profiler::Scope scope( Profiler::PS_BEACONS );
+		Beacon::Frame( );
+	}
+
+	{
+		Profiler::Scope scope( Profiler::PS_NETCODE );
+		G_PrepareEntityNetCode();
+	}
 
 	// log gameplay statistics
-	G_LogGameplayStats( LOG_GAMEPLAY_STATS_BODY );
+	{
+		Profiler::Scope scope( Profiler::PS_GAMEPLAY_STATS );
+		G_LogGameplayStats( LOG_GAMEPLAY_STATS_BODY );
+	}
 
 	// see if it is time to end the level
-	CheckExitRules();
+	{
+		Profiler::Scope scope( Profiler::PS_EXIT_RULES );
+		CheckExitRules();
+	}
 
 	// update to team status?
-	CheckTeamStatus();
+	{
+		Profiler::Scope scope( Profiler::PS_TEAM_STATUS );
+		CheckTeamStatus();
+	}
 
 	// cancel vote if timed out
-	for ( i = 0; i < NUM_TEAMS; i++ )
 	{
-		G_CheckVote( (team_t) i );
+		Profiler::Scope scope( Profiler::PS_VOTES );
+
+		for ( i = 0; i < NUM_TEAMS; i++ )
+		{
+			G_CheckVote( (team_t) i );
+		}
+	}
+
+	{
+		Profiler::Scope scope( Profiler::PS_BOT_OBSTACLES );
+		trap_BotUpdateObstacles();
 	}
 
-	trap_BotUpdateObstacles();
+	G_LogFlush();
+
+	Profiler::EndFrame();
 	level.frameMsec = trap_Milliseconds();
 }
 
@@ -25,6 +25,8 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "sg_local.h"
 
+#include <vector>
+
 #define MAX_MAP_ROTATIONS     64
 #define MAX_MAP_ROTATION_MAPS 256
 
@@ -48,7 +50,7 @@ typedef enum
 
 typedef struct condition_s
 {
-	struct rotationNode_s       *target;
+	int                 target; // index in mapRotationNodes
 
 	conditionVariable_t lhs;
 	conditionOperator_t operator_;
@@ -63,11 +65,18 @@ typedef struct map_s
 
 	char postCommand[ MAX_STRING_CHARS ];
 	char layouts[ MAX_CVAR_VALUE_STRING ];
+
+	bool exists; // looked up on every load, never cached
 } mrMapDescription_t;
 
 typedef struct label_s
 {
 	char name[ MAX_QPATH ];
+
+	// where a goto or resume leads, resolved at load
+	int  rotation; // rotation of that name, or -1
+	int  label;    // position of the label of that name, or -1
+	int  map;      // position of the next map of that name, or -1
 } mrLabel_t;
 
 typedef enum
@@ -96,7 +105,7 @@ typedef struct mapRotation_s
 {
 	char   name[ MAX_QPATH ];
 
-	mrNode_t *nodes[ MAX_MAP_ROTATION_MAPS ];
+	int      nodes[ MAX_MAP_ROTATION_MAPS ]; // indices in mapRotationNodes
 	int      numNodes;
 	int      currentNode;
 } mapRotation_t;
@@ -109,8 +118,25 @@ typedef struct mapRotations_s
 
 static mapRotations_t mapRotations;
 
+// every node of every rotation, condition targets included
+static std::vector<mrNode_t> mapRotationNodes;
+
+#define MAP_ROTATION_CACHE_VERSION 1
+
+typedef struct
+{
+	char     magic[ 4 ];
+	int      version;
+	unsigned hash; // of the rotation file's text
+	int      length;
+	int      nodeSize;
+	int      numRotations;
+	int      numNodes;
+} mapRotationCacheHeader_t;
+
 static int            G_CurrentNodeIndex( int rotation );
 static int            G_NodeIndexAfter( int currentNode, int rotation );
+static void           G_SwitchMapRotation( int rotation, bool advance, bool putOnStack, bool reset_index, int depth );
 
 /*
 ===============
@@ -150,48 +176,50 @@ static bool G_RotationExists( const char *name )
 
 /*
 ===============
-G_LabelExists
+G_RotationIndex
 
-Check if a label exists in a rotation
+Find a rotation by name
 ===============
 */
-static bool G_LabelExists( int rotation, const char *name )
+static int G_RotationIndex( const char *name )
 {
-	mapRotation_t *mr = &mapRotations.rotations[ rotation ];
-	int           i;
+	int i;
 
-	for ( i = 0; i < mr->numNodes; i++ )
+	for ( i = 0; i < mapRotations.numRotations; i++ )
 	{
-		mrNode_t *node = mr->nodes[ i ];
-
-		if ( node->type == NT_LABEL &&
-		     !Q_stricmp( name, node->u.label.name ) )
-		{
-			return true;
-		}
-
-		if ( node->type == NT_MAP &&
-		     !Q_stricmp( name, node->u.map.name ) )
+		if ( !Q_stricmp( mapRotations.rotations[ i ].name, name ) )
 		{
-			return true;
+			return i;
 		}
 	}
 
-	return false;
+	return -1;
+}
+
+/*
+===============
+G_Node
+
+Return a node by its index in mapRotationNodes
+===============
+*/
+static mrNode_t *G_Node( int index )
+{
+	return &mapRotationNodes[ index ];
 }
 
 /*
 ===============
 G_AllocateNode
 
-Allocate memory for a mrNode_t
+Allocate a zeroed mrNode_t, returning its index
 ===============
 */
-static mrNode_t *G_AllocateNode()
+static int G_AllocateNode()
 {
-	mrNode_t *node = (mrNode_t*) BG_Alloc( sizeof( mrNode_t ) );
+	mapRotationNodes.emplace_back();
 
-	return node;
+	return mapRotationNodes.size() - 1;
 }
 
 /*
@@ -270,14 +298,14 @@ G_ParseNode
 Parse a node
 ===============
 */
-static bool G_ParseNode( mrNode_t **node, char *token, const char **text_p, bool conditional )
+static bool G_ParseNode( int *node, char *token, const char **text_p, bool conditional )
 {
 	if ( !Q_stricmp( token, "if" ) )
 	{
 		mrCondition_t *condition;
 
-		( *node )->type = NT_CONDITION;
-		condition = & ( *node )->u.condition;
+		G_Node( *node )->type = NT_CONDITION;
+		condition = &G_Node( *node )->u.condition;
 
 		token = COM_Parse( text_p );
 
@@ -366,14 +394,17 @@ static bool G_ParseNode( mrNode_t **node, char *token, const char **text_p, bool
 			return false;
 		}
 
-		condition->target = G_AllocateNode();
-		*node = condition->target;
+		// allocating may move the nodes, so condition is stale after this
+		int target = G_AllocateNode();
+
+		G_Node( *node )->u.condition.target = target;
+		*node = target;
 
 		return G_ParseNode( node, token, text_p, true );
 	}
 	else if ( !Q_stricmp( token, "return" ) )
 	{
-		( *node )->type = NT_RETURN;
+		G_Node( *node )->type = NT_RETURN;
 	}
 	else if ( !Q_stricmp( token, "goto" ) ||
 	          !Q_stricmp( token, "resume" ) )
@@ -382,14 +413,14 @@ static bool G_ParseNode( mrNode_t **node, char *token, const char **text_p, bool
 
 		if ( !Q_stricmp( token, "goto" ) )
 		{
-			( *node )->type = NT_GOTO;
+			G_Node( *node )->type = NT_GOTO;
 		}
 		else
 		{
-			( *node )->type = NT_RESUME;
+			G_Node( *node )->type = NT_RESUME;
 		}
 
-		label = & ( *node )->u.label;
+		label = &G_Node( *node )->u.label;
 
 		token = COM_Parse( text_p );
 
@@ -400,22 +431,24 @@ static bool G_ParseNode( mrNode_t **node, char *token, const char **text_p, bool
 		}
 
 		Q_strncpyz( label->name, token, sizeof( label->name ) );
+		label->rotation = label->label = label->map = -1;
 	}
 	else if ( *token == '#' || conditional )
 	{
 		mrLabel_t *label;
 
-		( *node )->type = ( conditional ) ? NT_GOTO : NT_LABEL;
-		label = & ( *node )->u.label;
+		G_Node( *node )->type = ( conditional ) ? NT_GOTO : NT_LABEL;
+		label = &G_Node( *node )->u.label;
 
 		Q_strncpyz( label->name, token, sizeof( label->name ) );
+		label->rotation = label->label = label->map = -1;
 	}
 	else
 	{
 		mrMapDescription_t *map;
 
-		( *node )->type = NT_MAP;
-		map = & ( *node )->u.map;
+		G_Node( *node )->type = NT_MAP;
+		map = &G_Node( *node )->u.map;
 
 		Q_strncpyz( map->name, token, sizeof( map->name ) );
 		map->postCommand[ 0 ] = '\0';
@@ -434,7 +467,7 @@ Parse a map rotation section
 static bool G_ParseMapRotation( mapRotation_t *mr, const char **text_p )
 {
 	char   *token;
-	mrNode_t *node = nullptr;
+	int    node = -1;
 
 	// read optional parameters
 	while ( 1 )
@@ -448,13 +481,13 @@ static bool G_ParseMapRotation( mapRotation_t *mr, const char **text_p )
 
 		if ( !Q_stricmp( token, "{" ) )
 		{
-			if ( node == nullptr )
+			if ( node < 0 )
 			{
 				Log::Warn("map command section with no associated map" );
 				return false;
 			}
 
-			if ( !G_ParseMapCommandSection( node, text_p ) )
+			if ( !G_ParseMapCommandSection( G_Node( node ), text_p ) )
 			{
 				Log::Warn("failed to parse map command section" );
 				return false;
@@ -487,6 +520,311 @@ static bool G_ParseMapRotation( mapRotation_t *mr, const char **text_p )
 	return false;
 }
 
+/*
+===============
+G_ResolveMapRotations
+
+Resolve goto and resume destinations to rotation and node indices, so
+following them at map change takes no string comparisons
+===============
+*/
+static bool G_ResolveMapRotations()
+{
+	int i, j, k;
+
+	for ( i = 0; i < mapRotations.numRotations; i++ )
+	{
+		mapRotation_t *mr = &mapRotations.rotations[ i ];
+		int           mapCount = 0;
+
+		for ( j = 0; j < mr->numNodes; j++ )
+		{
+			mrNode_t  *node = G_Node( mr->nodes[ j ] );
+			mrLabel_t *label;
+
+			if ( node->type == NT_MAP )
+			{
+				mapCount++;
+				continue;
+			}
+
+			while ( node->type == NT_CONDITION )
+			{
+				node = G_Node( node->u.condition.target );
+			}
+
+			if ( node->type != NT_GOTO && node->type != NT_RESUME )
+			{
+				continue;
+			}
+
+			label = &node->u.label;
+			label->rotation = G_RotationIndex( label->name );
+			label->label = label->map = -1;
+
+			for ( k = 0; k < mr->numNodes; k++ )
+			{
+				mrNode_t *target = G_Node( mr->nodes[ k ] );
+
+				if ( target->type == NT_LABEL && !Q_stricmp( target->u.label.name, label->name ) )
+				{
+					label->label = k;
+					break;
+				}
+			}
+
+			// maps are searched starting from the entry after this one
+			for ( k = 1; k <= mr->numNodes; k++ )
+			{
+				int      index = ( j + k ) % mr->numNodes;
+				mrNode_t *target = G_Node( mr->nodes[ index ] );
+
+				if ( target->type == NT_MAP && !Q_stricmp( target->u.map.name, label->name ) )
+				{
+					label->map = index;
+					break;
+				}
+			}
+
+			if ( label->rotation < 0 && label->label < 0 && label->map < 0 )
+			{
+				Log::Warn("goto destination named \"%s\" doesn't exist",
+				          label->name );
+				return false;
+			}
+		}
+
+		if ( mapCount == 0 )
+		{
+			Log::Warn("rotation \"%s\" needs at least one map entry",
+			          mr->name );
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+===============
+G_CheckRotationMaps
+
+Look up which rotation maps are installed, once per load rather than on
+every map change or listing
+===============
+*/
+static bool G_CheckRotationMaps()
+{
+	bool ok = true;
+
+	for ( mrNode_t &node : mapRotationNodes )
+	{
+		if ( node.type != NT_MAP )
+		{
+			continue;
+		}
+
+		node.u.map.exists = G_MapExists( node.u.map.name );
+
+		if ( !node.u.map.exists )
+		{
+			Log::Warn("rotation map \"%s\" doesn't exist",
+			          node.u.map.name );
+			ok = false;
+		}
+	}
+
+	return ok;
+}
+
+/*
+===============
+G_WriteMapRotationCache
+
+Save the resolved rotations, so that they can be loaded without parsing
+while the rotation file stays the same
+===============
+*/
+static void G_WriteMapRotationCache( const char *cacheName, unsigned hash, int length )
+{
+	mapRotationCacheHeader_t header;
+	fileHandle_t             f;
+
+	if ( trap_FS_FOpenFile( cacheName, &f, fsMode_t::FS_WRITE_VIA_TEMPORARY ) < 0 )
+	{
+		return;
+	}
+
+	memcpy( header.magic, "MRC", 4 );
+	header.version = MAP_ROTATION_CACHE_VERSION;
+	header.hash = hash;
+	header.length = length;
+	header.nodeSize = sizeof( mrNode_t );
+	header.numRotations = mapRotations.numRotations;
+	header.numNodes = mapRotationNodes.size();
+
+	trap_FS_Write( &header, sizeof( header ), f );
+	trap_FS_Write( mapRotations.rotations, mapRotations.numRotations * sizeof( mapRotation_t ), f );
+	trap_FS_Write( mapRotationNodes.data(), mapRotationNodes.size() * sizeof( mrNode_t ), f );
+	trap_FS_FCloseFile( f );
+}
+
+/*
+===============
+G_CachedStringValid
+
+Check that a string loaded from the cache ends inside its buffer
+===============
+*/
+static bool G_CachedStringValid( const char *string, size_t size )
+{
+	return memchr( string, '\0', size ) != nullptr;
+}
+
+/*
+===============
+G_CheckCachedRotation
+
+Check that every index a rotation's nodes hold is in range and that
+every string they hold is terminated. Condition targets are always
+allocated after their condition, so requiring them to point forward
+also rules out loops in the condition chains.
+===============
+*/
+static bool G_CheckCachedRotation( const mapRotation_t *mr, int numNodes )
+{
+	int j;
+
+	if ( mr->numNodes < 1 || mr->numNodes > MAX_MAP_ROTATION_MAPS ||
+	     !G_CachedStringValid( mr->name, sizeof( mr->name ) ) )
+	{
+		return false;
+	}
+
+	for ( j = 0; j < mr->numNodes; j++ )
+	{
+		int            index = mr->nodes[ j ];
+		const mrNode_t *node;
+
+		if ( index < 0 || index >= numNodes )
+		{
+			return false;
+		}
+
+		node = G_Node( index );
+
+		while ( node->type == NT_CONDITION )
+		{
+			int target = node->u.condition.target;
+
+			if ( target <= index || target >= numNodes )
+			{
+				return false;
+			}
+
+			index = target;
+			node = G_Node( index );
+		}
+
+		if ( node->type < NT_MAP || node->type > NT_RETURN )
+		{
+			return false;
+		}
+
+		if ( node->type == NT_MAP )
+		{
+			const mrMapDescription_t *map = &node->u.map;
+
+			if ( !G_CachedStringValid( map->name, sizeof( map->name ) ) ||
+			     !G_CachedStringValid( map->postCommand, sizeof( map->postCommand ) ) ||
+			     !G_CachedStringValid( map->layouts, sizeof( map->layouts ) ) )
+			{
+				return false;
+			}
+		}
+
+		if ( ( node->type == NT_GOTO || node->type == NT_RESUME || node->type == NT_LABEL ) &&
+		     !G_CachedStringValid( node->u.label.name, sizeof( node->u.label.name ) ) )
+		{
+			return false;
+		}
+
+		if ( node->type == NT_GOTO || node->type == NT_RESUME )
+		{
+			const mrLabel_t *label = &node->u.label;
+
+			if ( label->rotation < -1 || label->rotation >= mapRotations.numRotations ||
+			     label->label < -1 || label->label >= mr->numNodes ||
+			     label->map < -1 || label->map >= mr->numNodes )
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+/*
+===============
+G_ReadMapRotationCache
+
+Load the rotations saved by G_WriteMapRotationCache, if they were made
+from the same rotation file
+===============
+*/
+static bool G_ReadMapRotationCache( const char *cacheName, unsigned hash, int length )
+{
+	mapRotationCacheHeader_t header;
+	fileHandle_t             f;
+	int                      len, i;
+
+	len = trap_FS_FOpenFile( cacheName, &f, fsMode_t::FS_READ );
+
+	if ( len < 0 )
+	{
+		return false;
+	}
+
+	if ( len < (int) sizeof( header ) )
+	{
+		trap_FS_FCloseFile( f );
+		return false;
+	}
+
+	trap_FS_Read( &header, sizeof( header ), f );
+
+	if ( memcmp( header.magic, "MRC", 4 ) || header.version != MAP_ROTATION_CACHE_VERSION ||
+	     header.hash != hash || header.length != length || header.nodeSize != sizeof( mrNode_t ) ||
+	     header.numRotations < 0 || header.numRotations > MAX_MAP_ROTATIONS || header.numNodes < 0 ||
+	     len != (int) ( sizeof( header ) + header.numRotations * sizeof( mapRotation_t ) +
+	                    header.numNodes * sizeof( mrNode_t ) ) )
+	{
+		trap_FS_FCloseFile( f );
+		return false;
+	}
+
+	mapRotationNodes.resize( header.numNodes );
+	trap_FS_Read( mapRotations.rotations, header.numRotations * sizeof( mapRotation_t ), f );
+	trap_FS_Read( mapRotationNodes.data(), header.numNodes * sizeof( mrNode_t ), f );
+	trap_FS_FCloseFile( f );
+
+	mapRotations.numRotations = header.numRotations;
+
+	// don't trust indices from disk
+	for ( i = 0; i < mapRotations.numRotations; i++ )
+	{
+		if ( !G_CheckCachedRotation( &mapRotations.rotations[ i ], header.numNodes ) )
+		{
+			Log::Warn( "ignoring corrupt map rotation cache %s", cacheName );
+			G_ShutdownMapRotations();
+			return false;
+		}
+	}
+
+	return true;
+}
+
 /*
 ===============
 G_ParseMapRotationFile
@@ -497,11 +835,12 @@ Load the map rotations from a map rotation file
 static bool G_ParseMapRotationFile( const char *fileName )
 {
 	const char *text_p;
-	int          i, j;
 	int          len;
+	unsigned     hash;
 	char         *token;
 	char         text[ 20000 ];
 	char         mrName[ MAX_QPATH ];
+	char         cacheName[ MAX_QPATH ];
 	bool     mrNameSet = false;
 	fileHandle_t f;
 
@@ -525,6 +864,14 @@ static bool G_ParseMapRotationFile( const char *fileName )
 	text[ len ] = 0;
 	trap_FS_FCloseFile( f );
 
+	hash = BG_Hash( text, len );
+	Com_sprintf( cacheName, sizeof( cacheName ), "%s.cache", fileName );
+
+	if ( G_ReadMapRotationCache( cacheName, hash, len ) )
+	{
+		return G_CheckRotationMaps();
+	}
+
 	// parse the text
 	text_p = text;
 
@@ -590,63 +937,14 @@ static bool G_ParseMapRotationFile( const char *fileName )
 		}
 	}
 
-	for ( i = 0; i < mapRotations.numRotations; i++ )
+	if ( !G_ResolveMapRotations() )
 	{
-		mapRotation_t *mr = &mapRotations.rotations[ i ];
-		int           mapCount = 0;
-
-		for ( j = 0; j < mr->numNodes; j++ )
-		{
-			mrNode_t *node = mr->nodes[ j ];
-
-			if ( node->type == NT_MAP )
-			{
-				mapCount++;
-
-				if ( !G_MapExists( node->u.map.name ) )
-				{
-					Log::Warn("rotation map \"%s\" doesn't exist",
-					          node->u.map.name );
-					return false;
-				}
-
-				continue;
-			}
-			else if ( node->type == NT_RETURN )
-			{
-				continue;
-			}
-			else if ( node->type == NT_LABEL )
-			{
-				continue;
-			}
-			else
-			{
-				while ( node->type == NT_CONDITION )
-				{
-					node = node->u.condition.target;
-				}
-			}
-
-			if ( ( node->type == NT_GOTO || node->type == NT_RESUME ) &&
-			     !G_LabelExists( i, node->u.label.name ) &&
-			     !G_RotationExists( node->u.label.name ) )
-			{
-				Log::Warn("goto destination named \"%s\" doesn't exist",
-				          node->u.label.name );
-				return false;
-			}
-		}
-
-		if ( mapCount == 0 )
-		{
-			Log::Warn("rotation \"%s\" needs at least one map entry",
-			          mr->name );
-			return false;
-		}
+		return false;
 	}
 
-	return true;
+	G_WriteMapRotationCache( cacheName, hash, len );
+
+	return G_CheckRotationMaps();
 }
 
 // Some constants for map rotation listing
@@ -730,13 +1028,13 @@ void G_PrintRotations()
 
 		for ( j = 0; j < mr->numNodes; j++ )
 		{
-			mrNode_t *node = mr->nodes[ j ];
+			mrNode_t *node = G_Node( mr->nodes[ j ] );
 			int    indentation = 2;
 
 			while ( node->type == NT_CONDITION )
 			{
 				Log::Notice( "%*s%s", indentation, "", G_RotationNode_ToString( node ) );
-				node = node->u.condition.target;
+				node = G_Node( node->u.condition.target );
 
 				size += sizeof( mrNode_t );
 
@@ -791,14 +1089,16 @@ void G_PrintCurrentRotation( gentity_t *ent )
 	ADMBP_begin();
 	ADMBP( va( "%s:\n", mapRotation->name ) );
 
-	while ( ( node = mapRotation->nodes[ i++ ] ) )
+	while ( i < mapRotation->numNodes )
 	{
 		const char *colour = MAP_DEFAULT;
 		int         indentation = 7;
 		bool    currentMap = false;
 		bool    override = false;
 
-		if ( node->type == NT_MAP && !G_MapExists( node->u.map.name ) )
+		node = G_Node( mapRotation->nodes[ i++ ] );
+
+		if ( node->type == NT_MAP && !node->u.map.exists )
 		{
 			colour = MAP_BAD;
 		}
@@ -820,7 +1120,7 @@ void G_PrintCurrentRotation( gentity_t *ent )
 
 		while ( node->type == NT_CONDITION )
 		{
-			node = node->u.condition.target;
+			node = G_Node( node->u.condition.target );
 			ADMBP( va( "%*s%s%s\n", indentation, "", colour, G_RotationNode_ToString( node ) ) );
 			indentation += 2;
 		}
@@ -940,6 +1240,11 @@ static char *G_RotationNameByIndex( int index )
 	return nullptr;
 }
 
+// g_mapRotationNodes is only reparsed when it changes
+static int  currentNode[ MAX_MAP_ROTATIONS ];
+static int  currentNodeModificationCount;
+static bool currentNodeParsed = false;
+
 /*
 ===============
 G_CurrentNodeIndexArray
@@ -949,11 +1254,17 @@ Fill a static array with the current node of each rotation
 */
 static int *G_CurrentNodeIndexArray()
 {
-	static int currentNode[ MAX_MAP_ROTATIONS ];
 	int        i = 0;
 	char       text[ MAX_MAP_ROTATIONS * 2 ];
 	const char       *text_p, *token;
 
+	if ( currentNodeParsed && currentNodeModificationCount == g_mapRotationNodes.modificationCount )
+	{
+		return currentNode;
+	}
+
+	currentNodeParsed = true;
+	currentNodeModificationCount = g_mapRotationNodes.modificationCount;
 	Q_strncpyz( text, g_mapRotationNodes.string, sizeof( text ) );
 
 	text_p = text;
@@ -995,6 +1306,9 @@ static void G_SetCurrentNodeByIndex( int currentNode, int rotation )
 
 	trap_Cvar_Set( "g_mapRotationNodes", text );
 	trap_Cvar_Update( &g_mapRotationNodes );
+
+	// the array already holds what was just set
+	currentNodeModificationCount = g_mapRotationNodes.modificationCount;
 }
 
 /*
@@ -1023,7 +1337,7 @@ static mrNode_t *G_NodeByIndex( int index, int rotation )
 	if ( rotation >= 0 && rotation < mapRotations.numRotations &&
 	     index >= 0 && index < mapRotations.rotations[ rotation ].numNodes )
 	{
-		return mapRotations.rotations[ rotation ].nodes[ index ];
+		return G_Node( mapRotations.rotations[ rotation ].nodes[ index ] );
 	}
 
 	return nullptr;
@@ -1038,7 +1352,7 @@ Send commands to the server to actually change the map
 */
 static void G_IssueMapChange( int index, int rotation )
 {
-	mrNode_t *node = mapRotations.rotations[ rotation ].nodes[ index ];
+	mrNode_t *node = G_Node( mapRotations.rotations[ rotation ].nodes[ index ] );
 	mrMapDescription_t  *map = &node->u.map;
 	char currentMapName[ MAX_STRING_CHARS ];
 
@@ -1084,46 +1398,33 @@ static void G_IssueMapChange( int index, int rotation )
 ===============
 G_GotoLabel
 
-Resolve the label of some condition
+Follow the resolved destination of a goto or resume
 ===============
 */
-static bool G_GotoLabel( int rotation, int nodeIndex, char *name,
+static bool G_GotoLabel( int rotation, const mrLabel_t *label,
                              bool reset_index, int depth )
 {
-	mrNode_t *node;
-	int    i;
-
-	// Search the rotation names...
-	if ( G_StartMapRotation( name, true, true, reset_index, depth ) )
+	// rotation names first...
+	if ( label->rotation >= 0 )
 	{
+		G_SwitchMapRotation( label->rotation, true, true, reset_index, depth );
 		return true;
 	}
 
-	// ...then try labels in the rotation
-	for ( i = 0; i < mapRotations.rotations[ rotation ].numNodes; i++ )
+	// ...then labels in the rotation...
+	if ( label->label >= 0 )
 	{
-		node = mapRotations.rotations[ rotation ].nodes[ i ];
-
-		if ( node->type == NT_LABEL && !Q_stricmp( node->u.label.name, name ) )
-		{
-			G_SetCurrentNodeByIndex( G_NodeIndexAfter( i, rotation ), rotation );
-			G_AdvanceMapRotation( depth );
-			return true;
-		}
+		G_SetCurrentNodeByIndex( G_NodeIndexAfter( label->label, rotation ), rotation );
+		G_AdvanceMapRotation( depth );
+		return true;
 	}
 
-	// finally check for a map by name
-	for ( i = 0; i < mapRotations.rotations[ rotation ].numNodes; i++ )
+	// ...and finally maps by name
+	if ( label->map >= 0 )
 	{
-		nodeIndex = G_NodeIndexAfter( nodeIndex, rotation );
-		node = mapRotations.rotations[ rotation ].nodes[ nodeIndex ];
-
-		if ( node->type == NT_MAP && !Q_stricmp( node->u.map.name, name ) )
-		{
-			G_SetCurrentNodeByIndex( nodeIndex, rotation );
-			G_AdvanceMapRotation( depth );
-			return true;
-		}
+		G_SetCurrentNodeByIndex( label->map, rotation );
+		G_AdvanceMapRotation( depth );
+		return true;
 	}
 
 	return false;
@@ -1133,55 +1434,47 @@ static bool G_GotoLabel( int rotation, int nodeIndex, char *name,
 ===============
 G_EvaluateMapCondition
 
-Evaluate a map condition
+Evaluate a single map condition
 ===============
 */
-static bool G_EvaluateMapCondition( mrCondition_t **condition )
+static bool G_EvaluateMapCondition( const mrCondition_t *condition )
 {
-	bool    result = false;
-	mrCondition_t *localCondition = *condition;
+	bool result = false;
 
-	switch ( localCondition->lhs )
+	switch ( condition->lhs )
 	{
 		case CV_RANDOM:
 			result = rand() / ( RAND_MAX / 2 + 1 );
 			break;
 
 		case CV_NUMCLIENTS:
-			switch ( localCondition->operator_ )
+			switch ( condition->operator_ )
 			{
 				case CO_LT:
-					result = level.numConnectedClients < localCondition->numClients;
+					result = level.numConnectedClients < condition->numClients;
 					break;
 
 				case CO_GT:
-					result = level.numConnectedClients > localCondition->numClients;
+					result = level.numConnectedClients > condition->numClients;
 					break;
 
 				case CO_EQ:
-					result = level.numConnectedClients == localCondition->numClients;
+					result = level.numConnectedClients == condition->numClients;
 					break;
 			}
 
 			break;
 
 		case CV_LASTWIN:
-			result = level.lastWin == localCondition->lastWin;
+			result = level.lastWin == condition->lastWin;
 			break;
 
 		default:
 		case CV_ERR:
-			Log::Warn("malformed map switch localCondition" );
+			Log::Warn("malformed map switch condition" );
 			break;
 	}
 
-	if ( localCondition->target->type == NT_CONDITION )
-	{
-		*condition = &localCondition->target->u.condition;
-
-		return result && G_EvaluateMapCondition( condition );
-	}
-
 	return result;
 }
 
@@ -1207,7 +1500,6 @@ Run one node of a map rotation
 bool G_StepMapRotation( int rotation, int nodeIndex, int depth )
 {
 	mrNode_t      *node;
-	mrCondition_t *condition;
 	int         returnRotation;
 	bool    step = true;
 
@@ -1236,11 +1528,14 @@ bool G_StepMapRotation( int rotation, int nodeIndex, int depth )
 		switch ( node->type )
 		{
 			case NT_CONDITION:
-				condition = &node->u.condition;
+				// nested conditions must all hold
+				while ( node->type == NT_CONDITION && G_EvaluateMapCondition( &node->u.condition ) )
+				{
+					node = G_Node( node->u.condition.target );
+				}
 
-				if ( G_EvaluateMapCondition( &condition ) )
+				if ( node->type != NT_CONDITION )
 				{
-					node = condition->target;
 					step = true;
 					continue;
 				}
@@ -1255,9 +1550,9 @@ bool G_StepMapRotation( int rotation, int nodeIndex, int depth )
 					G_SetCurrentNodeByIndex(
 					  G_NodeIndexAfter( nodeIndex, rotation ), rotation );
 
-					if ( G_StartMapRotation( G_RotationNameByIndex( returnRotation ),
-					                         true, false, false, depth ) )
+					if ( returnRotation < mapRotations.numRotations )
 					{
+						G_SwitchMapRotation( returnRotation, true, false, false, depth );
 						return false;
 					}
 				}
@@ -1265,7 +1560,7 @@ bool G_StepMapRotation( int rotation, int nodeIndex, int depth )
 				break;
 
 			case NT_MAP:
-				if ( G_MapExists( node->u.map.name ) )
+				if ( node->u.map.exists )
 				{
 					G_SetCurrentNodeByIndex(
 					  G_NodeIndexAfter( nodeIndex, rotation ), rotation );
@@ -1290,7 +1585,7 @@ bool G_StepMapRotation( int rotation, int nodeIndex, int depth )
 				G_SetCurrentNodeByIndex(
 				  G_NodeIndexAfter( nodeIndex, rotation ), rotation );
 
-				if ( G_GotoLabel( rotation, nodeIndex, node->u.label.name,
+				if ( G_GotoLabel( rotation, &node->u.label,
 				                  ( node->type == NT_GOTO ), depth ) )
 				{
 					return false;
@@ -1352,51 +1647,54 @@ void G_AdvanceMapRotation( int depth )
 
 /*
 ===============
-G_StartMapRotation
+G_SwitchMapRotation
 
-Switch to a new map rotation
+Switch to a new map rotation by index
 ===============
 */
-bool G_StartMapRotation( const char *name, bool advance,
-                             bool putOnStack, bool reset_index, int depth )
+static void G_SwitchMapRotation( int rotation, bool advance,
+                                 bool putOnStack, bool reset_index, int depth )
 {
-	int i;
 	int currentRotation = g_currentMapRotation.integer;
 
-	for ( i = 0; i < mapRotations.numRotations; i++ )
+	if ( putOnStack && currentRotation >= 0 )
 	{
-		if ( !Q_stricmp( mapRotations.rotations[ i ].name, name ) )
-		{
-			if ( putOnStack && currentRotation >= 0 )
-			{
-				G_PushRotationStack( currentRotation );
-			}
-
-			trap_Cvar_Set( "g_currentMapRotation", va( "%d", i ) );
-			trap_Cvar_Update( &g_currentMapRotation );
-
-			if ( advance )
-			{
-				if ( reset_index )
-				{
-					G_SetCurrentNodeByIndex( 0, i );
-				}
+		G_PushRotationStack( currentRotation );
+	}
 
-				G_AdvanceMapRotation( depth );
-			}
+	trap_Cvar_Set( "g_currentMapRotation", va( "%d", rotation ) );
+	trap_Cvar_Update( &g_currentMapRotation );
 
-			break;
+	if ( advance )
+	{
+		if ( reset_index )
+		{
+			G_SetCurrentNodeByIndex( 0, rotation );
 		}
+
+		G_AdvanceMapRotation( depth );
 	}
+}
+
+/*
+===============
+G_StartMapRotation
+
+Switch to a new map rotation
+===============
+*/
+bool G_StartMapRotation( const char *name, bool advance,
+                             bool putOnStack, bool reset_index, int depth )
+{
+	int rotation = G_RotationIndex( name );
 
-	if ( i == mapRotations.numRotations )
+	if ( rotation < 0 )
 	{
 		return false;
 	}
-	else
-	{
-		return true;
-	}
+
+	G_SwitchMapRotation( rotation, advance, putOnStack, reset_index, depth );
+	return true;
 }
 
 /*
@@ -1460,23 +1758,6 @@ void G_InitMapRotations()
 	}
 }
 
-/*
-===============
-G_FreeNode
-
-Free up memory used by a node
-===============
-*/
-void G_FreeNode( mrNode_t *node )
-{
-	if ( node->type == NT_CONDITION )
-	{
-		G_FreeNode( node->u.condition.target );
-	}
-
-	BG_Free( node );
-}
-
 /*
 ===============
 G_ShutdownMapRotations
@@ -1486,19 +1767,6 @@ Free up memory used by map rotations
 */
 void G_ShutdownMapRotations()
 {
-	int i, j;
-
-	for ( i = 0; i < mapRotations.numRotations; i++ )
-	{
-		mapRotation_t *mr = &mapRotations.rotations[ i ];
-
-		for ( j = 0; j < mr->numNodes; j++ )
-		{
-			mrNode_t *node = mr->nodes[ j ];
-
-			G_FreeNode( node );
-		}
-	}
-
+	mapRotationNodes.clear();
 	memset( &mapRotations, 0, sizeof( mapRotations ) );
 }
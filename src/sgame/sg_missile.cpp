@@ -596,7 +596,6 @@ gentity_t *G_SpawnMissile( missile_t missile, gentity_t *parent, vec3_t start, v
 
 	// from attribute config file
 	m->s.weapon            = ma->number;
-	m->classname           = ma->name;
 	m->pointAgainstWorld   = ma->pointAgainstWorld;
 	m->damage              = ma->damage;
 	m->methodOfDeath       = ma->meansOfDeath;
@@ -616,6 +615,8 @@ gentity_t *G_SpawnMissile( missile_t missile, gentity_t *parent, vec3_t start, v
 	m->flightSplashDamage  = 0;
 	m->flightSplashRadius  = 0;
 
+	G_SetClassname( m, ma->name );
+
 	// trajectory
 	{
 		// set trajectory type
@@ -22,6 +22,163 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 
 #include "sg_local.h"
 
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/*
+================
+Namelog index
+
+Connects look entries up by GUID and admin commands by id through hash
+tables rather than walking level.namelogs. Disconnected entries are also
+queued in least recently seen order, and the oldest are dropped once there
+are more than g_namelogMaxDisconnected of them. Ids are never reused
+within a map.
+================
+*/
+static std::unordered_map<std::string, std::vector<namelog_t *>> namelogGuids; // in id order
+static std::unordered_map<int, namelog_t *>                       namelogIds;
+static int                                                        namelogNextId = MAX_CLIENTS;
+static namelog_t                                                  *namelogTail; // of level.namelogs
+static namelog_t                                                  *namelogOldest, *namelogNewest;
+static int                                                        namelogDisconnected;
+
+static void G_namelog_queue( namelog_t *n )
+{
+	n->lruPrev = namelogNewest;
+	n->lruNext = nullptr;
+
+	if ( namelogNewest )
+	{
+		namelogNewest->lruNext = n;
+	}
+	else
+	{
+		namelogOldest = n;
+	}
+
+	namelogNewest = n;
+	namelogDisconnected++;
+}
+
+static void G_namelog_unqueue( namelog_t *n )
+{
+	if ( n->lruPrev )
+	{
+		n->lruPrev->lruNext = n->lruNext;
+	}
+	else
+	{
+		namelogOldest = n->lruNext;
+	}
+
+	if ( n->lruNext )
+	{
+		n->lruNext->lruPrev = n->lruPrev;
+	}
+	else
+	{
+		namelogNewest = n->lruPrev;
+	}
+
+	n->lruPrev = n->lruNext = nullptr;
+	namelogDisconnected--;
+}
+
+static void G_namelog_evict()
+{
+	std::unordered_set<const namelog_t *> referenced, victims;
+	namelog_t                             *n, *next, *p;
+	int                                   excess, i;
+
+	excess = namelogDisconnected - g_namelogMaxDisconnected.integer;
+
+	if ( g_namelogMaxDisconnected.integer <= 0 || excess <= 0 )
+	{
+		return;
+	}
+
+	// the build log and buildables point at whoever built them
+	for ( i = 0; i < MAX_BUILDLOG; i++ )
+	{
+		referenced.insert( level.buildLog[ i ].actor );
+		referenced.insert( level.buildLog[ i ].builtBy );
+	}
+
+	for ( i = MAX_CLIENTS; i < level.num_entities; i++ )
+	{
+		if ( g_entities[ i ].inuse )
+		{
+			referenced.insert( g_entities[ i ].builtBy );
+		}
+	}
+
+	for ( n = namelogOldest; n && excess > 0; n = next )
+	{
+		next = n->lruNext;
+
+		// mutes and build bans have to survive a reconnect
+		if ( n->muted || n->denyBuild || referenced.count( n ) )
+		{
+			continue;
+		}
+
+		G_namelog_unqueue( n );
+		victims.insert( n );
+		excess--;
+	}
+
+	if ( victims.empty() )
+	{
+		return;
+	}
+
+	for ( p = nullptr, n = level.namelogs; n; n = next )
+	{
+		next = n->next;
+
+		if ( !victims.count( n ) )
+		{
+			p = n;
+			continue;
+		}
+
+		if ( p )
+		{
+			p->next = next;
+		}
+		else
+		{
+			level.namelogs = next;
+		}
+
+		auto guid = namelogGuids.find( G_GuidKey( n->guid ) );
+		std::vector<namelog_t *> &entries = guid->second;
+
+		entries.erase( std::find( entries.begin(), entries.end(), n ) );
+
+		if ( entries.empty() )
+		{
+			namelogGuids.erase( guid );
+		}
+
+		namelogIds.erase( n->id );
+		BG_Free( n );
+	}
+
+	namelogTail = p;
+}
+
+namelog_t *G_namelog_find( int id )
+{
+	auto it = namelogIds.find( id );
+
+	return ( it != namelogIds.end() ) ? it->second : nullptr;
+}
+
 void G_namelog_cleanup()
 {
 	namelog_t *namelog, *n;
@@ -31,42 +188,55 @@ void G_namelog_cleanup()
 		n = namelog->next;
 		BG_Free( namelog );
 	}
+
+	namelogGuids.clear();
+	namelogIds.clear();
+	namelogNextId = MAX_CLIENTS;
+	namelogTail = nullptr;
+	namelogOldest = namelogNewest = nullptr;
+	namelogDisconnected = 0;
 }
 
 void G_namelog_connect( gclient_t *client )
 {
-	namelog_t *n, *p = nullptr;
+	namelog_t *n = nullptr;
 	int       i;
 	char      *newname;
 
-	for ( n = level.namelogs; n; p = n, n = n->next )
-	{
-		if ( n->slot != -1 )
-		{
-			continue;
-		}
+	std::vector<namelog_t *> &entries = namelogGuids[ G_GuidKey( client->pers.guid ) ];
 
-		if ( !Q_stricmp( client->pers.guid, n->guid ) )
+	for ( namelog_t *entry : entries )
+	{
+		if ( entry->slot == -1 )
 		{
+			n = entry;
 			break;
 		}
 	}
 
-	if ( !n )
+	if ( n )
+	{
+		G_namelog_unqueue( n );
+	}
+	else
 	{
 		n = (namelog_t*) BG_Alloc( sizeof( namelog_t ) );
 		strcpy( n->guid, client->pers.guid );
+		n->id = namelogNextId++;
 
-		if ( p )
+		if ( namelogTail )
 		{
-			p->next = n;
-			n->id = p->id + 1;
+			namelogTail->next = n;
 		}
 		else
 		{
 			level.namelogs = n;
-			n->id = MAX_CLIENTS;
 		}
+
+		namelogTail = n;
+
+		entries.push_back( n );
+		namelogIds[ n->id ] = n;
 	}
 
 	client->pers.namelog = n;
@@ -107,7 +277,10 @@ void G_namelog_disconnect( gclient_t *client )
 	}
 
 	client->pers.namelog->slot = -1;
+	G_namelog_queue( client->pers.namelog );
 	client->pers.namelog = nullptr;
+
+	G_namelog_evict();
 }
 
 void G_namelog_update_score( gclient_t *client )
@@ -0,0 +1,266 @@
+/*
+===========================================================================
+
+Copyright 2016 Unvanquished Developers
+
+This file is part of Unvanquished.
+
+Unvanquished is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Unvanquished is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Unvanquished.  If not, see <http://www.gnu.org/licenses/>.
+
+===========================================================================
+*/
+
+// sg_profiler.cpp
+// per-stage timing of G_RunFrame
+
+#include "sg_local.h"
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace Profiler
+{
+	typedef std::chrono::steady_clock clock_type;
+
+	struct frameRecord_t
+	{
+		int64_t start;                   // µs since the profiler epoch
+		int     levelTime;
+		int     first[ PS_NUM_STAGES ];  // µs since the frame start, -1 if the stage did not run
+		int     total[ PS_NUM_STAGES ];  // accumulated µs
+	};
+
+	static const char *stageNames[ PS_NUM_STAGES ] =
+	{
+		"frame",
+
+		"entities",
+		"missiles",
+		"buildables",
+		"corpses",
+		"movers",
+		"physics",
+		"clients",
+		"think",
+
+		"ClientEndFrame",
+		"UnlaggedStore",
+		"CountSpawns",
+		"BuildablePowerState",
+		"MineBuildPoints",
+		"Momentum",
+		"SpawnClients",
+		"UpdateZaps",
+		"Beacon::Frame",
+		"PrepareEntityNetCode",
+		"LogGameplayStats",
+		"CheckExitRules",
+		"CheckTeamStatus",
+		"CheckVote",
+		"BotUpdateObstacles",
+	};
+
+	static frameRecord_t     history[ PROFILER_FRAMES ];
+	static int               numFrames;      // total number of recorded frames
+	static frameRecord_t     *current;       // nullptr while not inside a recorded frame
+	static clock_type::time_point epoch = clock_type::now();
+	static clock_type::time_point frameStart;
+
+	static inline bool IsSubStage( int stage )
+	{
+		return stage >= PS_ENT_MISSILE && stage <= PS_ENT_THINK;
+	}
+
+	bool Enabled()
+	{
+		return current != nullptr;
+	}
+
+	/**
+	 * @return Microseconds since the start of the current frame.
+	 */
+	int Now()
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>( clock_type::now() - frameStart ).count();
+	}
+
+	void BeginFrame()
+	{
+		if ( !g_profileFrames.integer )
+		{
+			current = nullptr;
+			return;
+		}
+
+		frameStart = clock_type::now();
+
+		current = &history[ numFrames % PROFILER_FRAMES ];
+		current->start = std::chrono::duration_cast<std::chrono::microseconds>( frameStart - epoch ).count();
+		current->levelTime = level.time;
+
+		for ( int i = 0; i < PS_NUM_STAGES; i++ )
+		{
+			current->first[ i ] = -1;
+			current->total[ i ] = 0;
+		}
+
+		current->first[ PS_FRAME ] = 0;
+	}
+
+	void EndFrame()
+	{
+		if ( !current )
+		{
+			return;
+		}
+
+		current->total[ PS_FRAME ] = Now();
+		current = nullptr;
+		numFrames++;
+	}
+
+	void Record( stage_t stage, int start )
+	{
+		if ( !current )
+		{
+			return;
+		}
+
+		if ( current->first[ stage ] < 0 )
+		{
+			current->first[ stage ] = start;
+		}
+
+		current->total[ stage ] += Now() - start;
+	}
+
+	void Reset()
+	{
+		numFrames = 0;
+		current = nullptr;
+	}
+
+	/**
+	 * @brief Prints the median, 99th percentile and maximum time of every stage over the
+	 *        frames currently held in the history.
+	 */
+	void Print()
+	{
+		int count = std::min( numFrames, PROFILER_FRAMES );
+		std::vector<int> samples;
+
+		if ( !count )
+		{
+			Log::Notice( "No frames recorded. Set g_profileFrames to 1 to enable the frame profiler." );
+			return;
+		}
+
+		samples.reserve( count );
+
+		Log::Notice( "Stage timings over the last %d frames (ms):", count );
+		Log::Notice( "%-22s %8s %8s %8s %8s", "stage", "avg", "p50", "p99", "max" );
+
+		for ( int stage = 0; stage < PS_NUM_STAGES; stage++ )
+		{
+			int64_t sum = 0;
+
+			samples.clear();
+
+			for ( int i = 0; i < count; i++ )
+			{
+				samples.push_back( history[ i ].total[ stage ] );
+				sum += history[ i ].total[ stage ];
+			}
+
+			std::sort( samples.begin(), samples.end() );
+
+			Log::Notice( "%-22s %8.3f %8.3f %8.3f %8.3f",
+			             IsSubStage( stage ) ? va( "  %s", stageNames[ stage ] ) : stageNames[ stage ],
+			             sum / ( count * 1000.0f ),
+			             samples[ count / 2 ] / 1000.0f,
+			             samples[ std::min( count - 1, ( count * 99 ) / 100 ) ] / 1000.0f,
+			             samples.back() / 1000.0f );
+		}
+	}
+
+	/**
+	 * @brief Writes the history as a Chrome trace (chrome://tracing) JSON file.
+	 *
+	 * Top level stages are emitted on thread 0 at their real offsets. Per entity type stages
+	 * interleave inside the entity loop, so they are emitted on thread 1 as back-to-back
+	 * aggregates starting at the beginning of the loop.
+	 */
+	bool DumpTrace( const char *filename )
+	{
+		int          count = std::min( numFrames, PROFILER_FRAMES );
+		int          oldest = numFrames > PROFILER_FRAMES ? numFrames % PROFILER_FRAMES : 0;
+		fileHandle_t f;
+		std::string  out;
+		bool         firstEvent = true;
+
+		if ( trap_FS_FOpenFile( filename, &f, fsMode_t::FS_WRITE ) < 0 )
+		{
+			Log::Warn( "could not open %s for writing", filename );
+			return false;
+		}
+
+		out = "{\"traceEvents\":[\n";
+
+		for ( int i = 0; i < count; i++ )
+		{
+			const frameRecord_t *frame = &history[ ( oldest + i ) % PROFILER_FRAMES ];
+			int subStageTime = frame->first[ PS_ENTITIES ];
+
+			for ( int stage = 0; stage < PS_NUM_STAGES; stage++ )
+			{
+				int tid = 0;
+				int ts  = frame->first[ stage ];
+
+				if ( ts < 0 )
+				{
+					continue;
+				}
+
+				if ( IsSubStage( stage ) )
+				{
+					tid = 1;
+					ts  = subStageTime;
+					subStageTime += frame->total[ stage ];
+				}
+
+				out += Str::Format( "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,"
+				                    "\"ts\":%lld,\"dur\":%d,\"args\":{\"levelTime\":%d}}",
+				                    firstEvent ? "" : ",\n", stageNames[ stage ], tid,
+				                    ( long long ) ( frame->start + ts ), frame->total[ stage ],
+				                    frame->levelTime );
+				firstEvent = false;
+			}
+
+			// flush regularly to keep the buffer small
+			if ( out.size() > 65536 )
+			{
+				trap_FS_Write( out.data(), out.size(), f );
+				out.clear();
+			}
+		}
+
+		out += "\n]}\n";
+		trap_FS_Write( out.data(), out.size(), f );
+		trap_FS_FCloseFile( f );
+
+		Log::Notice( "wrote %d frames to %s", count, filename );
+		return true;
+	}
+}
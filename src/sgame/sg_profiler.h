@@ -0,0 +1,101 @@
+/*
+===========================================================================
+
+Copyright 2016 Unvanquished Developers
+
+This file is part of Unvanquished.
+
+Unvanquished is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Unvanquished is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Unvanquished.  If not, see <http://www.gnu.org/licenses/>.
+
+===========================================================================
+*/
+
+#ifndef SG_PROFILER_H_
+#define SG_PROFILER_H_
+
+// number of frames kept in the profiler's history
+#define PROFILER_FRAMES 1024
+
+/**
+ * @brief Per-stage server frame profiler.
+ *
+ * Stages are timed with Profiler::Scope and accumulated into a ring buffer holding the last
+ * PROFILER_FRAMES frames. Recording is only done while g_profileFrames is enabled.
+ */
+namespace Profiler
+{
+	enum stage_t
+	{
+		PS_FRAME,
+
+		PS_ENTITIES,
+		PS_ENT_MISSILE,
+		PS_ENT_BUILDABLE,
+		PS_ENT_CORPSE,
+		PS_ENT_MOVER,
+		PS_ENT_PHYSICS,
+		PS_ENT_CLIENT,
+		PS_ENT_THINK,
+
+		PS_CLIENT_END_FRAME,
+		PS_UNLAGGED_STORE,
+		PS_COUNT_SPAWNS,
+		PS_POWER_STATE,
+		PS_MINE_BUILD_POINTS,
+		PS_MOMENTUM,
+		PS_SPAWN_CLIENTS,
+		PS_ZAPS,
+		PS_BEACONS,
+		PS_NETCODE,
+		PS_GAMEPLAY_STATS,
+		PS_EXIT_RULES,
+		PS_TEAM_STATUS,
+		PS_VOTES,
+		PS_BOT_OBSTACLES,
+
+		PS_NUM_STAGES
+	};
+
+	bool Enabled();
+	int  Now();
+	void BeginFrame();
+	void EndFrame();
+	void Record( stage_t stage, int start );
+	void Reset();
+	void Print();
+	bool DumpTrace( const char *filename );
+
+	/**
+	 * @brief Adds the time spent in its lifetime to a stage of the current frame.
+	 */
+	class Scope
+	{
+		public:
+			Scope( stage_t stage ) : stage( stage ), start( Enabled() ? Now() : -1 ) {}
+
+			~Scope()
+			{
+				if ( start >= 0 )
+				{
+					Record( stage, start );
+				}
+			}
+
+		private:
+			stage_t stage;
+			int     start;
+	};
+}
+
+#endif // SG_PROFILER_H_
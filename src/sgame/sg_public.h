@@ -180,6 +180,7 @@ int               G_FloodLimited( gentity_t *ent );
 bool          G_CheckStopVote( team_t );
 bool          G_RoomForClassChange( gentity_t *ent, class_t pcl, vec3_t newOrigin );
 void              ScoreboardMessage( gentity_t *client );
+void              SendScoreboardMessageToAllClients();
 void              ClientCommand( int clientNum );
 void              G_ClearRotationStack();
 void              G_MapLog_NewMap();
@@ -227,7 +228,6 @@ void              FindIntermissionPoint();
 void              G_RunThink( gentity_t *ent );
 void              G_AdminMessage( gentity_t *ent, const char *string );
 void QDECL        G_LogPrintf( const char *fmt, ... ) PRINTF_LIKE(1);
-void              SendScoreboardMessageToAllClients();
 void              G_Vote( gentity_t *ent, team_t team, bool voting );
 void              G_ResetVote( team_t team );
 void              G_ExecuteVote( team_t team );
@@ -264,6 +264,7 @@ void              G_namelog_restore( gclient_t *client );
 void              G_namelog_update_score( gclient_t *client );
 void              G_namelog_update_name( gclient_t *client );
 void              G_namelog_cleanup();
+namelog_t         *G_namelog_find( int id );
 
 // sg_physcis.c
 void              G_Physics( gentity_t *ent, int msec );
@@ -273,6 +274,15 @@ void              G_ReadSessionData( gclient_t *client );
 void              G_InitSessionData( gclient_t *client, const char *userinfo );
 void              G_WriteSessionData();
 
+// sg_spatial.cpp
+#define ETYPE_MASK( eType ) ( 1 << Util::ordinal( eType ) )
+void              G_SpatialClear();
+void              G_SpatialLink( gentity_t *ent );
+void              G_SpatialUnlink( gentity_t *ent );
+int               G_SpatialEntitiesInBox( const vec3_t mins, const vec3_t maxs, int *list, int maxcount, team_t team = TEAM_ALL, int eTypes = 0 );
+int               G_SpatialEntitiesInRadius( const vec3_t origin, float radius, int *list, int maxcount, team_t team = TEAM_ALL, int eTypes = 0 );
+int               G_SpatialNearestEntities( const vec3_t origin, float radius, int *list, int k, team_t team = TEAM_ALL, int eTypes = 0 );
+
 // sg_svcmds.c
 bool          ConsoleCommand();
 void              G_RegisterCommands();
@@ -286,6 +296,7 @@ team_t            G_Team( gentity_t *ent );
 bool          G_OnSameTeam( gentity_t *ent1, gentity_t *ent2 );
 void              G_LeaveTeam( gentity_t *self );
 void              G_ChangeTeam( gentity_t *ent, team_t newTeam );
+void              Team_BuildLocationTable();
 gentity_t         *Team_GetLocation( gentity_t *ent );
 void              TeamplayInfoMessage( gentity_t *ent );
 void              CheckTeamStatus();
@@ -307,6 +318,7 @@ void              G_TeleportPlayer( gentity_t *player, vec3_t origin, vec3_t ang
 void              G_Sound( gentity_t *ent, soundChannel_t channel, int soundIndex );
 char              *G_CopyString( const char *str );
 char              *vtos( const vec3_t v );
+std::string       G_GuidKey( const char *guid );
 void              G_AddPredictableEvent( gentity_t *ent, int event, int eventParm );
 void              G_AddEvent( gentity_t *ent, int event, int eventParm );
 void              G_BroadcastEvent( int event, int eventParm, team_t team );
@@ -0,0 +1,406 @@
+/*
+===========================================================================
+
+Copyright 2016 Unvanquished Developers
+
+This file is part of Unvanquished.
+
+Unvanquished is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+Unvanquished is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Unvanquished.  If not, see <http://www.gnu.org/licenses/>.
+
+===========================================================================
+*/
+
+// sg_spatial.cpp
+// loose uniform grid over linked entities, for proximity queries
+
+#include "sg_local.h"
+
+/*
+ * Every linked entity is put in the grid cell that contains the center of its bounding
+ * box. Cells are hashed into a fixed number of buckets, so the grid covers any map size.
+ * Entities whose absolute bounds reach further than a cell size away from that center
+ * (mostly brush models) are kept in a separate list that every query checks. The grid is
+ * maintained by G_CM_LinkEntity and G_CM_UnlinkEntity.
+ *
+ * All queries return entity numbers in ascending order, just like a linear scan of
+ * g_entities would.
+ */
+
+#define SPATIAL_CELL_SIZE 256.0f
+#define SPATIAL_BUCKETS   4096 // must be a power of two
+#define SPATIAL_OVERSIZED SPATIAL_BUCKETS
+
+typedef struct
+{
+	int bucket; // -1 if not linked
+	int prev, next;
+} spatialEntity_t;
+
+static spatialEntity_t spatialEntities[ MAX_GENTITIES ];
+static int             spatialHeads[ SPATIAL_BUCKETS + 1 ];
+static int             spatialStamps[ SPATIAL_BUCKETS ];
+static int             spatialStamp;
+
+static inline int CellCoord( float x )
+{
+	return ( int )floorf( x / SPATIAL_CELL_SIZE );
+}
+
+static inline int CellBucket( int x, int y, int z )
+{
+	return ( ( unsigned )x * 73856093u ^ ( unsigned )y * 19349663u ^ ( unsigned )z * 83492791u )
+	       & ( SPATIAL_BUCKETS - 1 );
+}
+
+/*
+===============
+G_SpatialClear
+===============
+*/
+void G_SpatialClear()
+{
+	for ( int i = 0; i < MAX_GENTITIES; i++ )
+	{
+		spatialEntities[ i ].bucket = -1;
+	}
+
+	for ( int i = 0; i <= SPATIAL_BUCKETS; i++ )
+	{
+		spatialHeads[ i ] = -1;
+	}
+
+	memset( spatialStamps, 0, sizeof( spatialStamps ) );
+	spatialStamp = 0;
+}
+
+/*
+===============
+G_SpatialUnlink
+===============
+*/
+void G_SpatialUnlink( gentity_t *ent )
+{
+	spatialEntity_t *sent = &spatialEntities[ ent->s.number ];
+
+	if ( sent->bucket < 0 )
+	{
+		return;
+	}
+
+	if ( sent->prev >= 0 )
+	{
+		spatialEntities[ sent->prev ].next = sent->next;
+	}
+	else
+	{
+		spatialHeads[ sent->bucket ] = sent->next;
+	}
+
+	if ( sent->next >= 0 )
+	{
+		spatialEntities[ sent->next ].prev = sent->prev;
+	}
+
+	sent->bucket = -1;
+}
+
+/*
+===============
+G_SpatialLink
+
+Needs r.absmin and r.absmax to be set.
+===============
+*/
+void G_SpatialLink( gentity_t *ent )
+{
+	spatialEntity_t *sent = &spatialEntities[ ent->s.number ];
+	int             bucket = SPATIAL_OVERSIZED;
+	vec3_t          center;
+	int             i;
+
+	G_SpatialUnlink( ent );
+
+	for ( i = 0; i < 3; i++ )
+	{
+		center[ i ] = ent->r.currentOrigin[ i ] + ( ent->r.mins[ i ] + ent->r.maxs[ i ] ) * 0.5f;
+
+		if ( ent->r.absmin[ i ] < center[ i ] - SPATIAL_CELL_SIZE ||
+		     ent->r.absmax[ i ] > center[ i ] + SPATIAL_CELL_SIZE )
+		{
+			break;
+		}
+	}
+
+	if ( i == 3 )
+	{
+		bucket = CellBucket( CellCoord( center[ 0 ] ), CellCoord( center[ 1 ] ), CellCoord( center[ 2 ] ) );
+	}
+
+	sent->bucket = bucket;
+	sent->prev = -1;
+	sent->next = spatialHeads[ bucket ];
+
+	if ( sent->next >= 0 )
+	{
+		spatialEntities[ sent->next ].prev = ent->s.number;
+	}
+
+	spatialHeads[ bucket ] = ent->s.number;
+}
+
+typedef struct
+{
+	team_t team;
+	int    eTypes;
+	bool   ( *test )( const gentity_t *ent, const void *data );
+	const void *data;
+	int    *list;
+	int    count, maxcount;
+	int    dropped; // matches that did not fit in list
+} spatialQuery_t;
+
+static void SpatialCollectBucket( int bucket, spatialQuery_t *q )
+{
+	for ( int num = spatialHeads[ bucket ]; num >= 0; num = spatialEntities[ num ].next )
+	{
+		gentity_t *ent = &g_entities[ num ];
+
+		if ( !ent->r.linked )
+		{
+			continue;
+		}
+
+		if ( q->eTypes && !( q->eTypes & ETYPE_MASK( ent->s.eType ) ) )
+		{
+			continue;
+		}
+
+		if ( q->team != TEAM_ALL && G_Team( ent ) != q->team )
+		{
+			continue;
+		}
+
+		if ( !q->test( ent, q->data ) )
+		{
+			continue;
+		}
+
+		if ( q->count == q->maxcount )
+		{
+			q->dropped++;
+			continue;
+		}
+
+		q->list[ q->count++ ] = num;
+	}
+}
+
+/*
+===============
+SpatialCollect
+
+Runs the query over all buckets of the cells that may contain the center of an entity
+that matches, given the bounds of all such centers.
+===============
+*/
+static int SpatialCollect( const vec3_t mins, const vec3_t maxs, spatialQuery_t *q )
+{
+	int    lo[ 3 ], hi[ 3 ];
+	size_t cells = 1;
+
+	q->count = 0;
+	q->dropped = 0;
+
+	for ( int i = 0; i < 3; i++ )
+	{
+		lo[ i ] = CellCoord( mins[ i ] );
+		hi[ i ] = CellCoord( maxs[ i ] );
+		cells *= hi[ i ] - lo[ i ] + 1;
+	}
+
+	if ( cells >= SPATIAL_BUCKETS )
+	{
+		for ( int bucket = 0; bucket < SPATIAL_BUCKETS; bucket++ )
+		{
+			SpatialCollectBucket( bucket, q );
+		}
+	}
+	else
+	{
+		// several cells can share a bucket, visit each only once
+		if ( ++spatialStamp == 0 )
+		{
+			memset( spatialStamps, 0, sizeof( spatialStamps ) );
+			spatialStamp = 1;
+		}
+
+		for ( int x = lo[ 0 ]; x <= hi[ 0 ]; x++ )
+		{
+			for ( int y = lo[ 1 ]; y <= hi[ 1 ]; y++ )
+			{
+				for ( int z = lo[ 2 ]; z <= hi[ 2 ]; z++ )
+				{
+					int bucket = CellBucket( x, y, z );
+
+					if ( spatialStamps[ bucket ] != spatialStamp )
+					{
+						spatialStamps[ bucket ] = spatialStamp;
+						SpatialCollectBucket( bucket, q );
+					}
+				}
+			}
+		}
+	}
+
+	SpatialCollectBucket( SPATIAL_OVERSIZED, q );
+
+	if ( q->dropped )
+	{
+		Log::Warn( "G_Spatial: MAXCOUNT, %i entities dropped", q->dropped );
+	}
+
+	std::sort( q->list, q->list + q->count );
+
+	return q->count;
+}
+
+static bool SpatialBoxTest( const gentity_t *ent, const void *data )
+{
+	const float *bounds = ( const float * )data;
+
+	return !( ent->r.absmin[ 0 ] > bounds[ 3 ] || ent->r.absmin[ 1 ] > bounds[ 4 ] ||
+	          ent->r.absmin[ 2 ] > bounds[ 5 ] || ent->r.absmax[ 0 ] < bounds[ 0 ] ||
+	          ent->r.absmax[ 1 ] < bounds[ 1 ] || ent->r.absmax[ 2 ] < bounds[ 2 ] );
+}
+
+static bool SpatialRadiusTest( const gentity_t *ent, const void *data )
+{
+	const float *sphere = ( const float * )data;
+	vec3_t      eorg;
+
+	// same test as G_IterateEntitiesWithinRadius
+	for ( int j = 0; j < 3; j++ )
+	{
+		eorg[ j ] = sphere[ j ] - ( ent->r.currentOrigin[ j ] + ( ent->r.mins[ j ] + ent->r.maxs[ j ] ) * 0.5 );
+	}
+
+	return VectorLength( eorg ) <= sphere[ 3 ];
+}
+
+/*
+===============
+G_SpatialEntitiesInBox
+
+Fills in a list of linked entities whose absmin / absmax intersects the given bounds,
+optionally restricted to a team (TEAM_ALL for any) and a set of entity types (a mask
+built with ETYPE_MASK, 0 for any).
+===============
+*/
+int G_SpatialEntitiesInBox( const vec3_t mins, const vec3_t maxs, int *list, int maxcount,
+                            team_t team, int eTypes )
+{
+	spatialQuery_t q;
+	float          bounds[ 6 ];
+	vec3_t         centerMins, centerMaxs;
+
+	VectorCopy( mins, bounds );
+	VectorCopy( maxs, bounds + 3 );
+
+	// entities in the grid reach at most one cell size away from their center
+	for ( int i = 0; i < 3; i++ )
+	{
+		centerMins[ i ] = mins[ i ] - SPATIAL_CELL_SIZE;
+		centerMaxs[ i ] = maxs[ i ] + SPATIAL_CELL_SIZE;
+	}
+
+	q.team = team;
+	q.eTypes = eTypes;
+	q.test = SpatialBoxTest;
+	q.data = bounds;
+	q.list = list;
+	q.maxcount = maxcount;
+
+	return SpatialCollect( centerMins, centerMaxs, &q );
+}
+
+/*
+===============
+G_SpatialEntitiesInRadius
+
+Fills in a list of linked entities whose bounding box center is within radius of origin.
+This is the same test G_IterateEntitiesWithinRadius does.
+===============
+*/
+int G_SpatialEntitiesInRadius( const vec3_t origin, float radius, int *list, int maxcount,
+                               team_t team, int eTypes )
+{
+	spatialQuery_t q;
+	float          sphere[ 4 ];
+	vec3_t         mins, maxs;
+
+	VectorCopy( origin, sphere );
+	sphere[ 3 ] = radius;
+
+	for ( int i = 0; i < 3; i++ )
+	{
+		mins[ i ] = origin[ i ] - radius;
+		maxs[ i ] = origin[ i ] + radius;
+	}
+
+	q.team = team;
+	q.eTypes = eTypes;
+	q.test = SpatialRadiusTest;
+	q.data = sphere;
+	q.list = list;
+	q.maxcount = maxcount;
+
+	return SpatialCollect( mins, maxs, &q );
+}
+
+/*
+===============
+G_SpatialNearestEntities
+
+Fills in up to k linked entities within radius of origin, closest first.
+===============
+*/
+int G_SpatialNearestEntities( const vec3_t origin, float radius, int *list, int k,
+                              team_t team, int eTypes )
+{
+	int entityList[ MAX_GENTITIES ];
+	int num = G_SpatialEntitiesInRadius( origin, radius, entityList, MAX_GENTITIES, team, eTypes );
+
+	auto distance = [ origin ]( int entityNum )
+	{
+		const gentity_t *ent = &g_entities[ entityNum ];
+		vec3_t          center;
+
+		VectorAdd( ent->r.mins, ent->r.maxs, center );
+		VectorMA( ent->r.currentOrigin, 0.5f, center, center );
+
+		return DistanceSquared( origin, center );
+	};
+
+	k = std::min( k, num );
+
+	std::partial_sort( entityList, entityList + k, entityList + num, [ & ]( int a, int b )
+	{
+		float da = distance( a ), db = distance( b );
+		return da < db || ( da == db && a < b );
+	} );
+
+	memcpy( list, entityList, k * sizeof( int ) );
+
+	return k;
+}
@@ -481,7 +481,7 @@ bool G_HandleEntityVersions( entityClassDescriptor_t *spawnDescription, gentity_
 			Log::Warn("Entity %s uses a deprecated classtype — use the class ^5%s^* instead", etos( entity ), spawnDescription->replacement );
 		}
 	}
-	entity->classname = spawnDescription->replacement;
+	G_SetClassname( entity, spawnDescription->replacement );
 	return true;
 }
 
@@ -843,6 +843,8 @@ void G_SpawnGEntityFromSpawnVars()
 	}
 	spawningEntity->names[ j ] = nullptr;
 
+	G_UpdateEntityIndex( spawningEntity );
+
 	/*
 	 * for backward compatbility, since before targets were used for calling,
 	 * we'll have to copy them over to the called-targets as well for now
@@ -434,6 +434,7 @@ struct clientSession_s
 struct namelog_s
 {
 	struct namelog_s *next;
+	struct namelog_s *lruPrev, *lruNext; // disconnected entries, least recently seen first
 
 	char             name[ MAX_NAMELOG_NAMES ][ MAX_NAME_LENGTH ];
 	addr_t           ip[ MAX_NAMELOG_ADDRS ];
@@ -510,6 +511,9 @@ struct clientPersistant_s
 	// level.time when teamoverlay info changed so we know to tell other players.
 	int                 infoChangeTime;
 
+	// of the last scoreboard sent, so unchanged ones aren't sent again
+	unsigned            scoreboardChecksum;
+
 	// warnings in the ban log
 	bool            hasWarnings;
 };
@@ -523,6 +527,29 @@ struct unlagged_s
 };
 
 #define MAX_UNLAGGED_MARKERS 256
+
+/**
+ * Lag compensation history, one slot per server frame. The positions of all clients
+ * are stored together in each slot so that a rewind interpolates them in one pass.
+ */
+struct unlaggedHistory_s
+{
+	int    index;  // most recent slot
+	int    count;  // number of slots stored so far
+	int    times[ MAX_UNLAGGED_MARKERS ];
+	vec3_t origins[ MAX_UNLAGGED_MARKERS ][ MAX_CLIENTS ];
+	vec3_t mins[ MAX_UNLAGGED_MARKERS ][ MAX_CLIENTS ];
+	vec3_t maxs[ MAX_UNLAGGED_MARKERS ][ MAX_CLIENTS ];
+	bool   used[ MAX_UNLAGGED_MARKERS ][ MAX_CLIENTS ];
+
+	// last rewind, reused until the next slot is stored
+	bool   calcValid;
+	int    calcTime;
+	int    calcStart, calcStop;
+	vec3_t calcOrigins[ MAX_CLIENTS ];
+	vec3_t calcMins[ MAX_CLIENTS ];
+	vec3_t calcMaxs[ MAX_CLIENTS ];
+};
 #define MAX_TRAMPLE_BUILDABLES_TRACKED 20
 
 /**
@@ -587,7 +614,6 @@ struct gclient_s
 	int        lastAmmoRefillTime;
 	int        lastFuelRefillTime;
 
-	unlagged_t unlaggedHist[ MAX_UNLAGGED_MARKERS ];
 	unlagged_t unlaggedBackup;
 	unlagged_t unlaggedCalc;
 	int        unlaggedTime;
@@ -725,8 +751,7 @@ struct level_locals_s
 
 	int              pausedTime;
 
-	int              unlaggedIndex;
-	int              unlaggedTimes[ MAX_UNLAGGED_MARKERS ];
+	unlaggedHistory_t unlagged;
 
 	char             layout[ MAX_QPATH ];
 
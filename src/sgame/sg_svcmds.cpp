@@ -35,6 +35,7 @@ Maryland 20850 USA.
 // this file holds commands that can be executed by the server console, but not remote clients
 
 #include "sg_local.h"
+#include "sg_cm_world.h"
 
 #define IS_NON_NULL_VEC3(vec3tor) (vec3tor[0] || vec3tor[1] || vec3tor[2])
 
@@ -642,6 +643,98 @@ static void Svcmd_PrintQueue_f()
 	}
 }
 
+static void Svcmd_BotMemoStats_f()
+{
+	char arg[ MAX_QPATH ];
+
+	if ( trap_Argc() < 2 )
+	{
+		G_BotPrintMemoStats();
+		return;
+	}
+
+	trap_Argv( 1, arg, sizeof( arg ) );
+
+	if ( !Q_stricmp( arg, "reset" ) )
+	{
+		G_BotResetMemoStats();
+	}
+	else
+	{
+		Log::Notice( "usage: botMemoStats [reset]" );
+	}
+}
+
+static void Svcmd_FrameProfile_f()
+{
+	char arg[ MAX_QPATH ];
+
+	if ( trap_Argc() < 2 )
+	{
+		Profiler::Print();
+		return;
+	}
+
+	trap_Argv( 1, arg, sizeof( arg ) );
+
+	if ( !Q_stricmp( arg, "reset" ) )
+	{
+		Profiler::Reset();
+	}
+	else if ( !Q_stricmp( arg, "dump" ) && trap_Argc() == 3 )
+	{
+		trap_Argv( 2, arg, sizeof( arg ) );
+		Profiler::DumpTrace( arg );
+	}
+	else
+	{
+		Log::Notice( "usage: frameProfile [reset | dump <filename>]" );
+	}
+}
+
+static void Svcmd_WorldTree_f()
+{
+	char arg[ MAX_QPATH ];
+
+	if ( trap_Argc() < 2 )
+	{
+		G_CM_WorldTreeInfo_f();
+		return;
+	}
+
+	trap_Argv( 1, arg, sizeof( arg ) );
+
+	if ( !Q_stricmp( arg, "save" ) && trap_Argc() == 3 )
+	{
+		trap_Argv( 2, arg, sizeof( arg ) );
+		G_CM_SaveEntityLayout( arg );
+	}
+	else if ( !Q_stricmp( arg, "bench" ) && trap_Argc() <= 4 )
+	{
+		int queries = 100000;
+
+		if ( trap_Argc() >= 3 )
+		{
+			trap_Argv( 2, arg, sizeof( arg ) );
+			queries = std::max( 1, atoi( arg ) );
+		}
+
+		if ( trap_Argc() == 4 )
+		{
+			trap_Argv( 3, arg, sizeof( arg ) );
+			G_CM_BenchmarkAreaQueries( queries, arg );
+		}
+		else
+		{
+			G_CM_BenchmarkAreaQueries( queries, nullptr );
+		}
+	}
+	else
+	{
+		Log::Notice( "usage: worldTree [save <filename> | bench [queries] [filename]]" );
+	}
+}
+
 // dumb wrapper for "a", "m", "chat", and "say"
 static void Svcmd_MessageWrapper()
 {
@@ -692,6 +785,7 @@ static const struct svcmd
 	{ "advanceMapRotation", false, Svcmd_G_AdvanceMapRotation_f },
 	{ "alienWin",           false, Svcmd_TeamWin_f              },
 	{ "asay",               true,  Svcmd_MessageWrapper         },
+	{ "botMemoStats",       false, Svcmd_BotMemoStats_f         },
 	{ "chat",               true,  Svcmd_MessageWrapper         },
 	{ "cp",                 true,  Svcmd_CenterPrint_f          },
 	{ "dumpuser",           false, Svcmd_DumpUser_f             },
@@ -701,6 +795,7 @@ static const struct svcmd
 	{ "entityShow",         false, Svcmd_EntityShow_f           },
 	{ "evacuation",         false, Svcmd_Evacuation_f           },
 	{ "forceTeam",          false, Svcmd_ForceTeam_f            },
+	{ "frameProfile",       false, Svcmd_FrameProfile_f         },
 	{ "humanWin",           false, Svcmd_TeamWin_f              },
 	{ "layoutLoad",         false, Svcmd_LayoutLoad_f           },
 	{ "layoutSave",         false, Svcmd_LayoutSave_f           },
@@ -712,6 +807,7 @@ static const struct svcmd
 	{ "say",                true,  Svcmd_MessageWrapper         },
 	{ "say_team",           true,  Svcmd_TeamMessage_f          },
 	{ "stopMapRotation",    false, G_StopMapRotation            },
+	{ "worldTree",          false, Svcmd_WorldTree_f            },
 };
 
 /*
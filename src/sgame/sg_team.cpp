@@ -22,8 +22,11 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 */
 
 #include "sg_local.h"
+#include "sg_cm_world.h"
 #include "CBSE.h"
 
+#include <vector>
+
 /*
 ================
 G_TeamFromString
@@ -325,12 +328,91 @@ void G_ChangeTeam( gentity_t *ent, team_t newTeam )
 
 /*
 ===========
-Team_GetLocation
+Location lookup table
 
-Report a location for the player. Uses placed nearby target_location entities
+For every PVS cluster, the locations that may be visible from it, in the
+order of level.locationHead. Doors can open and close, so the areas are
+still checked on lookup. Locations outside of all clusters (such as the
+fake location) can't be classified and always get a full PVS test.
 ============
 */
-gentity_t *Team_GetLocation( gentity_t *ent )
+typedef struct
+{
+	gentity_t *ent;
+	int       area; // -1 if the location needs a full PVS test
+} locationCandidate_t;
+
+static struct
+{
+	gentity_t                        *head; // the level.locationHead the table was built for
+	int                              numClusters;
+	std::vector<int>                 first; // numClusters + 1 offsets into candidates
+	std::vector<locationCandidate_t> candidates;
+} locationTable;
+
+/*
+===========
+Team_BuildLocationTable
+============
+*/
+void Team_BuildLocationTable()
+{
+	std::vector<locationCandidate_t> locations;
+	std::vector<int>                 clusters;
+	gentity_t                        *eloc;
+
+	locationTable.head = level.locationHead;
+	locationTable.numClusters = CM_NumClusters();
+	locationTable.first.clear();
+	locationTable.candidates.clear();
+
+	for ( eloc = level.locationHead; eloc; eloc = eloc->nextPathSegment )
+	{
+		int leafnum = CM_PointLeafnum( eloc->r.currentOrigin );
+		int cluster = CM_LeafCluster( leafnum );
+
+		if ( cluster < 0 || cluster >= locationTable.numClusters )
+		{
+			locations.push_back( { eloc, -1 } );
+			clusters.push_back( -1 );
+		}
+		else
+		{
+			locations.push_back( { eloc, CM_LeafArea( leafnum ) } );
+			clusters.push_back( cluster );
+		}
+	}
+
+	locationTable.first.reserve( locationTable.numClusters + 1 );
+
+	for ( int cluster = 0; cluster < locationTable.numClusters; cluster++ )
+	{
+		const byte *mask = CM_ClusterPVS( cluster );
+
+		locationTable.first.push_back( locationTable.candidates.size() );
+
+		for ( size_t i = 0; i < locations.size(); i++ )
+		{
+			int c = clusters[ i ];
+
+			if ( c < 0 || !mask || ( mask[ c >> 3 ] & ( 1 << ( c & 7 ) ) ) )
+			{
+				locationTable.candidates.push_back( locations[ i ] );
+			}
+		}
+	}
+
+	locationTable.first.push_back( locationTable.candidates.size() );
+}
+
+/*
+===========
+Team_GetLocationSlow
+
+Checks every location, this is what the lookup table must agree with
+============
+*/
+static gentity_t *Team_GetLocationSlow( gentity_t *ent )
 {
 	gentity_t *eloc, *best;
 	float     bestlen, len;
@@ -359,71 +441,129 @@ gentity_t *Team_GetLocation( gentity_t *ent )
 	return best;
 }
 
-/*---------------------------------------------------------------------------*/
-
 /*
-==================
-TeamplayInfoMessage
-
-Format:
-  clientNum location health weapon upgrade
+===========
+Team_GetLocation
 
-==================
+Report a location for the player. Uses placed nearby target_location entities
+============
 */
-void TeamplayInfoMessage( gentity_t *ent )
+gentity_t *Team_GetLocation( gentity_t *ent )
 {
-	char      entry[ 24 ];
-	char      string[ ( MAX_CLIENTS - 1 ) * ( sizeof( entry ) - 1 ) + 1 ];
-	int       i, j;
-	int       team, stringlength;
-	gentity_t *player;
-	gclient_t *cl;
-	upgrade_t upgrade = UP_NONE;
-	int       curWeaponClass = WP_NONE; // sends weapon for humans, class for aliens
-	int       health = 0;
+	gentity_t *best;
+	float     bestlen, len;
+	int       leafnum, cluster, area;
 
-	if ( !g_allowTeamOverlay.integer )
+	if ( locationTable.head != level.locationHead )
 	{
-		return;
+		Team_BuildLocationTable();
 	}
 
-	if ( !ent->client->pers.teamInfo )
+	leafnum = CM_PointLeafnum( ent->r.currentOrigin );
+	cluster = CM_LeafCluster( leafnum );
+	area = CM_LeafArea( leafnum );
+
+	if ( cluster < 0 || cluster >= locationTable.numClusters )
 	{
-		return;
+		return Team_GetLocationSlow( ent );
 	}
 
-	if ( ent->client->pers.team == TEAM_NONE )
+	best = nullptr;
+	bestlen = 3.0f * 8192.0f * 8192.0f;
+
+	for ( int i = locationTable.first[ cluster ]; i < locationTable.first[ cluster + 1 ]; i++ )
 	{
-		if ( ent->client->sess.spectatorState == SPECTATOR_FREE ||
-		     ent->client->sess.spectatorClient < 0 )
+		const locationCandidate_t *candidate = &locationTable.candidates[ i ];
+		gentity_t                 *eloc = candidate->ent;
+
+		len = DistanceSquared( ent->r.currentOrigin, eloc->r.currentOrigin );
+
+		if ( len > bestlen )
 		{
-			return;
+			continue;
 		}
 
-		team = g_entities[ ent->client->sess.spectatorClient ].client->
-		       pers.team;
+		if ( candidate->area < 0 ? !trap_InPVS( ent->r.currentOrigin, eloc->r.currentOrigin )
+		                         : !CM_AreasConnected( area, candidate->area ) )
+		{
+			continue;
+		}
+
+		bestlen = len;
+		best = eloc;
 	}
-	else
+
+	if ( g_debugLocations.integer )
 	{
-		team = ent->client->pers.team;
+		gentity_t *slow = Team_GetLocationSlow( ent );
+
+		if ( slow != best )
+		{
+			Log::Warn( "Team_GetLocation: lookup gave %d, full scan gave %d for client %d at %s",
+			           best ? best->s.number : -1, slow ? slow->s.number : -1,
+			           ent->s.number, vtos( ent->r.currentOrigin ) );
+			return slow;
+		}
 	}
 
-	string[ 0 ] = '\0';
-	stringlength = 0;
+	return best;
+}
+
+/*---------------------------------------------------------------------------*/
+
+/*
+==================
+Team overlay
+
+Every player's overlay entry is formatted once per update into a table
+shared by all recipients. A recipient only gets the entries of its team
+that changed since its last update.
+
+Entry format:
+  clientNum location health weapon credit [upgrade]
+
+Aliens don't have upgrades.
+==================
+*/
+#define TEAMINFO_ENTRY_SIZE 24
+
+static struct
+{
+	char entries[ MAX_CLIENTS ][ TEAMINFO_ENTRY_SIZE ];
+	int  changeTime[ MAX_CLIENTS ];         // -1 if the client has no entry
+	int  latestChangeTime[ NUM_TEAMS ];
+} teamInfo;
+
+/*
+==================
+TeamplayInfoUpdate
+
+Formats the entries of all the players
+==================
+*/
+static void TeamplayInfoUpdate()
+{
+	int       i;
+	gentity_t *player;
+	gclient_t *cl;
+
+	for ( i = 0; i < NUM_TEAMS; i++ )
+	{
+		teamInfo.latestChangeTime[ i ] = -1;
+	}
 
 	for ( i = 0; i < level.maxclients; i++ )
 	{
+		upgrade_t upgrade = UP_NONE;
+		int       curWeaponClass = WP_NONE; // sends weapon for humans, class for aliens
+		int       health = 0;
+
 		player = g_entities + i;
 		cl = player->client;
+		teamInfo.changeTime[ i ] = -1;
 
-		if ( ent == player || !cl || team != cl->pers.team ||
-		     !player->inuse )
-		{
-			continue;
-		}
-
-		// only update if changed since last time
-		if ( cl->pers.infoChangeTime <= ent->client->pers.teamInfo )
+		if ( !cl || !player->inuse ||
+		     ( cl->pers.team != TEAM_ALIENS && cl->pers.team != TEAM_HUMANS ) )
 		{
 			continue;
 		}
@@ -459,24 +599,24 @@ void TeamplayInfoMessage( gentity_t *ent )
 			}
 			health = static_cast<int>( std::ceil( player->entity->Get<HealthComponent>()->Health() ) );
 		}
-		else if ( cl->pers.team == TEAM_ALIENS )
+		else
 		{
 			curWeaponClass = cl->ps.stats[ STAT_CLASS ];
 			upgrade = UP_NONE;
 			health = static_cast<int>( std::ceil( player->entity->Get<HealthComponent>()->Health() ) );
 		}
 
-		if( team == TEAM_ALIENS ) // aliens don't have upgrades
+		if( cl->pers.team == TEAM_ALIENS ) // aliens don't have upgrades
 		{
-			Com_sprintf( entry, sizeof( entry ), " %i %i %i %i %i", i,
-						 cl->pers.location,
+			Com_sprintf( teamInfo.entries[ i ], TEAMINFO_ENTRY_SIZE, " %i %i %i %i %i", i,
+			             cl->pers.location,
 			             health,
-						 curWeaponClass,
-						 cl->pers.credit );
+			             curWeaponClass,
+			             cl->pers.credit );
 		}
 		else
 		{
-			Com_sprintf( entry, sizeof( entry ), " %i %i %i %i %i %i", i,
+			Com_sprintf( teamInfo.entries[ i ], TEAMINFO_ENTRY_SIZE, " %i %i %i %i %i %i", i,
 			             cl->pers.location,
 			             health,
 			             curWeaponClass,
@@ -484,8 +624,79 @@ void TeamplayInfoMessage( gentity_t *ent )
 			             upgrade );
 		}
 
+		teamInfo.changeTime[ i ] = cl->pers.infoChangeTime;
+		teamInfo.latestChangeTime[ cl->pers.team ] =
+			std::max( teamInfo.latestChangeTime[ cl->pers.team ], cl->pers.infoChangeTime );
+	}
+}
+
+/*
+==================
+TeamplayInfoSend
+
+Sends the entries that changed since the last update of a client,
+TeamplayInfoUpdate has to be called first
+==================
+*/
+static void TeamplayInfoSend( gentity_t *ent )
+{
+	char      string[ ( MAX_CLIENTS - 1 ) * ( TEAMINFO_ENTRY_SIZE - 1 ) + 1 ];
+	int       i, j;
+	int       team, stringlength;
+	gclient_t *cl;
+
+	if ( !g_allowTeamOverlay.integer )
+	{
+		return;
+	}
+
+	if ( !ent->client->pers.teamInfo )
+	{
+		return;
+	}
+
+	if ( ent->client->pers.team == TEAM_NONE )
+	{
+		if ( ent->client->sess.spectatorState == SPECTATOR_FREE ||
+		     ent->client->sess.spectatorClient < 0 )
+		{
+			return;
+		}
+
+		team = g_entities[ ent->client->sess.spectatorClient ].client->
+		       pers.team;
+	}
+	else
+	{
+		team = ent->client->pers.team;
+	}
+
+	// nothing new in this team
+	if ( team <= TEAM_NONE || team >= NUM_TEAMS ||
+	     teamInfo.latestChangeTime[ team ] <= ent->client->pers.teamInfo )
+	{
+		return;
+	}
 
-		j = strlen( entry );
+	string[ 0 ] = '\0';
+	stringlength = 0;
+
+	for ( i = 0; i < level.maxclients; i++ )
+	{
+		cl = g_entities[ i ].client;
+
+		if ( i == ent->s.number || teamInfo.changeTime[ i ] < 0 || team != cl->pers.team )
+		{
+			continue;
+		}
+
+		// only update if changed since last time
+		if ( teamInfo.changeTime[ i ] <= ent->client->pers.teamInfo )
+		{
+			continue;
+		}
+
+		j = strlen( teamInfo.entries[ i ] );
 
 		// this should not happen if entry and string sizes are correct
 		if ( stringlength + j >= (int) sizeof( string ) )
@@ -493,7 +704,7 @@ void TeamplayInfoMessage( gentity_t *ent )
 			break;
 		}
 
-		strcpy( string + stringlength, entry );
+		memcpy( string + stringlength, teamInfo.entries[ i ], j + 1 );
 		stringlength += j;
 	}
 
@@ -504,6 +715,24 @@ void TeamplayInfoMessage( gentity_t *ent )
 	}
 }
 
+/*
+==================
+TeamplayInfoMessage
+
+Sends the team overlay updates of a single client
+==================
+*/
+void TeamplayInfoMessage( gentity_t *ent )
+{
+	if ( !g_allowTeamOverlay.integer || !ent->client->pers.teamInfo )
+	{
+		return;
+	}
+
+	TeamplayInfoUpdate();
+	TeamplayInfoSend( ent );
+}
+
 void CheckTeamStatus()
 {
 	int       i;
@@ -543,6 +772,11 @@ void CheckTeamStatus()
 			}
 		}
 
+		if ( g_allowTeamOverlay.integer )
+		{
+			TeamplayInfoUpdate();
+		}
+
 		for ( i = 0; i < level.maxclients; i++ )
 		{
 			ent = g_entities + i;
@@ -554,7 +788,7 @@ void CheckTeamStatus()
 
 			if ( ent->inuse )
 			{
-				TeamplayInfoMessage( ent );
+				TeamplayInfoSend( ent );
 			}
 		}
 	}
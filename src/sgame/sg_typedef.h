@@ -44,6 +44,7 @@ typedef struct clientSession_s     clientSession_t;
 typedef struct namelog_s           namelog_t;
 typedef struct clientPersistant_s  clientPersistant_t;
 typedef struct unlagged_s          unlagged_t;
+typedef struct unlaggedHistory_s   unlaggedHistory_t;
 typedef struct gclient_s           gclient_t;
 typedef struct damageRegion_s      damageRegion_t;
 typedef struct spawnQueue_s        spawnQueue_t;
@@ -760,6 +760,25 @@ bool G_AddressCompare( const addr_t *a, const addr_t *b )
 	return true;
 }
 
+/*
+===============
+G_GuidKey
+
+Case insensitive lookup key for a player GUID
+===============
+*/
+std::string G_GuidKey( const char *guid )
+{
+	std::string key = guid;
+
+	for ( char &c : key )
+	{
+		c = tolower( ( unsigned char ) c );
+	}
+
+	return key;
+}
+
 /*
 ===============
 G_ClientnumToMask
@@ -845,7 +864,7 @@ gentity_t *G_SpawnFire( vec3_t origin, vec3_t normal, gentity_t *fireStarter )
 	fire = G_NewEntity();
 
 	// create a fire entity
-	fire->classname = "fire";
+	G_SetClassname( fire, "fire" );
 	fire->s.eType   = entityType_t::ET_FIRE;
 	fire->clipmask  = 0;
 
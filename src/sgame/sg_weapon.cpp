@@ -1401,7 +1401,7 @@ static void CreateNewZap( gentity_t *creator, gentity_t *target )
 
 		zap->effectChannel = G_NewEntity();
 		zap->effectChannel->s.eType = entityType_t::ET_LEV2_ZAP_CHAIN;
-		zap->effectChannel->classname = "lev2zapchain";
+		G_SetClassname( zap->effectChannel, "lev2zapchain" );
 		UpdateZapEffect( zap );
 
 		return;
@@ -997,6 +997,23 @@ void BG_InitBeaconAttributes()
 	bg_beacons[ BCT_TIMER - 1 ].decayTime = BEACON_TIMER_TIME + 1000;
 }
 
+/*
+================
+BG_Hash
+================
+*/
+unsigned BG_Hash( const void *data, int len, unsigned hash )
+{
+	const byte *p = (const byte *) data;
+
+	for ( int i = 0; i < len; i++ )
+	{
+		hash = ( hash ^ p[ i ] ) * 16777619u;
+	}
+
+	return hash;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 /*
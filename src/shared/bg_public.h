@@ -1425,6 +1425,10 @@ meansOfDeath_t            BG_MeansOfDeathByName( const char *name );
 void                      BG_InitAllConfigs();
 void                      BG_UnloadAllConfigs();
 
+// 32 bit FNV-1a, pass a previous result as hash to keep hashing
+#define BG_HASH_INIT              2166136261u
+unsigned                  BG_Hash( const void *data, int len, unsigned hash = BG_HASH_INIT );
+
 // Parsers
 bool                  BG_ReadWholeFile( const char *filename, char *buffer, int size);
 bool                  BG_CheckConfigVars();